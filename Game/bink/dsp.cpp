@@ -0,0 +1,237 @@
+#include "dsp.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#include <emmintrin.h>
+#define BINK_DSP_SSE2
+#endif
+
+using namespace Bink;
+
+enum {
+  A1 = 2896, /* (1/sqrt(2))<<12 */
+  A2 = 2217,
+  A3 = 3784,
+  A4 = -5352
+  };
+
+#if defined(BINK_DSP_SSE2)
+// 32-bit wraparound multiply, followed by arithmetic shift - same as scalar code
+static __m128i mul(int c, __m128i x) {
+  const __m128i cv = _mm_set1_epi32(c);
+  const __m128i ev = _mm_mul_epu32(x,cv);
+  const __m128i od = _mm_mul_epu32(_mm_srli_epi64(x,32),cv);
+  const __m128i lo = _mm_unpacklo_epi32(_mm_shuffle_epi32(ev,_MM_SHUFFLE(0,0,2,0)),
+                                        _mm_shuffle_epi32(od,_MM_SHUFFLE(0,0,2,0)));
+  return _mm_srai_epi32(lo,11);
+  }
+
+// one pass of transform over 4 independent lanes; v[k] is k-th input/output
+static void idct4(__m128i* v) {
+  const __m128i a0 = _mm_add_epi32(v[0],v[4]);
+  const __m128i a1 = _mm_sub_epi32(v[0],v[4]);
+  const __m128i a2 = _mm_add_epi32(v[2],v[6]);
+  const __m128i a3 = mul(A1,_mm_sub_epi32(v[2],v[6]));
+  const __m128i a4 = _mm_add_epi32(v[5],v[3]);
+  const __m128i a5 = _mm_sub_epi32(v[5],v[3]);
+  const __m128i a6 = _mm_add_epi32(v[1],v[7]);
+  const __m128i a7 = _mm_sub_epi32(v[1],v[7]);
+  const __m128i b0 = _mm_add_epi32(a4,a6);
+  const __m128i b1 = mul(A3,_mm_add_epi32(a5,a7));
+  const __m128i b2 = _mm_add_epi32(_mm_sub_epi32(mul(A4,a5),b0),b1);
+  const __m128i b3 = _mm_sub_epi32(mul(A1,_mm_sub_epi32(a6,a4)),b2);
+  const __m128i b4 = _mm_sub_epi32(_mm_add_epi32(mul(A2,a7),b3),b1);
+
+  const __m128i c0 = _mm_add_epi32(a0,a2);
+  const __m128i c1 = _mm_sub_epi32(_mm_add_epi32(a1,a3),a2);
+  const __m128i c2 = _mm_add_epi32(_mm_sub_epi32(a1,a3),a2);
+  const __m128i c3 = _mm_sub_epi32(a0,a2);
+  v[0] = _mm_add_epi32(c0,b0);
+  v[1] = _mm_add_epi32(c1,b2);
+  v[2] = _mm_add_epi32(c2,b3);
+  v[3] = _mm_sub_epi32(c3,b4);
+  v[4] = _mm_add_epi32(c3,b4);
+  v[5] = _mm_sub_epi32(c2,b3);
+  v[6] = _mm_sub_epi32(c1,b2);
+  v[7] = _mm_sub_epi32(c0,b0);
+  }
+
+static void transpose4(__m128i& r0, __m128i& r1, __m128i& r2, __m128i& r3) {
+  const __m128i t0 = _mm_unpacklo_epi32(r0,r1);
+  const __m128i t1 = _mm_unpacklo_epi32(r2,r3);
+  const __m128i t2 = _mm_unpackhi_epi32(r0,r1);
+  const __m128i t3 = _mm_unpackhi_epi32(r2,r3);
+  r0 = _mm_unpacklo_epi64(t0,t1);
+  r1 = _mm_unpackhi_epi64(t0,t1);
+  r2 = _mm_unpacklo_epi64(t2,t3);
+  r3 = _mm_unpackhi_epi64(t2,t3);
+  }
+
+// transpose of 8x8 matrix, stored as lo[row] = columns 0..3, hi[row] = columns 4..7
+static void transpose8(__m128i* lo, __m128i* hi) {
+  transpose4(lo[0],lo[1],lo[2],lo[3]);
+  transpose4(hi[0],hi[1],hi[2],hi[3]);
+  transpose4(lo[4],lo[5],lo[6],lo[7]);
+  transpose4(hi[4],hi[5],hi[6],hi[7]);
+  for(int i=0; i<4; ++i) {
+    const __m128i t = hi[i];
+    hi[i]   = lo[i+4];
+    lo[i+4] = t;
+    }
+  }
+
+// 2D transform; on return row i of result is packed into 8 x int16 of out[i], truncated to 8 bit
+static void idct8x8(const int32_t* coef, __m128i* out) {
+  __m128i lo[8], hi[8];
+  for(int i=0; i<8; ++i) {
+    lo[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coef+i*8));
+    hi[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coef+i*8+4));
+    }
+  // columns
+  idct4(lo);
+  idct4(hi);
+  // rows
+  transpose8(lo,hi);
+  idct4(lo);
+  idct4(hi);
+  transpose8(lo,hi);
+
+  const __m128i bias = _mm_set1_epi32(0x7F);
+  const __m128i mask = _mm_set1_epi32(0xFF);
+  for(int i=0; i<8; ++i) {
+    const __m128i l = _mm_and_si128(_mm_srai_epi32(_mm_add_epi32(lo[i],bias),8),mask);
+    const __m128i h = _mm_and_si128(_mm_srai_epi32(_mm_add_epi32(hi[i],bias),8),mask);
+    out[i] = _mm_packs_epi32(l,h);
+    }
+  }
+
+// (prev + v) & 0xFF, for 8 x int16 values of v
+static void addStore8(uint8_t* dst, const uint8_t* prev, __m128i v) {
+  const __m128i p = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(prev)),_mm_setzero_si128());
+  const __m128i s = _mm_and_si128(_mm_add_epi16(p,v),_mm_set1_epi16(0xFF));
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(dst),_mm_packus_epi16(s,s));
+  }
+#else
+template<class T>
+static void idctTransform(T* dest, const int* src,
+                          int s0, int s1, int s2, int s3, int s4, int s5, int s6, int s7,
+                          int d0, int d1, int d2, int d3, int d4, int d5, int d6, int d7,
+                          T (*munge)(int)) {
+  static int (*mul)(int,int) = [](int x,int y) -> int { return int(uint32_t(x)*uint32_t(y)) >> 11; };
+
+  const int a0 = (src)[s0] + (src)[s4];
+  const int a1 = (src)[s0] - (src)[s4];
+  const int a2 = (src)[s2] + (src)[s6];
+  const int a3 = mul(A1, (src)[s2] - (src)[s6]);
+  const int a4 = (src)[s5] + (src)[s3];
+  const int a5 = (src)[s5] - (src)[s3];
+  const int a6 = (src)[s1] + (src)[s7];
+  const int a7 = (src)[s1] - (src)[s7];
+  const int b0 = a4 + a6;
+  const int b1 = mul(A3, a5 + a7);
+  const int b2 = mul(A4, a5) - b0 + b1;
+  const int b3 = mul(A1, a6 - a4) - b2;
+  const int b4 = mul(A2, a7) + b3 - b1;
+  dest[d0] = munge(a0+a2   +b0);
+  dest[d1] = munge(a1+a3-a2+b2);
+  dest[d2] = munge(a1-a3+a2+b3);
+  dest[d3] = munge(a0-a2   -b4);
+  dest[d4] = munge(a0-a2   +b4);
+  dest[d5] = munge(a1-a3+a2-b3);
+  dest[d6] = munge(a1+a3-a2-b2);
+  dest[d7] = munge(a0+a2   -b0);
+  }
+
+template<class T>
+static void idctCol(T* dest, const int* src) {
+  static T (*munge)(int) = [](int x) -> T { return T(x); };
+  idctTransform(dest,src,0,8,16,24,32,40,48,56,0,8,16,24,32,40,48,56,munge);
+  }
+
+template<class T>
+static void idctRow(T* dest, const int* src) {
+  static T (*munge)(int) = [](int x) -> T { return T((x + 0x7F)>>8); };
+  idctTransform(dest,src,0,1,2,3,4,5,6,7,0,1,2,3,4,5,6,7,munge);
+  }
+
+static void bink_idct_col(int *dest, const int32_t *src) {
+  if((src[8]|src[16]|src[24]|src[32]|src[40]|src[48]|src[56])==0) {
+    dest[0]  =
+        dest[8]  =
+        dest[16] =
+        dest[24] =
+        dest[32] =
+        dest[40] =
+        dest[48] =
+        dest[56] = src[0];
+    } else {
+    idctCol(dest, src);
+    }
+  }
+#endif
+
+void Dsp::idctPut(uint8_t* dst, const int32_t* coef) {
+#if defined(BINK_DSP_SSE2)
+  __m128i rows[8];
+  idct8x8(coef,rows);
+  for(int i=0; i<8; ++i)
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst+i*8),_mm_packus_epi16(rows[i],rows[i]));
+#else
+  int temp[64]={};
+  for(int i=0; i<8; i++)
+    bink_idct_col(&temp[i], &coef[i]);
+  for(int i=0; i<8; i++)
+    idctRow(&dst[i*8], &temp[8*i]);
+#endif
+  }
+
+void Dsp::idctAdd(uint8_t* dst, const uint8_t* prev, const int32_t* coef) {
+#if defined(BINK_DSP_SSE2)
+  __m128i rows[8];
+  idct8x8(coef,rows);
+  for(int i=0; i<8; ++i)
+    addStore8(dst+i*8,prev+i*8,rows[i]);
+#else
+  int temp[64]={}, block[64]={};
+  for(int i=0; i<8; i++)
+    bink_idct_col(&temp[i], &coef[i]);
+  for(int i=0; i<8; i++)
+    idctRow(&block[i*8], &temp[8*i]);
+  for(int i=0; i<64; ++i)
+    dst[i] = uint8_t(prev[i]+block[i]);
+#endif
+  }
+
+void Dsp::residueAdd(uint8_t* dst, const uint8_t* prev, const int16_t* residue) {
+#if defined(BINK_DSP_SSE2)
+  for(int i=0; i<8; ++i)
+    addStore8(dst+i*8,prev+i*8,_mm_loadu_si128(reinterpret_cast<const __m128i*>(residue+i*8)));
+#else
+  for(int i=0; i<64; ++i)
+    dst[i] = uint8_t(prev[i]+residue[i]);
+#endif
+  }
+
+void Dsp::copy8x8(uint8_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride) {
+  // fixed-size memcpy is a single 64-bit move
+  for(int i=0; i<8; ++i)
+    std::memcpy(dst+size_t(i)*dstStride,src+size_t(i)*srcStride,8);
+  }
+
+void Dsp::scale8x8(uint8_t* dst, size_t dstStride, const uint8_t* src) {
+#if defined(BINK_DSP_SSE2)
+  for(int i=0; i<8; ++i) {
+    const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src+i*8));
+    const __m128i d = _mm_unpacklo_epi8(v,v);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+size_t(i*2  )*dstStride),d);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+size_t(i*2+1)*dstStride),d);
+    }
+#else
+  for(size_t y=0; y<16; ++y) {
+    const uint8_t* s = src+(y/2)*8;
+    for(size_t x=0; x<16; ++x)
+      dst[x + y*dstStride] = s[x/2];
+    }
+#endif
+  }
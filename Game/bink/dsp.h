@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Bink {
+
+// 8x8 block kernels of decoder. Blocks are 64 values with stride 8, unless stride is given.
+// SSE2 and scalar paths produce bit-identical results.
+namespace Dsp {
+
+// inverse dct of coef, result truncated to 8 bit
+void idctPut    (uint8_t* dst, const int32_t* coef);
+// inverse dct of coef, added to prediction with 8-bit wraparound
+void idctAdd    (uint8_t* dst, const uint8_t* prev, const int32_t* coef);
+// residue added to prediction with 8-bit wraparound
+void residueAdd (uint8_t* dst, const uint8_t* prev, const int16_t* residue);
+
+void copy8x8    (uint8_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride);
+// 8x8 block upscaled 2x into 16x16 area of dst
+void scale8x8   (uint8_t* dst, size_t dstStride, const uint8_t* src);
+
+}
+}
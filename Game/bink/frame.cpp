@@ -1,5 +1,7 @@
 #include "frame.h"
 
+#include "dsp.h"
+
 #include <algorithm>
 #include <cstring>
 
@@ -16,13 +18,7 @@ void Frame::Plane::setSize(uint32_t iw, uint32_t ih) {
   }
 
 void Frame::Plane::getPixels8x8(uint32_t rx, uint32_t ry, uint8_t* out) const {
-  const uint8_t* d = dat.data();
-
-  for(uint32_t y=0; y<8; ++y) {
-    for(uint32_t x=0; x<8; ++x) {
-      out[x+y*8] = d[(x+rx) + (y+ry)*stride];
-      }
-    }
+  Dsp::copy8x8(out,8,dat.data()+rx+ry*stride,stride);
   }
 
 void Frame::Plane::getBlock8x8(uint32_t bx, uint32_t by, uint8_t* out) const {
@@ -30,23 +26,11 @@ void Frame::Plane::getBlock8x8(uint32_t bx, uint32_t by, uint8_t* out) const {
   }
 
 void Frame::Plane::putBlock8x8(uint32_t bx, uint32_t by, const uint8_t* in) {
-  uint8_t* d = dat.data();
-
-  for(uint32_t y=0; y<8; ++y) {
-    for(uint32_t x=0; x<8; ++x) {
-      d[(x+bx*8) + (y+by*8)*stride] = in[x+y*8];
-      }
-    }
+  Dsp::copy8x8(dat.data()+bx*8+by*8*stride,stride,in,8);
   }
 
 void Frame::Plane::putScaledBlock(uint32_t bx, uint32_t by, const uint8_t* in) {
-  uint8_t* d = dat.data();
-  for(uint32_t y=0; y<16; ++y) {
-    uint32_t y2 = y/2;
-    for(uint32_t x=0; x<16; ++x) {
-      d[(x+bx*8) + (y+by*8)*stride] = in[(x/2)+y2*8];
-      }
-    }
+  Dsp::scale8x8(dat.data()+bx*8+by*8*stride,stride,in);
   }
 
 void Frame::Plane::fill(uint8_t v) {
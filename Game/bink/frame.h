@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <vector>
 #include <cstdint>
 
@@ -24,6 +25,9 @@ class Frame final {
 
         uint8_t        at(uint32_t x, uint32_t y) const;
         const uint8_t* data() const { return dat.data(); }
+        uint32_t       width()  const { return w;      }
+        uint32_t       height() const { return h;      }
+        uint32_t       bytesPerLine() const { return stride; }
 
       private:
         void setSize(uint32_t w, uint32_t h);
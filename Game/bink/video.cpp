@@ -7,8 +7,31 @@
 #include <algorithm>
 #include <limits>
 
+#include "dsp.h"
+
+#if defined(BINK_PROFILE)
+#include <chrono>
+#endif
+
 using namespace Bink;
 
+#if defined(BINK_PROFILE)
+namespace {
+struct ProfileScope final {
+  explicit ProfileScope(uint64_t& dst):dst(dst), start(std::chrono::steady_clock::now()) {}
+  ~ProfileScope() {
+    auto dt = std::chrono::steady_clock::now()-start;
+    dst += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(dt).count());
+    }
+  uint64_t&                             dst;
+  std::chrono::steady_clock::time_point start;
+  };
+}
+#define BINK_PROFILE_SCOPE(stage) ProfileScope profile_##stage(prof.stage)
+#else
+#define BINK_PROFILE_SCOPE(stage)
+#endif
+
 static const float    sqrthalf = std::sqrt(0.5f);
 
 static const uint16_t ff_wma_critical_freqs[25] = {
@@ -571,69 +594,6 @@ static int av_log2(unsigned v) {
   return int(std::log2(v));
   }
 
-template<class T>
-static void idctTransform(T* dest, const int* src,
-                          int s0, int s1, int s2, int s3, int s4, int s5, int s6, int s7,
-                          int d0, int d1, int d2, int d3, int d4, int d5, int d6, int d7,
-                          T (*munge)(int)) {
-  enum {
-    A1 = 2896, /* (1/sqrt(2))<<12 */
-    A2 = 2217,
-    A3 = 3784,
-    A4 = -5352
-    };
-  static int (*mul)(int,int) = [](int x,int y) -> int { return int(uint32_t(x)*uint32_t(y)) >> 11; };
-
-  const int a0 = (src)[s0] + (src)[s4];
-  const int a1 = (src)[s0] - (src)[s4];
-  const int a2 = (src)[s2] + (src)[s6];
-  const int a3 = mul(A1, (src)[s2] - (src)[s6]);
-  const int a4 = (src)[s5] + (src)[s3];
-  const int a5 = (src)[s5] - (src)[s3];
-  const int a6 = (src)[s1] + (src)[s7];
-  const int a7 = (src)[s1] - (src)[s7];
-  const int b0 = a4 + a6;
-  const int b1 = mul(A3, a5 + a7);
-  const int b2 = mul(A4, a5) - b0 + b1;
-  const int b3 = mul(A1, a6 - a4) - b2;
-  const int b4 = mul(A2, a7) + b3 - b1;
-  dest[d0] = munge(a0+a2   +b0);
-  dest[d1] = munge(a1+a3-a2+b2);
-  dest[d2] = munge(a1-a3+a2+b3);
-  dest[d3] = munge(a0-a2   -b4);
-  dest[d4] = munge(a0-a2   +b4);
-  dest[d5] = munge(a1-a3+a2-b3);
-  dest[d6] = munge(a1+a3-a2-b2);
-  dest[d7] = munge(a0+a2   -b0);
-  }
-
-template<class T>
-static void idctCol(T* dest, const int* src) {
-  static T (*munge)(int) = [](int x) -> T { return T(x); };
-  idctTransform(dest,src,0,8,16,24,32,40,48,56,0,8,16,24,32,40,48,56,munge);
-  }
-
-template<class T>
-static void idctRow(T* dest, const int* src) {
-  static T (*munge)(int) = [](int x) -> T { return T((x + 0x7F)>>8); };
-  idctTransform(dest,src,0,1,2,3,4,5,6,7,0,1,2,3,4,5,6,7,munge);
-  }
-
-static void bink_idct_col(int *dest, const int32_t *src) {
-  if((src[8]|src[16]|src[24]|src[32]|src[40]|src[48]|src[56])==0) {
-    dest[0]  =
-        dest[8]  =
-        dest[16] =
-        dest[24] =
-        dest[32] =
-        dest[40] =
-        dest[48] =
-        dest[56] = src[0];
-    } else {
-    idctCol(dest, src);
-    }
-  }
-
 template<class T>
 static void BF(T& x, T& y, const T& a, const T& b) {
   x = a-b;
@@ -923,6 +883,7 @@ Video::~Video() {
 const Frame& Video::nextFrame() {
   if(frameCounter==index.size())
     return frames[frameCounter%2];
+  BINK_PROFILE_SCOPE(total);
   try {
     readPacket();
     }
@@ -966,7 +927,11 @@ void Video::readPacket() {
       }
     if(audioSize >= 4) { // This doesn't look good
       packet.resize(audioSize);
+      {
+      BINK_PROFILE_SCOPE(packet);
       fin->read(packet.data(),packet.size());
+      }
+      BINK_PROFILE_SCOPE(audio);
       parseAudio(packet,i);
       } else {
       fin->skip(audioSize);
@@ -976,7 +941,10 @@ void Video::readPacket() {
     }
 
   packet.resize(videoSize);
+  {
+  BINK_PROFILE_SCOPE(packet);
   fin->read(packet.data(),packet.size());
+  }
   parseFrame(packet);
   }
 
@@ -1178,11 +1146,16 @@ void Video::decodePlane(BitStream& gb, int planeId, bool chroma) {
     }
 
   initLengths(std::max(width,8),bw);
+  {
+  BINK_PROFILE_SCOPE(bundles);
   for(int i=0; i<BINK_NB_SRC; i++)
     readBundle(gb,i);
+  }
 
   uint8_t dst[8*8] = {};
   for(int by = 0; by < bh; by++) {
+    {
+    BINK_PROFILE_SCOPE(bundles);
     readBlockTypes  (gb,bundle[BINK_SRC_BLOCK_TYPES]);
     readBlockTypes  (gb,bundle[BINK_SRC_SUB_BLOCK_TYPES]);
     readColors      (gb,bundle[BINK_SRC_COLORS]);
@@ -1192,6 +1165,7 @@ void Video::decodePlane(BitStream& gb, int planeId, bool chroma) {
     readDcs         (gb,bundle[BINK_SRC_INTRA_DC], DC_START_BITS, 0);
     readDcs         (gb,bundle[BINK_SRC_INTER_DC], DC_START_BITS, 1);
     readRuns        (gb,bundle[BINK_SRC_RUN]);
+    }
 
     for(int bx=0; bx<bw; ++bx) {
       BlockTypes blk = BlockTypes(getValue(BINK_SRC_BLOCK_TYPES));
@@ -1210,9 +1184,11 @@ void Video::decodePlane(BitStream& gb, int planeId, bool chroma) {
       switch(blk) {
         case SCALED_BLOCK:
           throw VideoDecodingException("unsupported type of superblock");
-        case SKIP_BLOCK:
+        case SKIP_BLOCK: {
+          BINK_PROFILE_SCOPE(motion);
           last.getBlock8x8(bx,by,dst);
           break;
+          }
         case FILL_BLOCK:    {
           const uint8_t v = uint8_t(getValue(BINK_SRC_COLORS));
           std::memset(dst,v,sizeof(dst));
@@ -1222,47 +1198,43 @@ void Video::decodePlane(BitStream& gb, int planeId, bool chroma) {
           uint8_t prev[8*8] = {};
           const int xoff = getValue(BINK_SRC_X_OFF);
           const int yoff = getValue(BINK_SRC_Y_OFF);
+          {
+          BINK_PROFILE_SCOPE(motion);
           last.getPixels8x8(bx*8+xoff, by*8+yoff, prev);
+          }
 
           int16_t block[64] = {};
           int v = gb.getBits(7);
           readResidue(gb,block,v);
-          for(int i=0; i<64; ++i)
-            dst[i] = uint8_t(prev[i]+block[i]);
+          Dsp::residueAdd(dst,prev,block);
           break;
           }
         case INTRA_BLOCK:   {
+          BINK_PROFILE_SCOPE(idct);
           int32_t dctblock[64] = {};
           dctblock[0] = getValue(BINK_SRC_INTRA_DC);
           int coef_count=0, coef_idx[64]={};
           int quant_idx = readDctCoeffs(gb, dctblock, bink_scan, coef_count, coef_idx, -1);
           unquantizeDctCoeffs(dctblock, bink_intra_quant[quant_idx], coef_count, coef_idx, bink_scan);
-          int temp[64]={};
-          for(int i=0; i<8; i++)
-            bink_idct_col(&temp[i], &dctblock[i]);
-          for(int i=0; i<8; i++)
-            idctRow(&dst[i*8], &temp[8*i]);
+          Dsp::idctPut(dst,dctblock);
           break;
           }
         case INTER_BLOCK:   {
           uint8_t prev[8*8] = {};
           const int xoff = getValue(BINK_SRC_X_OFF);
           const int yoff = getValue(BINK_SRC_Y_OFF);
+          {
+          BINK_PROFILE_SCOPE(motion);
           last.getPixels8x8(bx*8+xoff, by*8+yoff, prev);
+          }
 
+          BINK_PROFILE_SCOPE(idct);
           int32_t dctblock[64] = {};
           dctblock[0] = getValue(BINK_SRC_INTER_DC);
           int coef_count=0, coef_idx[64]={};
           int quant_idx = readDctCoeffs(gb, dctblock, bink_scan, coef_count, coef_idx, -1);
           unquantizeDctCoeffs(dctblock, bink_inter_quant[quant_idx], coef_count, coef_idx, bink_scan);
-
-          int temp[64]={};
-          for(int i=0; i<8; i++)
-            bink_idct_col(&temp[i], &dctblock[i]);
-          for(int i = 0; i < 8; i++)
-            idctRow(&dctblock[i*8], &temp[8*i]);
-          for(int i=0; i<64; ++i)
-            dst[i] = uint8_t(prev[i]+dctblock[i]);
+          Dsp::idctAdd(dst,prev,dctblock);
           break;
           }
         case RUN_BLOCK:     {
@@ -1291,6 +1263,7 @@ void Video::decodePlane(BitStream& gb, int planeId, bool chroma) {
             throw VideoDecodingException("unsupported type of superblock");
           const int xoff = getValue(BINK_SRC_X_OFF);
           const int yoff = getValue(BINK_SRC_Y_OFF);
+          BINK_PROFILE_SCOPE(motion);
           last.getPixels8x8(bx*8+xoff, by*8+yoff, dst);
           break;
           }
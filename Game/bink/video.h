@@ -49,6 +49,16 @@ class Video final {
       bool     isMono     = false;
       };
 
+    // accumulated decoding time per stage, in nanoseconds; collected only, if compiled with BINK_PROFILE
+    struct Profile {
+      uint64_t packet  = 0; // reading packets from input
+      uint64_t bundles = 0; // huffman trees and bundle data
+      uint64_t idct    = 0; // dct coefficients and inverse transform
+      uint64_t motion  = 0; // block copies from previous frame
+      uint64_t audio   = 0; // audio packets
+      uint64_t total   = 0;
+      };
+
     explicit Video(Input* file);
     Video(const Video&) = delete;
     ~Video();
@@ -58,9 +68,11 @@ class Video final {
     size_t       currentFrame() const { return frameCounter; }
 
     const FrameRate& fps() const { return fRate; }
+    bool             hasAlpha() const { return (flags&BINK_FLAG_ALPHA)==BINK_FLAG_ALPHA; }
 
     size_t       audioCount()     const { return aud.size(); }
     const Audio& audio(uint8_t i) const { return audProp[i]; }
+    const Profile& profile()      const { return prof; }
 
     struct FFTComplex final {
       float re, im;
@@ -234,6 +246,8 @@ class Video final {
 
     // sound
     float                   quantTable[96] = {};
+
+    Profile                 prof;
   };
 
 }
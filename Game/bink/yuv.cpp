@@ -0,0 +1,114 @@
+#include "yuv.h"
+
+#include <cstring>
+
+#include "frame.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#include <emmintrin.h>
+#define BINK_YUV_SSE2
+#endif
+
+using namespace Bink;
+
+// BT.601 coefficients in 3.13 fixed point: 1.164, 1.596, 0.813, 0.391, 2.018
+static const int     FracBits = 13;
+static const int32_t CY  = 9535;
+static const int32_t CRV = 13074;
+static const int32_t CGV = 6660;
+static const int32_t CGU = 3203;
+static const int32_t CBU = 16531;
+
+static uint8_t clamp8(int32_t v) {
+  return uint8_t(v<0 ? 0 : (v>255 ? 255 : v));
+  }
+
+static void convertPixel(uint8_t* rgba, int32_t y, int32_t u, int32_t v, uint8_t a) {
+  const int32_t yy = CY*(y-16);
+  u -= 128;
+  v -= 128;
+  rgba[0] = clamp8((yy + CRV*v)         >> FracBits);
+  rgba[1] = clamp8((yy - CGV*v - CGU*u) >> FracBits);
+  rgba[2] = clamp8((yy + CBU*u)         >> FracBits);
+  rgba[3] = a;
+  }
+
+#if defined(BINK_YUV_SSE2)
+static __m128i coef(int32_t lo, int32_t hi) {
+  return _mm_set1_epi32(int32_t(uint32_t(uint16_t(lo)) | (uint32_t(uint16_t(hi))<<16)));
+  }
+
+// 8 pixels of one row; ud/vd are chroma values, already duplicated per pixel pair and biased by -128
+static void convert8(uint8_t* rgba, const uint8_t* py, const uint8_t* pa, __m128i ud, __m128i vd) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ys   = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(py)),zero),
+                                     _mm_set1_epi16(16));
+
+  const __m128i yvLo = _mm_unpacklo_epi16(ys,vd), yvHi = _mm_unpackhi_epi16(ys,vd);
+  const __m128i yuLo = _mm_unpacklo_epi16(ys,ud), yuHi = _mm_unpackhi_epi16(ys,ud);
+  const __m128i u0Lo = _mm_unpacklo_epi16(ud,zero), u0Hi = _mm_unpackhi_epi16(ud,zero);
+
+  const __m128i cR  = coef(CY, CRV);
+  const __m128i cG  = coef(CY,-CGV);
+  const __m128i cGu = coef(-CGU,0);
+  const __m128i cB  = coef(CY, CBU);
+
+  const __m128i r = _mm_packs_epi32(_mm_srai_epi32(_mm_madd_epi16(yvLo,cR),FracBits),
+                                    _mm_srai_epi32(_mm_madd_epi16(yvHi,cR),FracBits));
+  const __m128i g = _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yvLo,cG),_mm_madd_epi16(u0Lo,cGu)),FracBits),
+                                    _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yvHi,cG),_mm_madd_epi16(u0Hi,cGu)),FracBits));
+  const __m128i b = _mm_packs_epi32(_mm_srai_epi32(_mm_madd_epi16(yuLo,cB),FracBits),
+                                    _mm_srai_epi32(_mm_madd_epi16(yuHi,cB),FracBits));
+
+  // unsigned saturation does the clamp to [0..255]
+  const __m128i r8 = _mm_packus_epi16(r,r);
+  const __m128i g8 = _mm_packus_epi16(g,g);
+  const __m128i b8 = _mm_packus_epi16(b,b);
+  const __m128i a8 = pa!=nullptr ? _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pa)) : _mm_set1_epi8(char(0xFF));
+
+  const __m128i rg = _mm_unpacklo_epi8(r8,g8);
+  const __m128i ba = _mm_unpacklo_epi8(b8,a8);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba),   _mm_unpacklo_epi16(rg,ba));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba)+1, _mm_unpackhi_epi16(rg,ba));
+  }
+
+static __m128i loadChroma4(const uint8_t* p) {
+  int32_t v = 0;
+  std::memcpy(&v,p,sizeof(v));
+  const __m128i c = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(v),_mm_setzero_si128()),_mm_set1_epi16(128));
+  return _mm_unpacklo_epi16(c,c);
+  }
+#endif
+
+void Bink::yuvToRgba(const Frame& f, bool alpha, uint8_t* dst, size_t dstStride, uint32_t rowBegin, uint32_t rowEnd) {
+  auto& planeY = f.plane(0);
+  auto& planeU = f.plane(1);
+  auto& planeV = f.plane(2);
+  auto& planeA = f.plane(3);
+
+  const uint32_t w = f.width();
+  if(rowEnd>f.height())
+    rowEnd = f.height();
+
+  // row pairs share one chroma row
+  for(uint32_t y=rowBegin; y<rowEnd; y+=2) {
+    const uint8_t* pu = planeU.data() + (y/2)*planeU.bytesPerLine();
+    const uint8_t* pv = planeV.data() + (y/2)*planeV.bytesPerLine();
+    const uint32_t rows = (y+1<rowEnd) ? 2 : 1;
+
+    for(uint32_t i=0; i<rows; ++i) {
+      const uint8_t* py  = planeY.data() + (y+i)*planeY.bytesPerLine();
+      const uint8_t* pa  = alpha ? planeA.data() + (y+i)*planeA.bytesPerLine() : nullptr;
+      uint8_t*       out = dst + (y+i)*dstStride;
+
+      uint32_t x = 0;
+#if defined(BINK_YUV_SSE2)
+      for(; x+8<=w; x+=8) {
+        convert8(out+x*4, py+x, pa!=nullptr ? pa+x : nullptr, loadChroma4(pu+x/2), loadChroma4(pv+x/2));
+        }
+#endif
+      for(; x<w; ++x)
+        convertPixel(out+x*4, py[x], pu[x/2], pv[x/2], pa!=nullptr ? pa[x] : 255);
+      }
+    }
+  }
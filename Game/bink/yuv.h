@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Bink {
+
+class Frame;
+
+// YUV420 (or YUVA420, if alpha is true) to RGBA8 conversion, BT.601 studio range.
+// Converts rows [rowBegin, rowEnd) of frame into dst; rowBegin must be even, so range can be split across threads.
+// Fixed-point math: result is within 1 of float reference, and same for SSE2 and scalar paths.
+void yuvToRgba(const Frame& f, bool alpha, uint8_t* dst, size_t dstStride, uint32_t rowBegin, uint32_t rowEnd);
+
+}
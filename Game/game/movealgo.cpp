@@ -283,6 +283,33 @@ void MoveAlgo::tickSwim(uint64_t dt) {
     tryMove(dp.x,dp.y,dp.z);
   }
 
+void MoveAlgo::prefetch(uint64_t dt) const {
+  // same probes, as walking branch of 'tick' does; 'tick' reuses them, if position is not altered by script
+  prefetched = Prefetch();
+  if(npc.interactive()!=nullptr || isClimb() || isJumpup() || isSwim() || isInAir() || isSlide())
+    return;
+
+  auto  dp            = skipMove+npcMoveSpeed(dt,NoFlag);
+  auto  pos           = npc.position();
+  float fallThreshold = stepHeight();
+  auto& p             = prefetched;
+
+  p.x = pos.x+dp.x;
+  p.y = pos.y+dp.y+fallThreshold;
+  p.z = pos.z+dp.z;
+  auto ret = npc.world().physic()->dropRay(p.x,p.y,p.z);
+  p.ground = ret.y();
+  p.mat    = ret.mat;
+  p.sector = ret.sector;
+  p.hasCol = ret.hasCol;
+  p.norm   = ret.n;
+
+  p.wx = pos.x+dp.x;
+  p.wy = pos.y+dp.y;
+  p.wz = pos.z+dp.z;
+  p.wdepth = npc.world().physic()->waterRay(p.wx,p.wy,p.wz).y();
+  }
+
 void MoveAlgo::tick(uint64_t dt, MvFlags moveFlg) {
   if(npc.interactive()!=nullptr)
     return tickMobsi(dt);
@@ -429,7 +456,7 @@ Tempest::Vec3 MoveAlgo::animMoveSpeed(uint64_t dt) const {
   return ret;
   }
 
-Tempest::Vec3 MoveAlgo::npcMoveSpeed(uint64_t dt,MvFlags moveFlg) {
+Tempest::Vec3 MoveAlgo::npcMoveSpeed(uint64_t dt,MvFlags moveFlg) const {
   Tempest::Vec3 dp = animMoveSpeed(dt);
   if(!npc.isJumpAnim())
     dp.y = 0.f;
@@ -451,11 +478,11 @@ Tempest::Vec3 MoveAlgo::npcMoveSpeed(uint64_t dt,MvFlags moveFlg) {
   return dp;
   }
 
-Tempest::Vec3 MoveAlgo::go2NpcMoveSpeed(const Tempest::Vec3& dp,const Npc& tg) {
+Tempest::Vec3 MoveAlgo::go2NpcMoveSpeed(const Tempest::Vec3& dp,const Npc& tg) const {
   return go2WpMoveSpeed(dp,tg.position().x,tg.position().z);
   }
 
-Tempest::Vec3 MoveAlgo::go2WpMoveSpeed(Tempest::Vec3 dp, float x, float z) {
+Tempest::Vec3 MoveAlgo::go2WpMoveSpeed(Tempest::Vec3 dp, float x, float z) const {
   float dx   = x-npc.position().x;
   float dz   = z-npc.position().z;
   float qLen = (dx*dx+dz*dz);
@@ -754,20 +781,31 @@ void MoveAlgo::onMoveFailed() {
 
 float MoveAlgo::dropRay(float x, float y, float z, bool &hasCol) const {
   if(std::fabs(cache.x-x)>eps || std::fabs(cache.y-y)>eps || std::fabs(cache.z-z)>eps) {
-    auto ret         = npc.world().physic()->dropRay(x,y,z);
+    auto& p = prefetched;
+    if(p.x!=x || p.y!=y || p.z!=z) {
+      auto ret = npc.world().physic()->dropRay(x,y,z);
+      p.ground = ret.y();
+      p.mat    = ret.mat;
+      p.sector = ret.sector;
+      p.hasCol = ret.hasCol;
+      p.norm   = ret.n;
+      }
+    // consumed: prefetched probe is used at most once
+    p.z = std::numeric_limits<float>::infinity();
+
     cache.x          = x;
     cache.y          = y;
     cache.z          = z;
-    cache.rayCastRet = ret.y();
-    cache.mat        = ret.mat;
-    cache.portalName = ret.sector!=nullptr ? ret.sector : cache.portalName;
-    cache.hasCol     = ret.hasCol;
-    if(ret.hasCol) {
+    cache.rayCastRet = p.ground;
+    cache.mat        = p.mat;
+    cache.portalName = p.sector!=nullptr ? p.sector : cache.portalName;
+    cache.hasCol     = p.hasCol;
+    if(p.hasCol) {
       // store also normal
       cache.nx   = x;
       cache.ny   = y;
       cache.nz   = z;
-      cache.norm = ret.n;
+      cache.norm = p.norm;
       }
     }
   hasCol = cache.hasCol;
@@ -776,11 +814,15 @@ float MoveAlgo::dropRay(float x, float y, float z, bool &hasCol) const {
 
 float MoveAlgo::waterRay(float x, float y, float z) const {
   if(std::fabs(cache.wx-x)>eps || std::fabs(cache.wy-y)>eps || std::fabs(cache.wz-z)>eps) {
-    auto ret     = npc.world().physic()->waterRay(x,y,z);
+    auto& p = prefetched;
+    if(p.wx!=x || p.wy!=y || p.wz!=z)
+      p.wdepth = npc.world().physic()->waterRay(x,y,z).y();
+    p.wz = std::numeric_limits<float>::infinity();
+
     cache.wx     = x;
     cache.wy     = y;
     cache.wz     = z;
-    cache.wdepth = ret.y();
+    cache.wdepth = p.wdepth;
     }
   return cache.wdepth;
   }
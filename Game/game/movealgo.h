@@ -39,6 +39,8 @@ class MoveAlgo final {
     void    save(Serialize& fout) const;
 
     void    tick(uint64_t dt,MvFlags fai=NoFlag);
+    // speculative ground/water probes for next tick; const with respect to simulation state
+    void    prefetch(uint64_t dt) const;
 
     void    multSpeed(float s){ mulSpeed=s; }
     void    clearSpeed();
@@ -99,9 +101,9 @@ class MoveAlgo final {
     void    onMoveFailed();
     void    applyRotation(Tempest::Vec3& out, const Tempest::Vec3& in) const;
     auto    animMoveSpeed(uint64_t dt) const -> Tempest::Vec3;
-    auto    npcMoveSpeed (uint64_t dt, MvFlags moveFlg) -> Tempest::Vec3;
-    auto    go2NpcMoveSpeed (const Tempest::Vec3& dp, const Npc &tg) -> Tempest::Vec3;
-    auto    go2WpMoveSpeed  (Tempest::Vec3 dp, float x, float z) -> Tempest::Vec3;
+    auto    npcMoveSpeed (uint64_t dt, MvFlags moveFlg) const -> Tempest::Vec3;
+    auto    go2NpcMoveSpeed (const Tempest::Vec3& dp, const Npc &tg) const -> Tempest::Vec3;
+    auto    go2WpMoveSpeed  (Tempest::Vec3 dp, float x, float z) const -> Tempest::Vec3;
     bool    testSlide(float x, float y, float z) const;
     bool    testClimp(float scale) const;
 
@@ -132,8 +134,22 @@ class MoveAlgo final {
       float wdepth=0.f;
       };
 
+    // speculative probes from parallel pre-tick: moved into cache by serial tick, only at exactly same position
+    struct Prefetch {
+      float         x=0,y=0,z=std::numeric_limits<float>::infinity();
+      float         ground = 0;
+      uint8_t       mat    = 0;
+      const char*   sector = nullptr;
+      bool          hasCol = false;
+      Tempest::Vec3 norm   = {};
+
+      float         wx=0,wy=0,wz=std::numeric_limits<float>::infinity();
+      float         wdepth = 0;
+      };
+
     Npc&                npc;
     mutable Cache       cache;
+    mutable Prefetch    prefetched;
     Flags               flags=NoFlags;
 
     float               mulSpeed  =1.f;
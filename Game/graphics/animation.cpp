@@ -174,25 +174,55 @@ Animation::Animation(ZenLoad::MdsParser &p,const std::string& name,const bool ig
   }
 
 const Animation::Sequence* Animation::sequence(const char *name) const {
-  auto it = std::lower_bound(sequences.begin(),sequences.end(),name,[](const Sequence& s,const char* n){
-    return s.name<n;
-    });
-
-  if(it!=sequences.end() && it->name==name)
-    return &(*it);
-  return nullptr;
+  return find(byName,&Sequence::name,name);
   }
 
 const Animation::Sequence *Animation::sequenceAsc(const char *name) const {
   if(auto s = sequence(name))
     return s; //gothic2 format
+  return find(byAsc,&Sequence::askName,name);
+  }
 
-  auto it = std::lower_bound(sequences.begin(),sequences.end(),name,[](const Sequence& s,const char* n){
-    return s.askName<n;
-    });
+uint32_t Animation::nameHash(const char* name) {
+  // FNV-1a
+  uint32_t h = 2166136261u;
+  for(;*name;++name) {
+    h ^= uint8_t(*name);
+    h *= 16777619u;
+    }
+  return h;
+  }
 
-  if(it!=sequences.end() && it->askName==name)
-    return &(*it);
+void Animation::mkIndex(Index& ind, std::string Sequence::*key) {
+  size_t cap = 16;
+  while(cap<sequences.size()*2)
+    cap*=2;
+  ind.slot.assign(cap,Index::Slot());
+
+  const size_t mask = cap-1;
+  for(size_t i=0;i<sequences.size();++i) {
+    auto& name = sequences[i].*key;
+    if(name.empty() || find(ind,key,name.c_str())!=nullptr)
+      continue; // first sequence wins, for duplicated names
+    const uint32_t h = nameHash(name.c_str());
+    size_t at = h&mask;
+    while(ind.slot[at].id!=0)
+      at = (at+1)&mask;
+    ind.slot[at].hash = h;
+    ind.slot[at].id   = uint32_t(i+1);
+    }
+  }
+
+const Animation::Sequence* Animation::find(const Index& ind, std::string Sequence::*key, const char* name) const {
+  if(name==nullptr || name[0]=='\0' || ind.slot.size()==0)
+    return nullptr;
+  const size_t   mask = ind.slot.size()-1;
+  const uint32_t h    = nameHash(name);
+  for(size_t at=h&mask; ind.slot[at].id!=0; at=(at+1)&mask) {
+    auto& s = ind.slot[at];
+    if(s.hash==h && sequences[s.id-1].*key==name)
+      return &sequences[s.id-1];
+    }
   return nullptr;
   }
 
@@ -238,6 +268,8 @@ void Animation::setupIndex() {
   std::sort(sequences.begin(),sequences.end(),[](const Sequence& a,const Sequence& b){
     return a.name<b.name;
     });
+  mkIndex(byName,&Sequence::name);
+  mkIndex(byAsc, &Sequence::askName);
 
   for(auto& s:sequences) {
     if(s.comb.size()==0)
@@ -283,6 +315,7 @@ Animation::Sequence::Sequence(const std::string &fname) {
     switch(type) {
       case ZenLoad::ModelAnimationParser::CHUNK_EOF:{
         setupMoveTr();
+        data->setupSoA();
         return;
         }
       case ZenLoad::ModelAnimationParser::CHUNK_HEADER: {
@@ -638,6 +671,32 @@ void Animation::AnimData::setupMoveTr() {
     }
   }
 
+void Animation::AnimData::setupSoA() {
+  const size_t sz = nodeIndex.size();
+  if(sz==0 || samples.size()%sz!=0)
+    return;
+
+  // stride is padded to multiple of 4, so simd kernels may read whole vectors
+  const size_t frames = samples.size()/sz;
+  soaStride = (sz+3)&~size_t(3);
+  soa.assign(frames*soaStride*7,0.f);
+
+  for(size_t f=0; f<frames; ++f) {
+    float* dst = &soa[f*soaStride*7];
+    for(size_t i=0; i<sz; ++i) {
+      auto& s = samples[f*sz+i];
+      dst[soaStride*0+i] = s.rotation.x;
+      dst[soaStride*1+i] = s.rotation.y;
+      dst[soaStride*2+i] = s.rotation.z;
+      dst[soaStride*3+i] = s.rotation.w;
+      dst[soaStride*4+i] = s.position.x;
+      dst[soaStride*5+i] = s.position.y;
+      dst[soaStride*6+i] = s.position.z;
+      }
+    }
+  samples = std::vector<ZenLoad::zCModelAniSample>();
+  }
+
 void Animation::AnimData::setupEvents(float fpsRate) {
   if(fpsRate<=0.f)
     return;
@@ -43,7 +43,9 @@ class Animation final {
       Tempest::Vec3                               translate={};
       Tempest::Vec3                               moveTr={};
 
-      std::vector<ZenLoad::zCModelAniSample>      samples;
+      std::vector<ZenLoad::zCModelAniSample>      samples;   // released, once 'soa' is built
+      std::vector<float>                          soa;       // per frame: qx,qy,qz,qw,px,py,pz streams of 'soaStride' floats
+      size_t                                      soaStride=0;
       std::vector<uint32_t>                       nodeIndex;
       std::vector<Tempest::Vec3>                  tr;
       bool                                        hasMoveTr=false;
@@ -64,6 +66,7 @@ class Animation final {
       std::vector<uint64_t>                       defWindow;
 
       void                                        setupMoveTr();
+      void                                        setupSoA();
       void                                        setupEvents(float fpsRate);
       };
 
@@ -119,9 +122,23 @@ class Animation final {
     void            debug() const;
 
   private:
+    // open addressing hash table over 'sequences'
+    struct Index final {
+      struct Slot {
+        uint32_t hash = 0;
+        uint32_t id   = 0; // 1-based index in sequences, 0 - empty
+        };
+      std::vector<Slot> slot;
+      };
+
     Sequence& loadMAN(const std::string &name);
     void      setupIndex();
+    void      mkIndex(Index& ind, std::string Sequence::*key);
+    auto      find(const Index& ind, std::string Sequence::*key, const char* name) const -> const Sequence*;
+
+    static uint32_t nameHash(const char* name);
 
     std::vector<Sequence>                       sequences;
     std::vector<ZenLoad::zCModelScriptAniAlias> ref;
+    Index                                       byName, byAsc;
   };
@@ -30,6 +30,7 @@ void AnimationSolver::load(Serialize &fin) {
     fin.read(s,i.time);
     i.skeleton = Resources::loadSkeleton(s.c_str());
     }
+  invalidateCache();
 
   sz=0;
   for(size_t i=0;i<overlay.size();++i){
@@ -42,6 +43,7 @@ void AnimationSolver::load(Serialize &fin) {
 
 void AnimationSolver::setSkeleton(const Skeleton *sk) {
   baseSk = sk;
+  invalidateCache();
   }
 
 bool AnimationSolver::hasOverlay(const Skeleton* sk) const {
@@ -58,6 +60,7 @@ void AnimationSolver::addOverlay(const Skeleton* sk,uint64_t time) {
   ov.skeleton = sk;
   ov.time     = time;
   overlay.push_back(ov);
+  invalidateCache();
   }
 
 void AnimationSolver::delOverlay(const char *sk) {
@@ -71,16 +74,24 @@ void AnimationSolver::delOverlay(const Skeleton *sk) {
   for(size_t i=0;i<overlay.size();++i)
     if(overlay[i].skeleton==sk){
       overlay.erase(overlay.begin()+int(i));
+      invalidateCache();
       return;
       }
   }
 
+void AnimationSolver::invalidateCache() {
+  frmCache.clear();
+  }
+
 void AnimationSolver::update(uint64_t tickCount) {
   for(size_t i=0;i<overlay.size();){
     auto& ov = overlay[i];
-    if(ov.time!=0 && ov.time<tickCount)
-      overlay.erase(overlay.begin()+int(i)); else
+    if(ov.time!=0 && ov.time<tickCount) {
+      overlay.erase(overlay.begin()+int(i));
+      invalidateCache();
+      } else {
       ++i;
+      }
     }
   }
 
@@ -343,6 +354,16 @@ const Animation::Sequence *AnimationSolver::solveAnim(Interactive *inter, Animat
   }
 
 const Animation::Sequence *AnimationSolver::solveFrm(const char *format, WeaponState st) const {
+  const FrmKey k = {format,st};
+  auto it = frmCache.find(k);
+  if(it!=frmCache.end())
+    return it->second;
+  auto ret = implSolveFrm(format,st);
+  frmCache[k] = ret;
+  return ret;
+  }
+
+const Animation::Sequence *AnimationSolver::implSolveFrm(const char *format, WeaponState st) const {
   static const char* weapon[] = {
     "",
     "FIST",
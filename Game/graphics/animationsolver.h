@@ -2,6 +2,7 @@
 
 #include <Tempest/Matrix4x4>
 #include <vector>
+#include <unordered_map>
 
 #include "world/gsoundeffect.h"
 #include "game/inventory.h"
@@ -87,11 +88,25 @@ class AnimationSolver final {
     const Animation::Sequence*     solveAnim(Interactive *inter, Anim a, const Pose &pose) const;
 
   private:
+    // formats are string literals - cache is keyed by pointer
+    struct FrmKey final {
+      const char* format = nullptr;
+      WeaponState st     = WeaponState::NoWeapon;
+      bool operator == (const FrmKey& other) const { return format==other.format && st==other.st; }
+      };
+    struct FrmHash final {
+      size_t operator()(const FrmKey& k) const { return std::hash<const void*>()(k.format)^size_t(k.st); }
+      };
+
     const Animation::Sequence*     solveFrm    (const char *format, WeaponState st) const;
+    const Animation::Sequence*     implSolveFrm(const char *format, WeaponState st) const;
+    void                           invalidateCache();
 
     const Animation::Sequence*     solveMag    (const char *format, const std::string& spell) const;
     const Animation::Sequence*     solveDead   (const char *format1, const char *format2) const;
 
     const Skeleton*                baseSk=nullptr;
     std::vector<Overlay>           overlay;
+
+    mutable std::unordered_map<FrmKey,const Animation::Sequence*,FrmHash> frmCache;
   };
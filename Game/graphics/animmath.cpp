@@ -2,6 +2,11 @@
 
 #include <cmath>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#include <emmintrin.h>
+#define ANIMMATH_SSE2
+#endif
+
 static float mix(float x,float y,float a){
   return x+(y-x)*a;
   }
@@ -95,3 +100,104 @@ Tempest::Matrix4x4 mkMatrix(const ZenLoad::zCModelAniSample& s) {
   return mkMatrix(s.rotation.x,s.rotation.y,s.rotation.z,s.rotation.w,
                   s.position.x,s.position.y,s.position.z);
   }
+
+static ZenLoad::zCModelAniSample loadSample(const float* s, size_t stride, size_t i) {
+  ZenLoad::zCModelAniSample r;
+  r.rotation.x = s[stride*0+i];
+  r.rotation.y = s[stride*1+i];
+  r.rotation.z = s[stride*2+i];
+  r.rotation.w = s[stride*3+i];
+  r.position.x = s[stride*4+i];
+  r.position.y = s[stride*5+i];
+  r.position.z = s[stride*6+i];
+  return r;
+  }
+
+#if defined(ANIMMATH_SSE2)
+// 4 bones at once; operation order matches scalar code, so results are bit-exact
+static void mixSamples4(const float* a, const float* b, size_t stride, size_t i, float t, size_t count,
+                        const uint32_t* nodeIndex, Tempest::Matrix4x4* out) {
+  const __m128 ax = _mm_loadu_ps(a+stride*0+i), bx = _mm_loadu_ps(b+stride*0+i);
+  const __m128 ay = _mm_loadu_ps(a+stride*1+i), by = _mm_loadu_ps(b+stride*1+i);
+  const __m128 az = _mm_loadu_ps(a+stride*2+i), bz = _mm_loadu_ps(b+stride*2+i);
+  const __m128 aw = _mm_loadu_ps(a+stride*3+i), bw = _mm_loadu_ps(b+stride*3+i);
+
+  __m128 dot = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ax,bx),_mm_mul_ps(ay,by)),_mm_mul_ps(az,bz)),_mm_mul_ps(aw,bw));
+  // flip q2, when quaternions are more than 90 degrees apart
+  const __m128 sign = _mm_and_ps(dot,_mm_set1_ps(-0.f));
+  dot = _mm_xor_ps(dot,sign);
+
+  const __m128 vt  = _mm_set1_ps(t);
+  const __m128 vt1 = _mm_set1_ps(1.f-t);
+  __m128 x = _mm_add_ps(_mm_mul_ps(ax,vt1),_mm_mul_ps(_mm_xor_ps(bx,sign),vt));
+  __m128 y = _mm_add_ps(_mm_mul_ps(ay,vt1),_mm_mul_ps(_mm_xor_ps(by,sign),vt));
+  __m128 z = _mm_add_ps(_mm_mul_ps(az,vt1),_mm_mul_ps(_mm_xor_ps(bz,sign),vt));
+  __m128 w = _mm_add_ps(_mm_mul_ps(aw,vt1),_mm_mul_ps(_mm_xor_ps(bw,sign),vt));
+
+  const __m128 l = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x,x),_mm_mul_ps(y,y)),_mm_mul_ps(z,z)),_mm_mul_ps(w,w)));
+  x = _mm_div_ps(x,l);
+  y = _mm_div_ps(y,l);
+  z = _mm_div_ps(z,l);
+  w = _mm_div_ps(w,l);
+
+  const __m128 two = _mm_set1_ps(2.f);
+  const __m128 ww  = _mm_mul_ps(w,w), xx = _mm_mul_ps(x,x), yy = _mm_mul_ps(y,y), zz = _mm_mul_ps(z,z);
+  const __m128 xy  = _mm_mul_ps(x,y), xz = _mm_mul_ps(x,z), yz = _mm_mul_ps(y,z);
+  const __m128 wx  = _mm_mul_ps(w,x), wy = _mm_mul_ps(w,y), wz = _mm_mul_ps(w,z);
+
+  const __m128 px = _mm_loadu_ps(a+stride*4+i);
+  const __m128 py = _mm_loadu_ps(a+stride*5+i);
+  const __m128 pz = _mm_loadu_ps(a+stride*6+i);
+
+  // columns of 4 matrices; transpose turns them into per-bone rows
+  __m128 c0[4] = {_mm_sub_ps(_mm_sub_ps(_mm_add_ps(ww,xx),yy),zz),
+                  _mm_mul_ps(two,_mm_sub_ps(xy,wz)),
+                  _mm_mul_ps(two,_mm_add_ps(xz,wy)),
+                  _mm_setzero_ps()};
+  __m128 c1[4] = {_mm_mul_ps(two,_mm_add_ps(xy,wz)),
+                  _mm_sub_ps(_mm_add_ps(_mm_sub_ps(ww,xx),yy),zz),
+                  _mm_mul_ps(two,_mm_sub_ps(yz,wx)),
+                  _mm_setzero_ps()};
+  __m128 c2[4] = {_mm_mul_ps(two,_mm_sub_ps(xz,wy)),
+                  _mm_mul_ps(two,_mm_add_ps(yz,wx)),
+                  _mm_add_ps(_mm_sub_ps(_mm_sub_ps(ww,xx),yy),zz),
+                  _mm_setzero_ps()};
+  __m128 c3[4] = {_mm_add_ps(px,_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(b+stride*4+i),px),vt)),
+                  _mm_add_ps(py,_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(b+stride*5+i),py),vt)),
+                  _mm_add_ps(pz,_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(b+stride*6+i),pz),vt)),
+                  _mm_set1_ps(1.f)};
+  _MM_TRANSPOSE4_PS(c0[0],c0[1],c0[2],c0[3]);
+  _MM_TRANSPOSE4_PS(c1[0],c1[1],c1[2],c1[3]);
+  _MM_TRANSPOSE4_PS(c2[0],c2[1],c2[2],c2[3]);
+  _MM_TRANSPOSE4_PS(c3[0],c3[1],c3[2],c3[3]);
+
+  // slerp branch is rare between neighbour keyframes - leave it to scalar code
+  const int slerp = _mm_movemask_ps(_mm_cmplt_ps(dot,_mm_set1_ps(0.95f)));
+
+  for(size_t r=0; r<4 && i+r<count; ++r) {
+    auto& dst = out[nodeIndex[i+r]];
+    if(slerp & (1<<r)) {
+      dst = mkMatrix(mix(loadSample(a,stride,i+r),loadSample(b,stride,i+r),t));
+      continue;
+      }
+    float m[4][4];
+    _mm_storeu_ps(m[0],c0[r]);
+    _mm_storeu_ps(m[1],c1[r]);
+    _mm_storeu_ps(m[2],c2[r]);
+    _mm_storeu_ps(m[3],c3[r]);
+    dst = Tempest::Matrix4x4(reinterpret_cast<float*>(m));
+    }
+  }
+#endif
+
+void mixSamples(const float* a, const float* b, size_t stride, size_t count, float t,
+                const uint32_t* nodeIndex, Tempest::Matrix4x4* out) {
+  size_t i = 0;
+#if defined(ANIMMATH_SSE2)
+  // stride is multiple of 4, tail lanes are padding
+  for(; i<count; i+=4)
+    mixSamples4(a,b,stride,i,t,count,nodeIndex,out);
+#endif
+  for(; i<count; ++i)
+    out[nodeIndex[i]] = mkMatrix(mix(loadSample(a,stride,i),loadSample(b,stride,i),t));
+  }
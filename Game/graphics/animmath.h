@@ -1,8 +1,14 @@
 #pragma once
 
+#include <cstdint>
 #include <zenload/zTypes.h>
 #include <Tempest/Matrix4x4>
 #include <Tempest/Point>
 
 ZenLoad::zCModelAniSample mix(const ZenLoad::zCModelAniSample& x,const ZenLoad::zCModelAniSample& y,float a);
 Tempest::Matrix4x4        mkMatrix(const ZenLoad::zCModelAniSample& s);
+
+// blend 'count' bones of two keyframes, stored as 7 soa streams(qx,qy,qz,qw,px,py,pz) of 'stride' floats;
+// result is equal to mkMatrix(mix(a,b,t)) for each bone
+void                      mixSamples(const float* a, const float* b, size_t stride, size_t count, float t,
+                                     const uint32_t* nodeIndex, Tempest::Matrix4x4* out);
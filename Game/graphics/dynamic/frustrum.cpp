@@ -1,5 +1,12 @@
 #include "frustrum.h"
 
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#include <emmintrin.h>
+#define FRUSTRUM_SSE2
+#endif
+
 using namespace Tempest;
 
 void Frustrum::make(const Matrix4x4& m) {
@@ -110,3 +117,38 @@ bool Frustrum::testPoint(float x, float y, float z, float R) const {
     }
   return true;
   }
+
+void Frustrum::testSpheres(const float* x, const float* y, const float* z, const float* R,
+                           size_t count, uint32_t* visible) const {
+  std::memset(visible,0,((count+31)/32)*sizeof(uint32_t));
+
+  size_t i = 0;
+#if defined(FRUSTRUM_SSE2)
+  // same operation order as testPoint, 4 spheres at once
+  __m128 pl[6][4];
+  for(size_t p=0; p<6; ++p)
+    for(size_t c=0; c<4; ++c)
+      pl[p][c] = _mm_set1_ps(f[p][c]);
+  const __m128 sign = _mm_set1_ps(-0.f);
+
+  for(; i+4<=count; i+=4) {
+    const __m128 vx = _mm_loadu_ps(x+i);
+    const __m128 vy = _mm_loadu_ps(y+i);
+    const __m128 vz = _mm_loadu_ps(z+i);
+    const __m128 nr = _mm_xor_ps(_mm_loadu_ps(R+i),sign);
+
+    __m128 cull = _mm_setzero_ps();
+    for(size_t p=0; p<6; ++p) {
+      __m128 d = _mm_add_ps(_mm_mul_ps(pl[p][0],vx),_mm_mul_ps(pl[p][1],vy));
+      d    = _mm_add_ps(_mm_add_ps(d,_mm_mul_ps(pl[p][2],vz)),pl[p][3]);
+      cull = _mm_or_ps(cull,_mm_cmple_ps(d,nr));
+      }
+    const uint32_t bits = uint32_t(~_mm_movemask_ps(cull)) & 0xF;
+    visible[i/32] |= bits<<(i%32);
+    }
+#endif
+  for(; i<count; ++i) {
+    if(testPoint(x[i],y[i],z[i],R[i]))
+      visible[i/32] |= 1u<<(i%32);
+    }
+  }
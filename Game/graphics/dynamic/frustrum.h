@@ -2,6 +2,9 @@
 
 #include <Tempest/Matrix4x4>
 
+#include <cstddef>
+#include <cstdint>
+
 class Frustrum {
   public:
     void make(const Tempest::Matrix4x4& m);
@@ -9,6 +12,9 @@ class Frustrum {
 
     bool testPoint(float x, float y, float z) const;
     bool testPoint(float x, float y, float z, float R) const;
+    // batched testPoint: bit 'i' of 'visible' is set, if sphere 'i' passes the test
+    void testSpheres(const float* x, const float* y, const float* z, const float* R,
+                     size_t count, uint32_t* visible) const;
 
     float f[6][4] = {};
   };
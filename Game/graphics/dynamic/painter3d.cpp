@@ -20,6 +20,11 @@ bool Painter3d::isVisible(const Bounds& b) const {
   return frustrum.testPoint(b.midTr.x,b.midTr.y,b.midTr.z, b.r);
   }
 
+void Painter3d::isVisible(const float* x, const float* y, const float* z, const float* r,
+                          size_t count, uint32_t* visible) const {
+  frustrum.testSpheres(x,y,z,r,count,visible);
+  }
+
 void Painter3d::setViewport(int x, int y, int w, int h) {
   enc.setViewport(x,y,w,h);
   }
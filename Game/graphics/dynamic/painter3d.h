@@ -6,7 +6,6 @@
 #include <Tempest/CommandBuffer>
 #include <Tempest/Matrix4x4>
 
-#include <vector>
 
 #include "frustrum.h"
 #include "resources.h"
@@ -26,6 +25,8 @@ class Painter3d final {
     void setFrustrum(const Tempest::Matrix4x4& m);
 
     bool isVisible(const Bounds& b) const;
+    void isVisible(const float* x, const float* y, const float* z, const float* r,
+                   size_t count, uint32_t* visible) const;
 
     void setViewport(int x,int y,int w,int h);
 
@@ -50,7 +51,5 @@ class Painter3d final {
     Tempest::Encoder<Tempest::CommandBuffer>& enc;
 
     Frustrum                                  frustrum;
-    std::vector<Resources::Vertex>            vboCpu;
-    Tempest::VertexBuffer<Resources::Vertex>  vbo[Resources::MaxFramesInFlight];
   };
 
@@ -0,0 +1,74 @@
+#include "streamalloc.h"
+
+#include <algorithm>
+
+StreamAlloc::StreamAlloc(uint8_t frames)
+  :frame(frames) {
+  }
+
+bool StreamAlloc::resize(size_t size) {
+  if(size==sz)
+    return false;
+
+  size_t c = cap;
+  if(size==0)
+    c = 0; else
+  if(size>cap)
+    c = std::max(size,cap*2);
+
+  if(c!=cap) {
+    for(auto& f:frame) {
+      f.dirty.clear();
+      f.realloc = true;
+      }
+    cap = c;
+    sz  = size;
+    return true;
+    }
+
+  // elements past the end are expected to be cleared by the owner
+  if(size<sz)
+    invalidate(size,sz);
+  sz = size;
+  return false;
+  }
+
+void StreamAlloc::invalidate(size_t begin, size_t end) {
+  end = std::min(end,cap);
+  if(begin>=end)
+    return;
+  for(auto& f:frame)
+    if(!f.realloc)
+      addRange(f.dirty,Range{begin,end});
+  }
+
+void StreamAlloc::invalidate() {
+  invalidate(0,cap);
+  }
+
+void StreamAlloc::commit(uint8_t fId) {
+  auto& f = frame[fId];
+  f.dirty.clear();
+  f.realloc = false;
+  }
+
+void StreamAlloc::addRange(std::vector<Range>& dirty, Range r) {
+  // first range, that touches 'r'
+  auto at = std::lower_bound(dirty.begin(),dirty.end(),r.begin,[](const Range& a, size_t b){
+    return a.end<b;
+    });
+  auto last = at;
+  while(last!=dirty.end() && last->begin<=r.end) {
+    r.begin = std::min(r.begin,last->begin);
+    r.end   = std::max(r.end,  last->end);
+    ++last;
+    }
+  at = dirty.erase(at,last);
+  dirty.insert(at,r);
+
+  if(dirty.size()>MaxRanges) {
+    Range all = {dirty.front().begin,dirty.back().end};
+    dirty.clear();
+    dirty.push_back(all);
+    }
+  }
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bookkeeping of a dynamic buffer, that has a copy per frame in flight.
+// Capacity grows by doubling and is kept, until buffer becomes empty; only ranges,
+// modified since a frame copy was written last time, have to be uploaded.
+class StreamAlloc final {
+  public:
+    struct Range {
+      size_t begin = 0;
+      size_t end   = 0;
+      };
+
+    explicit StreamAlloc(uint8_t frames);
+
+    size_t size()     const { return sz;  }
+    size_t capacity() const { return cap; }
+
+    // returns true, if capacity has changed
+    bool   resize(size_t size);
+    void   invalidate(size_t begin, size_t end);
+    void   invalidate();
+
+    // frame copy must be recreated with 'capacity()' elements
+    bool   needRealloc(uint8_t fId) const { return frame[fId].realloc; }
+    const std::vector<Range>& dirty(uint8_t fId) const { return frame[fId].dirty; }
+    void   commit(uint8_t fId);
+
+  private:
+    // ranges are collapsed into one, once there are too many of them
+    static constexpr size_t MaxRanges = 16;
+
+    struct Frame {
+      std::vector<Range> dirty;
+      bool               realloc = false;
+      };
+
+    static void addRange(std::vector<Range>& dirty, Range r);
+
+    std::vector<Frame> frame;
+    size_t             sz  = 0;
+    size_t             cap = 0;
+  };
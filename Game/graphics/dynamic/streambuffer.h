@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Tempest/Device>
+#include <Tempest/VertexBuffer>
+
+#include <algorithm>
+#include <vector>
+
+#include "streamalloc.h"
+#include "resources.h"
+
+// Persistent dynamic vertex buffer: cpu copy is written in place, gpu copies are recreated
+// only when capacity grows; otherwise only dirty ranges are uploaded.
+// Elements past 'size()' are kept zero - degenerate, if buffer is drawn as a whole.
+template<class T>
+class StreamBuffer final {
+  public:
+    StreamBuffer():alloc(uint8_t(Resources::MaxFramesInFlight)){}
+
+    size_t   size() const { return alloc.size(); }
+    T*       data()       { return cpu.data();   }
+    T&       operator[](size_t i) { return cpu[i]; }
+
+    void     resize(size_t sz);
+    void     invalidate(size_t begin, size_t end) { alloc.invalidate(begin,end); }
+    void     invalidate()                         { alloc.invalidate();          }
+    void     commit(Tempest::Device& device, uint8_t fId);
+
+    const Tempest::VertexBufferDyn<T>& gpu(uint8_t fId) const { return vboGpu[fId]; }
+
+  private:
+    StreamAlloc                 alloc;
+    std::vector<T>              cpu;
+    Tempest::VertexBufferDyn<T> vboGpu[Resources::MaxFramesInFlight];
+  };
+
+template<class T>
+void StreamBuffer<T>::resize(size_t sz) {
+  const size_t prev = alloc.size();
+  if(sz<prev)
+    std::fill(cpu.begin()+ptrdiff_t(sz),cpu.begin()+ptrdiff_t(prev),T());
+  alloc.resize(sz);
+  cpu.resize(alloc.capacity());
+  }
+
+template<class T>
+void StreamBuffer<T>::commit(Tempest::Device& device, uint8_t fId) {
+  auto& vbo = vboGpu[fId];
+  if(alloc.needRealloc(fId)) {
+    if(cpu.size()==0)
+      vbo = Tempest::VertexBufferDyn<T>(); else
+      vbo = device.vboDyn(cpu.data(),cpu.size());
+    } else {
+    for(auto& r:alloc.dirty(fId))
+      vbo.update(cpu.data()+r.begin,r.begin,r.end-r.begin);
+    }
+  alloc.commit(fId);
+  }
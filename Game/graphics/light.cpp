@@ -14,6 +14,22 @@ static Vec3 toVec3(uint32_t v) {
 Light::Light() {
   }
 
+Light::Light(const ZenLoad::zCVobData& vob) {
+  setPosition(Vec3(vob.position.x,vob.position.y,vob.position.z));
+
+  if(vob.zCVobLight.dynamic.rangeAniScale.size()>0) {
+    setRange(vob.zCVobLight.dynamic.rangeAniScale,vob.zCVobLight.range,vob.zCVobLight.dynamic.rangeAniFPS,vob.zCVobLight.dynamic.rangeAniSmooth);
+    } else {
+    setRange(vob.zCVobLight.range);
+    }
+
+  if(vob.zCVobLight.dynamic.colorAniList.size()>0) {
+    setColor(vob.zCVobLight.dynamic.colorAniList,vob.zCVobLight.dynamic.colorAniListFPS,vob.zCVobLight.dynamic.colorAniSmooth);
+    } else {
+    setColor(vob.zCVobLight.color);
+    }
+  }
+
 void Light::setDir(const Tempest::Vec3& d) {
   float l = d.manhattanLength();
   if(l>0){
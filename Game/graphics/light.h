@@ -1,12 +1,14 @@
 #pragma once
 
 #include <Tempest/Point>
+#include <zenload/zTypes.h>
 #include <array>
 #include <vector>
 
 class Light final {
   public:
     Light();
+    explicit Light(const ZenLoad::zCVobData& vob);
 
     Tempest::Vec3        dir() const { return ldir; }
     void                 setDir(const Tempest::Vec3& d);
@@ -0,0 +1,127 @@
+#include "lightgrid.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "light.h"
+#include "utils/workers.h"
+
+using namespace Tempest;
+
+void LightGrid::build(const std::vector<Light>& light) {
+  static const float  CellSize = 2000.f;
+  static const size_t MaxCells = 512;
+
+  *this = LightGrid();
+  if(light.size()==0)
+    return;
+
+  Vec3 bbox[2] = {light[0].position(),light[0].position()};
+  for(auto& l:light) {
+    auto& p = l.position();
+    float r = l.range();
+    bbox[0].x = std::min(bbox[0].x,p.x-r);
+    bbox[0].z = std::min(bbox[0].z,p.z-r);
+    bbox[1].x = std::max(bbox[1].x,p.x+r);
+    bbox[1].z = std::max(bbox[1].z,p.z+r);
+    }
+  const float ext = std::max(bbox[1].x-bbox[0].x,bbox[1].z-bbox[0].z);
+  cellSize = std::max(CellSize,ext/float(MaxCells));
+  x0       = bbox[0].x;
+  z0       = bbox[0].z;
+  w        = int32_t((bbox[1].x-bbox[0].x)/cellSize)+1;
+  h        = int32_t((bbox[1].z-bbox[0].z)/cellSize)+1;
+
+  const size_t cells = size_t(w*h);
+  std::vector<std::atomic<uint32_t>> cnt(cells);
+  for(auto& i:cnt)
+    i.store(0);
+
+  auto forCells = [this,&light](const Light& l, std::atomic<uint32_t>* cnt, uint32_t* out) {
+    auto&   p   = l.position();
+    float   r   = l.range();
+    int32_t cx0 = std::max(int32_t((p.x-r-x0)/cellSize),0);
+    int32_t cx1 = std::min(int32_t((p.x+r-x0)/cellSize),w-1);
+    int32_t cz0 = std::max(int32_t((p.z-r-z0)/cellSize),0);
+    int32_t cz1 = std::min(int32_t((p.z+r-z0)/cellSize),h-1);
+    for(int32_t z=cz0; z<=cz1; ++z)
+      for(int32_t x=cx0; x<=cx1; ++x) {
+        const uint32_t at = cnt[z*w+x].fetch_add(1);
+        if(out!=nullptr)
+          out[at] = uint32_t(&l-light.data());
+        }
+    };
+
+  // counting sort: count, prefix sum, scatter
+  Workers::parallelFor(light.data(),light.data()+light.size(),[&](const Light& l){
+    forCells(l,cnt.data(),nullptr);
+    });
+  start.resize(cells+1);
+  start[0] = 0;
+  for(size_t i=0; i<cells; ++i) {
+    start[i+1] = start[i]+cnt[i].load();
+    cnt[i].store(start[i]);
+    }
+  item.resize(start[cells]);
+  Workers::parallelFor(light.data(),light.data()+light.size(),[&](const Light& l){
+    forCells(l,cnt.data(),item.data());
+    });
+  }
+
+float LightGrid::weight(const Light& l, const Vec3& b0, const Vec3& b1) {
+  auto&       p  = l.position();
+  const float dx = std::max(std::max(b0.x-p.x,p.x-b1.x),0.f);
+  const float dy = std::max(std::max(b0.y-p.y,p.y-b1.y),0.f);
+  const float dz = std::max(std::max(b0.z-p.z,p.z-b1.z),0.f);
+  const float d  = std::sqrt(dx*dx+dy*dy+dz*dz);
+  if(d>=l.range())
+    return 0;
+  const float k  = 1.f-d/l.range();
+  auto&       cl = l.color();
+  return k*k*(0.2126f*cl.x+0.7152f*cl.y+0.0722f*cl.z);
+  }
+
+size_t LightGrid::getStrongest(const std::vector<Light>& light, const Vec3& b0, const Vec3& b1,
+                               const Light** out, size_t maxOut) const {
+  if(maxOut==0 || w==0)
+    return 0;
+
+  auto cell = [this](float v, float v0, int32_t sz) {
+    return std::min(std::max(int32_t((v-v0)/cellSize),0),sz-1);
+    };
+  const int32_t cx0 = cell(b0.x,x0,w), cx1 = cell(b1.x,x0,w);
+  const int32_t cz0 = cell(b0.z,z0,h), cz1 = cell(b1.z,z0,h);
+
+  // selection is done by static range and color, so cached lists don't depend on animation phase
+  static thread_local std::vector<std::pair<float,uint32_t>> cand;
+  cand.clear();
+  for(int32_t z=cz0; z<=cz1; ++z)
+    for(int32_t x=cx0; x<=cx1; ++x) {
+      const size_t c = size_t(z*w+x);
+      for(size_t i=start[c]; i<start[c+1]; ++i) {
+        const uint32_t id = item[i];
+        const float    k  = weight(light[id],b0,b1);
+        if(k>0.f)
+          cand.emplace_back(k,id);
+        }
+      }
+
+  // light, that spans over few cells, is found multiple times
+  std::sort(cand.begin(),cand.end(),[](const std::pair<float,uint32_t>& a, const std::pair<float,uint32_t>& b){
+    return a.second<b.second;
+    });
+  cand.erase(std::unique(cand.begin(),cand.end(),[](const std::pair<float,uint32_t>& a, const std::pair<float,uint32_t>& b){
+    return a.second==b.second;
+    }),cand.end());
+
+  const size_t cnt = std::min(cand.size(),maxOut);
+  std::partial_sort(cand.begin(),cand.begin()+ptrdiff_t(cnt),cand.end(),[](const std::pair<float,uint32_t>& a, const std::pair<float,uint32_t>& b){
+    if(a.first!=b.first)
+      return a.first>b.first;
+    return a.second<b.second;
+    });
+  for(size_t i=0; i<cnt; ++i)
+    out[i] = &light[cand[i].second];
+  return cnt;
+  }
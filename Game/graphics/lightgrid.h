@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Tempest/Point>
+#include <vector>
+#include <cstdint>
+
+class Light;
+
+// Uniform grid over horizontal plane; lights are binned by maximum of animated range.
+// Built on owning thread; queries are read-only and can run concurrently with each other, but not with build.
+class LightGrid final {
+  public:
+    void   build(const std::vector<Light>& light);
+    // up to 'maxOut' lights, that reach box [b0,b1], strongest first
+    size_t getStrongest(const std::vector<Light>& light, const Tempest::Vec3& b0, const Tempest::Vec3& b1,
+                        const Light** out, size_t maxOut) const;
+
+    // contribution of light to box, that is used for selection: depends only on static range and color
+    static float weight(const Light& l, const Tempest::Vec3& b0, const Tempest::Vec3& b1);
+
+  private:
+    float                 x0 = 0, z0 = 0;
+    float                 cellSize = 0;
+    int32_t               w = 0, h = 0;
+    std::vector<uint32_t> start;
+    std::vector<uint32_t> item;
+  };
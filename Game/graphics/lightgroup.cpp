@@ -1,10 +1,12 @@
 #include "lightgroup.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "bounds.h"
 #include "graphics/rendererstorage.h"
 #include "graphics/sceneglobals.h"
 #include "utils/gthfont.h"
-#include "utils/workers.h"
 
 using namespace Tempest;
 
@@ -81,22 +83,21 @@ size_t LightGroup::size() const {
 
 size_t LightGroup::add(Light&& l) {
   fullGpuUpdate = true;
-  clearIndex();
+  indexChanged  = true;
   light.push_back(std::move(l));
   if(light.back().isDynamic())
     dynamicState.push_back(light.size()-1);
   return light.size()-1;
   }
 
-size_t LightGroup::get(const Bounds& area, const Light** out, size_t maxOut) const {
-  if(index.count!=light.size())
-    mkIndex();
-  return implGet(index,area,out,maxOut);
+size_t LightGroup::getStrongest(const Bounds& area, const Light** out, size_t maxOut) const {
+  return grid.getStrongest(light,area.bboxTr[0],area.bboxTr[1],out,maxOut);
   }
 
 void LightGroup::tick(uint64_t time) {
   for(auto i:dynamicState)
     light[i].update(time);
+  commitIndex();
   }
 
 void LightGroup::preFrameUpdate(uint8_t fId) {
@@ -114,8 +115,8 @@ void LightGroup::draw(Encoder<CommandBuffer>& cmd, uint8_t fId) {
   auto& p = scene.storage.pLights;
   cmd.setUniforms(p,ubo[fId]);
   for(auto& i:chunks) {
-    size_t sz = (i.vboGpu[fId].size()/8)*36;
-    cmd.draw(i.vboGpu[fId],iboGpu,0,sz);
+    size_t sz = (i.vbo.size()/8)*36;
+    cmd.draw(i.vbo.gpu(fId),iboGpu,0,sz);
     }
   }
 
@@ -133,115 +134,12 @@ void LightGroup::setupUbo() {
     }
   }
 
-size_t LightGroup::implGet(const LightGroup::Bvh& index, const Bounds& area, const Light** out, size_t maxOut) const {
-  const Bvh* cur = &index;
-  if(maxOut==0)
-    return 0;
-  while(true) {
-    if(cur->next[0]==nullptr && cur->next[1]==nullptr) {
-      size_t cnt = std::min(cur->count,maxOut);
-      for(size_t i=0; i<cnt; ++i) {
-        out[i] = cur->b[i];
-        }
-      return cnt;
-      }
-
-    bool l = cur->next[0]!=nullptr && isIntersected(cur->next[0]->bbox,area);
-    bool r = cur->next[1]!=nullptr && isIntersected(cur->next[1]->bbox,area);
-    if(l && r) {
-      size_t cnt0 = implGet(*cur->next[0],area,out,     maxOut);
-      size_t cnt1 = implGet(*cur->next[1],area,out+cnt0,maxOut-cnt0);
-      return cnt0+cnt1;
-      }
-    else if(l) {
-      cur = cur->next[0].get();
-      }
-    else if(r) {
-      cur = cur->next[1].get();
-      }
-    else {
-      return 0;
-      }
-    }
-  }
-
-void LightGroup::mkIndex() const {
-  indexPtr.resize(light.size());
-  for(size_t i=0; i<indexPtr.size(); ++i)
-    indexPtr[i] = &light[i];
-  mkIndex(index,indexPtr.data(),indexPtr.size(),0);
-  }
-
-void LightGroup::mkIndex(Bvh& id, const Light** b, size_t count, int depth) const {
-  id.b     = b;
-  id.count = count;
-
-  if(count==1) {
-    id.bbox.assign((**b).position(),(**b).range());
+void LightGroup::commitIndex() {
+  // index is only rebuilt on owning thread; queries from animation workers never modify it
+  if(!indexChanged)
     return;
-    }
-
-  depth%=3;
-  if(depth==0) {
-    std::sort(b,b+count,[](const Light* a,const Light* b){
-      return a->position().x<b->position().x;
-      });
-    }
-  else if(depth==1) {
-    std::sort(b,b+count,[](const Light* a,const Light* b){
-      return a->position().y<b->position().y;
-      });
-    }
-  else {
-    std::sort(b,b+count,[](const Light* a,const Light* b){
-      return a->position().z<b->position().z;
-      });
-    }
-
-  size_t half = count/2;
-  if(half>0) {
-    if(id.next[0]==nullptr)
-      id.next[0].reset(new Bvh());
-    mkIndex(*id.next[0],b,half,depth+1);
-    } else {
-    id.next[0].reset();
-    }
-  if(count-half>0) {
-    if(id.next[1]==nullptr)
-      id.next[1].reset(new Bvh());
-    mkIndex(*id.next[1],b+half,count-half,depth+1);
-    } else {
-    id.next[1].reset();
-    }
-
-  if(id.next[0]!=nullptr && id.next[1]!=nullptr)
-    id.bbox.assign(id.next[0]->bbox,id.next[1]->bbox);
-  else if(id.next[0]!=nullptr)
-    id.bbox = id.next[0]->bbox;
-  else if(id.next[1]!=nullptr)
-    id.bbox = id.next[1]->bbox;
-  }
-
-void LightGroup::clearIndex() {
-  index.next[0].reset();
-  index.next[1].reset();
-  index.count = 0;
-  }
-
-bool LightGroup::isIntersected(const Bounds& a, const Bounds& b) {
-  if(a.bboxTr[1].x<b.bboxTr[0].x)
-    return false;
-  if(a.bboxTr[0].x>b.bboxTr[1].x)
-    return false;
-  if(a.bboxTr[1].y<b.bboxTr[0].y)
-    return false;
-  if(a.bboxTr[0].y>b.bboxTr[1].y)
-    return false;
-  if(a.bboxTr[1].z<b.bboxTr[0].z)
-    return false;
-  if(a.bboxTr[0].z>b.bboxTr[1].z)
-    return false;
-  return true;
+  grid.build(light);
+  indexChanged = false;
   }
 
 void LightGroup::buildVbo(uint8_t fId) {
@@ -269,24 +167,25 @@ void LightGroup::buildVbo(uint8_t fId) {
   if(fullGpuUpdate) {
     chunks.resize((light.size()+CHUNK_SIZE-1)/CHUNK_SIZE);
     fullGpuUpdate = false;
-    vboCpu.resize(light.size()*8);
+    for(size_t i=0; i<chunks.size(); ++i) {
+      auto& vbo = chunks[i].vbo;
+      vbo.resize(std::min<size_t>(light.size()-i*CHUNK_SIZE,CHUNK_SIZE)*8);
+      vbo.invalidate();
+      }
     for(size_t i=0; i<light.size(); ++i)
-      buildVbo(&vboCpu[i*8],light[i]);
+      buildVbo(&chunks[i/CHUNK_SIZE].vbo[(i%CHUNK_SIZE)*8],light[i]);
     } else {
+    // static lights are already on gpu
     for(auto i:dynamicState) {
-      auto&  l   = light[i];
-      buildVbo(&vboCpu[i*8],l);
+      auto&  vbo = chunks[i/CHUNK_SIZE].vbo;
+      size_t at  = (i%CHUNK_SIZE)*8;
+      buildVbo(&vbo[at],light[i]);
+      vbo.invalidate(at,at+8);
       }
     }
 
-  for(size_t i=0; i<chunks.size(); ++i) {
-    auto&  ch = chunks[i];
-    size_t i0  = i*CHUNK_SIZE*8;
-    size_t len = std::min<size_t>(vboCpu.size()-i0,CHUNK_SIZE*8);
-    if(ch.vboGpu[fId].size()!=len)
-      ch.vboGpu[fId] = scene.storage.device.vboDyn(&vboCpu[i0],len); else
-      ch.vboGpu[fId].update(&vboCpu[i0],0,len);
-    }
+  for(auto& i:chunks)
+    i.vbo.commit(device,fId);
   }
 
 void LightGroup::buildVbo(LightGroup::Vertex* vbo, const Light& l) {
@@ -4,8 +4,10 @@
 #include <memory>
 
 #include "graphics/dynamic/frustrum.h"
+#include "graphics/dynamic/streambuffer.h"
 #include "bounds.h"
 #include "light.h"
+#include "lightgrid.h"
 #include "resources.h"
 
 class SceneGlobals;
@@ -20,7 +22,8 @@ class LightGroup final {
 
     size_t add(Light&& l);
 
-    size_t get(const Bounds& area, const Light** out, size_t maxOut) const;
+    // up to 'maxOut' lights, that reach 'area', strongest first
+    size_t getStrongest(const Bounds& area, const Light** out, size_t maxOut) const;
     void   tick(uint64_t time);
     void   preFrameUpdate(uint8_t fId);
     void   draw(Tempest::Encoder<Tempest::CommandBuffer>& cmd, uint8_t fId);
@@ -39,29 +42,16 @@ class LightGroup final {
       Frustrum           fr;
       };
 
-    struct Bvh {
-      std::unique_ptr<Bvh> next[2];
-      Bounds               bbox;
-      const Light**        b = nullptr;
-      size_t               count=0;
-      };
-
-    size_t      implGet(const Bvh& index, const Bounds& area, const Light** out, size_t maxOut) const;
-    void        mkIndex() const;
-    void        mkIndex(Bvh& id, const Light** b, size_t count, int depth) const;
-    void        clearIndex();
-    static bool isIntersected(const Bounds& a,const Bounds& b);
+    void        commitIndex();
     void        buildVbo(uint8_t fId);
     void        buildVbo(Vertex* out, const Light& l);
 
     const SceneGlobals& scene;
 
     struct Chunk {
-      Tempest::VertexBufferDyn<Vertex> vboGpu[Resources::MaxFramesInFlight];
+      StreamBuffer<Vertex>           vbo;
       };
     std::vector<Chunk>               chunks;
-
-    std::vector<Vertex>              vboCpu;
     Tempest::IndexBuffer<uint16_t>   iboGpu;
 
     Tempest::Uniforms                ubo[Resources::MaxFramesInFlight];
@@ -69,8 +59,9 @@ class LightGroup final {
 
     std::vector<Light>                light;
     std::vector<size_t>               dynamicState;
-    mutable std::vector<const Light*> indexPtr;
-    mutable Bvh                       index;
     mutable bool                      fullGpuUpdate = false;
+
+    LightGrid                         grid;
+    bool                              indexChanged = true;
   };
 
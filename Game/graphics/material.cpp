@@ -7,7 +7,7 @@
 using namespace Tempest;
 
 Material::Material(const ZenLoad::zCMaterialData& m, bool enableAlphaTest) {
-  tex   = Resources::loadTexture(m.texture);
+  tex   = Resources::loadMeshTexture(m.texture);
   alpha = AlphaFunc(m.alphaFunc);
   loadFrames(m);
 
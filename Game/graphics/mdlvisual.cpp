@@ -338,7 +338,7 @@ void MdlVisual::updateWeaponSkeleton(const Item* weapon,const Item* range) {
   syncAttaches();
   }
 
-bool MdlVisual::updateAnimation(Npc* npc, World& world) {
+bool MdlVisual::updateAnimation(Npc* npc, World& world, bool compose) {
   Pose&    pose      = *skInst;
   uint64_t tickCount = world.tickCount();
 
@@ -356,6 +356,11 @@ bool MdlVisual::updateAnimation(Npc* npc, World& world) {
     }
 
   solver.update(tickCount);
+  if(!compose) {
+    // events are processed on every frame, skeleton on lod frames only
+    pose.skipUpdate(tickCount);
+    return false;
+    }
   const bool changed = pose.update(tickCount);
 
   if(changed) {
@@ -56,7 +56,7 @@ class MdlVisual final {
     void                           updateWeaponSkeleton(const Item *sword, const Item *bow);
 
     const Pose&                    pose() const { return *skInst; }
-    bool                           updateAnimation(Npc* npc, World& world);
+    bool                           updateAnimation(Npc* npc, World& world, bool compose);
     void                           processLayers  (World& world, int comb);
     auto                           mapBone(const size_t boneId) const -> Tempest::Vec3;
     auto                           mapWeaponBone() const -> Tempest::Vec3;
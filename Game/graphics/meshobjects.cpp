@@ -40,7 +40,7 @@ MeshObjects::Item MeshObjects::implGet(const StaticMesh &mesh, const StaticMesh:
 
 const Tempest::Texture2d *MeshObjects::solveTex(const Tempest::Texture2d *def, const std::string &format, int32_t v, int32_t c) {
   if(format.find_first_of("VC")!=std::string::npos){
-    auto ntex = Resources::loadTexture(format,v,c);
+    auto ntex = Resources::loadMeshTexture(format,v,c);
     if(ntex!=nullptr)
       return ntex;
     }
@@ -138,10 +138,19 @@ Tempest::Vec3 MeshObjects::Mesh::translate() const {
   return Tempest::Vec3(ani->rootTr[0],ani->rootTr[1],ani->rootTr[2]);
   }
 
+MeshObjects::Mesh::Mesh(const ProtoMesh* mesh, std::unique_ptr<Item[]>&& sub, size_t subCount)
+  :sub(std::move(sub)),subCount(subCount),ani(mesh) {
+  Resources::retain(ani);
+  }
+
 MeshObjects::Mesh::Mesh(MeshObjects::Mesh &&other) {
   *this = std::move(other);
   }
 
+MeshObjects::Mesh::~Mesh() {
+  Resources::release(ani);
+  }
+
 MeshObjects::Mesh &MeshObjects::Mesh::operator =(MeshObjects::Mesh &&other) {
   std::swap(sub,      other.sub);
   std::swap(subCount, other.subCount);
@@ -45,9 +45,9 @@ class MeshObjects final {
       public:
         Mesh()=default;
         Mesh(const ProtoMesh* mesh,
-             std::unique_ptr<Item[]>&& sub,size_t subCount)
-          :sub(std::move(sub)),subCount(subCount),ani(mesh){}
+             std::unique_ptr<Item[]>&& sub,size_t subCount);
         Mesh(Mesh&& other);
+        ~Mesh();
         Mesh& operator = (Mesh&& other);
 
         void   setObjMatrix(const Tempest::Matrix4x4& mt);
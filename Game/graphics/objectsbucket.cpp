@@ -12,6 +12,16 @@
 
 using namespace Tempest;
 
+static bool testBit(const uint32_t* mask, size_t i) {
+  return (mask[i/32] & (1u<<(i%32)))!=0;
+  }
+
+static void setBit(uint32_t* mask, size_t i, bool v) {
+  if(v)
+    mask[i/32] |=  (1u<<(i%32)); else
+    mask[i/32] &= ~(1u<<(i%32));
+  }
+
 void ObjectsBucket::Item::setObjMatrix(const Tempest::Matrix4x4 &mt) {
   owner->setObjMatrix(id,mt);
   }
@@ -136,41 +146,60 @@ ObjectsBucket::ObjectsBucket(const Material& mat, const SceneGlobals& scene, Sto
     uboShared.invalidate();
     uboShared.alloc(*this);
     }
+  // bucket draws with material textures - keep them resident
+  Resources::retain(mat);
   }
 
 ObjectsBucket::~ObjectsBucket() {
+  Resources::release(mat);
   }
 
 const Material& ObjectsBucket::material() const {
   return mat;
   }
 
-ObjectsBucket::Object& ObjectsBucket::implAlloc(const VboType type, const Bounds& bounds) {
-  Object* v = nullptr;
-  for(size_t i=0; i<CAPACITY; ++i) {
-    auto& vx = val[i];
-    if(vx.isValid())
-      continue;
-    v = &vx;
-    if(valLast<=i)
-      valLast = i+1;
-    break;
+size_t ObjectsBucket::implAlloc(const VboType type, const Bounds& bounds) {
+  size_t id = val.size();
+  while(freeList.size()>0) {
+    // list may hold slots, that were released or reused after shrink
+    const size_t i = freeList.back();
+    freeList.pop_back();
+    if(i<val.size() && !val[i].isValid()) {
+      id = i;
+      break;
+      }
+    }
+  if(id==val.size()) {
+    val.emplace_back();
+    valCold.emplace_back();
+    sphere.x.push_back(0);
+    sphere.y.push_back(0);
+    sphere.z.push_back(0);
+    sphere.r.push_back(0);
     }
 
   ++valSz;
-  v->vboType   = type;
-  v->vbo       = nullptr;
-  v->vboA      = nullptr;
-  v->ibo       = nullptr;
-  v->bounds    = bounds;
-  v->timeShift = uint64_t(0-scene.tickCount);
+  auto& v = val[id];
+  v           = Object();
+  v.vboType   = type;
+  v.timeShift = uint64_t(0-scene.tickCount);
+  valCold[id] = ObjectCold();
+  valCold[id].bounds = bounds;
+
+  setBit(validMask,id,true);
+  setBit(morphMask,id,type==VboType::VboMorph);
+  allBounds.r = 0;
+  updateSphere(id);
 
   if(!useSharedUbo) {
-    v->ubo.invalidate();
-    if(v->ubo.ubo[0].isEmpty())
-      v->ubo.alloc(*this);
+    if(uboObj.size()<=id)
+      uboObj.resize(id+1);
+    auto& ubo = uboObj[id];
+    ubo.invalidate();
+    if(ubo.ubo[0].isEmpty())
+      ubo.alloc(*this);
     }
-  return *v;
+  return id;
   }
 
 void ObjectsBucket::uboSetCommon(Descriptors& v) {
@@ -203,18 +232,19 @@ void ObjectsBucket::uboSetCommon(Descriptors& v) {
   }
 
 void ObjectsBucket::setupUbo() {
-  for(auto& v:val) {
-    setupLights(v,true);
+  for(size_t i=0; i<val.size(); ++i) {
+    if(val[i].isValid())
+      setupLights(i,true);
     }
 
   if(useSharedUbo) {
     uboShared.invalidate();
     uboSetCommon(uboShared);
     } else {
-    for(auto& i:val) {
-      i.ubo.invalidate();
-      if(!i.ubo.ubo[0].isEmpty())
-        uboSetCommon(i.ubo);
+    for(auto& i:uboObj) {
+      i.invalidate();
+      if(!i.ubo[0].isEmpty())
+        uboSetCommon(i);
       }
     }
   }
@@ -223,8 +253,8 @@ void ObjectsBucket::invalidateUbo() {
   if(useSharedUbo) {
     uboShared.invalidate();
     } else {
-    for(auto& i:val)
-      i.ubo.invalidate();
+    for(auto& i:uboObj)
+      i.invalidate();
     }
   }
 
@@ -244,91 +274,112 @@ void ObjectsBucket::preFrameUpdate(uint8_t fId) {
   }
 
 bool ObjectsBucket::groupVisibility(Painter3d& p) {
-  if(shaderType!=Static)
-    return true;
+  for(auto m:morphMask)
+    if(m!=0)
+      return true;
 
-  if(allBounds.r<=0) {
+  if(allBounds.r<=0 || shaderType!=Static) {
+    // use packed spheres, instead of walking over 'valCold'
     Tempest::Vec3 bbox[2] = {};
     bool          fisrt=true;
-    for(size_t i=0;i<CAPACITY;++i) {
-      if(!val[i].isValid())
+    for(size_t i=0;i<val.size();++i) {
+      if(!testBit(validMask,i))
         continue;
-      auto& b = val[i].bounds;
+      const float r = sphere.r[i];
+      const Vec3  b0 = {sphere.x[i]-r, sphere.y[i]-r, sphere.z[i]-r};
+      const Vec3  b1 = {sphere.x[i]+r, sphere.y[i]+r, sphere.z[i]+r};
       if(fisrt) {
-        bbox[0] = b.bboxTr[0];
-        bbox[1] = b.bboxTr[1];
+        bbox[0] = b0;
+        bbox[1] = b1;
         fisrt = false;
         }
-      bbox[0].x = std::min(bbox[0].x,b.bboxTr[0].x);
-      bbox[0].y = std::min(bbox[0].y,b.bboxTr[0].y);
-      bbox[0].z = std::min(bbox[0].z,b.bboxTr[0].z);
+      bbox[0].x = std::min(bbox[0].x,b0.x);
+      bbox[0].y = std::min(bbox[0].y,b0.y);
+      bbox[0].z = std::min(bbox[0].z,b0.z);
 
-      bbox[1].x = std::max(bbox[1].x,b.bboxTr[1].x);
-      bbox[1].y = std::max(bbox[1].y,b.bboxTr[1].y);
-      bbox[1].z = std::max(bbox[1].z,b.bboxTr[1].z);
+      bbox[1].x = std::max(bbox[1].x,b1.x);
+      bbox[1].y = std::max(bbox[1].y,b1.y);
+      bbox[1].z = std::max(bbox[1].z,b1.z);
       }
     allBounds.assign(bbox);
     }
   return p.isVisible(allBounds);
   }
 
+void ObjectsBucket::updateSphere(size_t i) {
+  auto& b = valCold[i].bounds;
+  sphere.x[i] = b.midTr.x;
+  sphere.y[i] = b.midTr.y;
+  sphere.z[i] = b.midTr.z;
+  sphere.r[i] = b.r;
+  // dynamic buckets are refitted on every pass anyway; objects of them may be moved concurrently
+  if(shaderType==Static)
+    allBounds.r = 0;
+  }
+
 void ObjectsBucket::visibilityPass(Painter3d& p) {
-  indexSz = 0;
+  index.clear();
   if(!groupVisibility(p))
     return;
 
-  Object** idx = index;
-  for(size_t i=0; i<valLast; ++i) {
-    auto& v = val[i];
-    if(!v.isValid())
+  uint32_t vis[CAPACITY/32] = {};
+  p.isVisible(sphere.x.data(),sphere.y.data(),sphere.z.data(),sphere.r.data(),val.size(),vis);
+
+  for(size_t i=0; i<val.size(); ++i) {
+    if(!testBit(validMask,i))
       continue;
-    if(!p.isVisible(v.bounds) && v.vboType!=VboType::VboMorph)
+    if(!testBit(vis,i) && !testBit(morphMask,i))
       continue;
-    idx[indexSz] = &v;
-    ++indexSz;
+    index.push_back(i);
     }
   }
 
 void ObjectsBucket::visibilityPassAnd(Painter3d& p) {
+  uint32_t vis[CAPACITY/32] = {};
+  p.isVisible(sphere.x.data(),sphere.y.data(),sphere.z.data(),sphere.r.data(),val.size(),vis);
+
   size_t nextSz = 0;
-  for(size_t i=0; i<indexSz; ++i) {
-    auto& v = *index[i];
-    if(!p.isVisible(v.bounds))
+  for(size_t i=0; i<index.size(); ++i) {
+    const size_t id = index[i];
+    if(!testBit(vis,id))
       continue;
-    index[nextSz] = &v;
+    index[nextSz] = id;
     ++nextSz;
     }
-  indexSz = nextSz;
+  index.resize(nextSz);
   }
 
 size_t ObjectsBucket::alloc(const Tempest::VertexBuffer<Vertex>&  vbo,
                             const Tempest::IndexBuffer<uint32_t>& ibo,
                             const Bounds& bounds) {
-  Object* v = &implAlloc(VboType::VboVertex,bounds);
-  v->vbo = &vbo;
-  v->ibo = &ibo;
+  const size_t id = implAlloc(VboType::VboVertex,bounds);
+  auto&        v  = val[id];
+  v.vbo = &vbo;
+  v.ibo = &ibo;
   polySz+=ibo.size();
   polyAvg = polySz/valSz;
-  return std::distance(val,v);
+  return id;
   }
 
 size_t ObjectsBucket::alloc(const Tempest::VertexBuffer<VertexA>& vbo,
                             const Tempest::IndexBuffer<uint32_t>& ibo,
                             const Bounds& bounds) {
-  Object* v = &implAlloc(VboType::VboVertexA,bounds);
-  v->vboA   = &vbo;
-  v->ibo    = &ibo;
-  v->storageAni = storage.ani.alloc();
+  const size_t id = implAlloc(VboType::VboVertexA,bounds);
+  auto&        v  = val[id];
+  v.vboA       = &vbo;
+  v.ibo        = &ibo;
+  v.storageAni = storage.ani.alloc();
   polySz+=ibo.size();
   polyAvg = polySz/valSz;
-  return std::distance(val,v);
+  return id;
   }
 
 size_t ObjectsBucket::alloc(const Tempest::VertexBuffer<ObjectsBucket::Vertex>* vbo[], const Bounds& bounds) {
-  Object* v = &implAlloc(VboType::VboMorph,bounds);
+  const size_t id = implAlloc(VboType::VboMorph,bounds);
+  auto&        v  = val[id];
   for(size_t i=0; i<Resources::MaxFramesInFlight; ++i)
-    v->vboM[i] = vbo[i];
-  return std::distance(val,v);
+    v.vboM[i] = vbo[i];
+  return id;
   }
 
 void ObjectsBucket::free(const size_t objId) {
@@ -337,20 +388,21 @@ void ObjectsBucket::free(const size_t objId) {
     storage.ani.free(v.storageAni);
   if(v.ibo!=nullptr)
     polySz -= v.ibo->size();
-  v.vboType = VboType::NoVbo;
-  v.vbo     = nullptr;
-  for(size_t i=0;i<Resources::MaxFramesInFlight;++i)
-    v.vboM[i] = nullptr;
-  v.vboA    = nullptr;
-  v.ibo     = nullptr;
+  storage.light.free(v.lightId,v.lightCnt);
+  v = Object();
+  setBit(validMask,objId,false);
+  setBit(morphMask,objId,false);
+  allBounds.r = 0;
   valSz--;
-  valLast = 0;
-  for(size_t i=CAPACITY; i>0;) {
-    --i;
-    if(val[i].isValid()) {
-      valLast = i+1;
-      break;
-      }
+
+  freeList.push_back(objId);
+  while(val.size()>0 && !val.back().isValid()) {
+    val.pop_back();
+    valCold.pop_back();
+    sphere.x.pop_back();
+    sphere.y.pop_back();
+    sphere.z.pop_back();
+    sphere.r.pop_back();
     }
   if(valSz>0)
     polyAvg = polySz/valSz; else
@@ -358,23 +410,23 @@ void ObjectsBucket::free(const size_t objId) {
   }
 
 void ObjectsBucket::draw(Tempest::Encoder<Tempest::CommandBuffer>& p, uint8_t fId) {
-  if(pMain==nullptr || indexSz==0)
+  if(pMain==nullptr || index.size()==0)
     return;
 
   if(useSharedUbo)
     p.setUniforms(*pMain,uboShared.ubo[fId]);
 
   UboPush pushBlock;
-  Object** idx = index;
-  for(size_t i=0;i<indexSz;++i) {
-    auto& v = *idx[i];
+  for(auto id:index) {
+    auto& v = val[id];
 
     pushBlock.pos = v.pos;
-    const size_t cnt = v.lightCnt;
+    const size_t cnt   = v.lightCnt;
+    auto         light = storage.light.data(v.lightId);
     for(size_t r=0; r<cnt && r<LIGHT_BLOCK; ++r) {
-      pushBlock.light[r].pos   = v.light[r]->position();
-      pushBlock.light[r].color = v.light[r]->currentColor();
-      pushBlock.light[r].range = v.light[r]->currentRange();
+      pushBlock.light[r].pos   = light[r]->position();
+      pushBlock.light[r].color = light[r]->currentColor();
+      pushBlock.light[r].range = light[r]->currentRange();
       }
     for(size_t r=cnt;r<LIGHT_BLOCK;++r) {
       pushBlock.light[r].range = 0;
@@ -382,10 +434,10 @@ void ObjectsBucket::draw(Tempest::Encoder<Tempest::CommandBuffer>& p, uint8_t fI
 
     p.setUniforms(*pMain,&pushBlock,sizeof(pushBlock));
     if(!useSharedUbo) {
-      auto& ubo = v.ubo.ubo[fId];
+      auto& ubo = uboObj[id].ubo[fId];
       setAnim(v,ubo);
       if(v.storageAni!=size_t(-1))
-        setUbo(v.ubo.uboBit[fId],ubo,3,storage.ani[fId],v.storageAni,1);
+        setUbo(uboObj[id].uboBit[fId],ubo,3,storage.ani[fId],v.storageAni,1);
       p.setUniforms(*pMain,ubo);
       }
 
@@ -406,23 +458,23 @@ void ObjectsBucket::draw(Tempest::Encoder<Tempest::CommandBuffer>& p, uint8_t fI
   }
 
 void ObjectsBucket::drawGBuffer(Tempest::Encoder<CommandBuffer>& p, uint8_t fId) {
-  if(pGbuffer==nullptr || indexSz==0)
+  if(pGbuffer==nullptr || index.size()==0)
     return;
 
   if(useSharedUbo)
     p.setUniforms(*pGbuffer,uboShared.ubo[fId]);
 
   UboPush pushBlock;
-  Object** idx = index;
-  for(size_t i=0;i<indexSz;++i) {
-    auto& v = *idx[i];
+  for(auto id:index) {
+    auto& v = val[id];
 
     pushBlock.pos = v.pos;
-    const size_t cnt = v.lightCnt;
+    const size_t cnt   = v.lightCnt;
+    auto         light = storage.light.data(v.lightId);
     for(size_t r=0; r<cnt && r<LIGHT_BLOCK; ++r) {
-      pushBlock.light[r].pos   = v.light[r]->position();
-      pushBlock.light[r].color = v.light[r]->currentColor();
-      pushBlock.light[r].range = v.light[r]->currentRange();
+      pushBlock.light[r].pos   = light[r]->position();
+      pushBlock.light[r].color = light[r]->currentColor();
+      pushBlock.light[r].range = light[r]->currentRange();
       }
     for(size_t r=cnt;r<LIGHT_BLOCK;++r) {
       pushBlock.light[r].range = 0;
@@ -430,10 +482,10 @@ void ObjectsBucket::drawGBuffer(Tempest::Encoder<CommandBuffer>& p, uint8_t fId)
 
     p.setUniforms(*pGbuffer,&pushBlock,sizeof(pushBlock));
     if(!useSharedUbo) {
-      auto& ubo = v.ubo.ubo[fId];
+      auto& ubo = uboObj[id].ubo[fId];
       setAnim(v,ubo);
       if(v.storageAni!=size_t(-1))
-        setUbo(v.ubo.uboBit[fId],ubo,3,storage.ani[fId],v.storageAni,1);
+        setUbo(uboObj[id].uboBit[fId],ubo,3,storage.ani[fId],v.storageAni,1);
       p.setUniforms(*pGbuffer,ubo);
       }
 
@@ -458,30 +510,30 @@ void ObjectsBucket::drawLight(Tempest::Encoder<Tempest::CommandBuffer>& p, uint8
   if(disabled)
     return;
 
-  if(pLight==nullptr || indexSz==0)
+  if(pLight==nullptr || index.size()==0)
     return;
 
   if(useSharedUbo)
     p.setUniforms(*pLight,uboShared.ubo[fId]);
 
   UboPush pushBlock;
-  Object** idx = index;
-  for(size_t i=0;i<indexSz;++i) {
-    auto& v = *idx[i];
+  for(auto id:index) {
+    auto& v = val[id];
     if(v.lightCnt<=LIGHT_BLOCK)
       continue;
 
     if(!useSharedUbo) {
-      p.setUniforms(*pLight,v.ubo.ubo[fId]);
+      p.setUniforms(*pLight,uboObj[id].ubo[fId]);
       }
     pushBlock.pos = v.pos;
 
+    auto light = storage.light.data(v.lightId);
     for(size_t i=LIGHT_BLOCK; i<v.lightCnt; i+=LIGHT_BLOCK) {
       const size_t cnt = v.lightCnt-i;
       for(size_t r=0; r<cnt && r<LIGHT_BLOCK; ++r) {
-        pushBlock.light[r].pos   = v.light[i+r]->position();
-        pushBlock.light[r].color = v.light[i+r]->color();
-        pushBlock.light[r].range = v.light[i+r]->range();
+        pushBlock.light[r].pos   = light[i+r]->position();
+        pushBlock.light[r].color = light[i+r]->color();
+        pushBlock.light[r].range = light[i+r]->range();
         }
       for(size_t r=cnt;r<LIGHT_BLOCK;++r) {
         pushBlock.light[r].range = 0;
@@ -505,23 +557,22 @@ void ObjectsBucket::drawLight(Tempest::Encoder<Tempest::CommandBuffer>& p, uint8
   }
 
 void ObjectsBucket::drawShadow(Tempest::Encoder<Tempest::CommandBuffer>& p, uint8_t fId, int layer) {
-  if(pShadow==nullptr || indexSz==0)
+  if(pShadow==nullptr || index.size()==0)
     return;
 
   UboPush pushBlock = {};
   if(useSharedUbo)
     p.setUniforms(*pShadow,uboShared.uboSh[fId][layer]);
 
-  Object** idx = index;
-  for(size_t i=0;i<indexSz;++i) {
-    auto& v = *idx[i];
+  for(auto id:index) {
+    auto& v = val[id];
 
     if(!useSharedUbo) {
-      auto& ubo = v.ubo.uboSh[fId][layer];
+      auto& ubo = uboObj[id].uboSh[fId][layer];
       if(textureInShadowPass)
         setAnim(v,ubo);
       if(v.storageAni!=size_t(-1))
-        setUbo(v.ubo.uboBitSh[fId][layer],ubo,3,storage.ani[fId],v.storageAni,1);
+        setUbo(uboObj[id].uboBitSh[fId][layer],ubo,3,storage.ani[fId],v.storageAni,1);
       p.setUniforms(*pShadow,ubo);
       }
 
@@ -553,7 +604,7 @@ void ObjectsBucket::draw(size_t id, Tempest::Encoder<Tempest::CommandBuffer>& p,
   UboPush pushBlock = {};
   pushBlock.pos = v.pos;
 
-  auto& ubo = useSharedUbo ? uboShared.ubo[fId] : v.ubo.ubo[fId];
+  auto& ubo = useSharedUbo ? uboShared.ubo[fId] : uboObj[id].ubo[fId];
   if(!useSharedUbo) {
     ubo.set(0,*mat.tex);
     ubo.set(1,Resources::fallbackTexture(),Sampler2d::nearest());
@@ -568,13 +619,11 @@ void ObjectsBucket::draw(size_t id, Tempest::Encoder<Tempest::CommandBuffer>& p,
 
 void ObjectsBucket::setObjMatrix(size_t i, const Matrix4x4& m) {
   auto& v = val[i];
-  v.bounds.setObjMatrix(m);
+  valCold[i].bounds.setObjMatrix(m);
   v.pos = m;
+  updateSphere(i);
 
-  if(shaderType==Static)
-    allBounds.r = 0;
-
-  setupLights(v,false);
+  setupLights(i,false);
   }
 
 void ObjectsBucket::setPose(size_t i, const Pose& p) {
@@ -589,27 +638,32 @@ void ObjectsBucket::setPose(size_t i, const Pose& p) {
   }
 
 void ObjectsBucket::setBounds(size_t i, const Bounds& b) {
-  val[i].bounds = b;
+  valCold[i].bounds = b;
+  updateSphere(i);
   }
 
-void ObjectsBucket::setupLights(Object& val, bool noCache) {
+void ObjectsBucket::setupLights(size_t i, bool noCache) {
   if(pGbuffer!=nullptr)
     return;
-  int cx = int(val.bounds.midTr.x/2.f);
-  int cy = int(val.bounds.midTr.y/2.f);
-  int cz = int(val.bounds.midTr.z/2.f);
-
-  if(cx==val.lightCacheKey[0] &&
-     cy==val.lightCacheKey[1] &&
-     cz==val.lightCacheKey[2] &&
+  auto& c  = valCold[i];
+  int   cx = int(c.bounds.midTr.x/2.f);
+  int   cy = int(c.bounds.midTr.y/2.f);
+  int   cz = int(c.bounds.midTr.z/2.f);
+
+  if(cx==c.lightCacheKey[0] &&
+     cy==c.lightCacheKey[1] &&
+     cz==c.lightCacheKey[2] &&
      !noCache)
     return;
 
-  val.lightCacheKey[0] = cx;
-  val.lightCacheKey[1] = cy;
-  val.lightCacheKey[2] = cz;
+  c.lightCacheKey[0] = cx;
+  c.lightCacheKey[1] = cy;
+  c.lightCacheKey[2] = cz;
 
-  val.lightCnt = scene.lights.get(val.bounds,val.light,MAX_LIGHT);
+  const Light* light[MAX_LIGHT] = {};
+  size_t       cnt = scene.lights.getStrongest(c.bounds,light,MAX_LIGHT);
+  auto&        v   = val[i];
+  storage.light.assign(v.lightId,v.lightCnt,light,cnt);
   }
 
 void ObjectsBucket::setAnim(ObjectsBucket::Object& v, Tempest::Uniforms& ubo) {
@@ -642,3 +696,41 @@ void ObjectsBucket::setUbo(uint8_t& bit, Uniforms& ubo, uint8_t layoutBind,
 bool ObjectsBucket::Storage::commitUbo(Device& device, uint8_t fId) {
   return ani.commitUbo(device,fId) | mat.commitUbo(device,fId);
   }
+
+size_t ObjectsBucket::LightPool::blockClass(size_t count) {
+  size_t c = 0;
+  while((size_t(1)<<c)<count)
+    ++c;
+  return c;
+  }
+
+void ObjectsBucket::LightPool::assign(uint32_t& id, uint32_t& cnt, const Light* const* l, size_t count) {
+  // objects are moved from animation workers
+  std::lock_guard<std::mutex> guard(sync);
+  if(cnt==0 || count==0 || blockClass(cnt)!=blockClass(count)) {
+    if(cnt>0)
+      freeList[blockClass(cnt)].push_back(id);
+    id  = 0;
+    cnt = 0;
+    if(count==0)
+      return;
+
+    auto& fl = freeList[blockClass(count)];
+    if(fl.size()>0) {
+      id = fl.back();
+      fl.pop_back();
+      } else {
+      id = uint32_t(pool.size());
+      pool.resize(pool.size()+(size_t(1)<<blockClass(count)));
+      }
+    }
+  std::memcpy(&pool[id],l,count*sizeof(l[0]));
+  cnt = uint32_t(count);
+  }
+
+void ObjectsBucket::LightPool::free(uint32_t id, uint32_t cnt) {
+  if(cnt==0)
+    return;
+  std::lock_guard<std::mutex> guard(sync);
+  freeList[blockClass(cnt)].push_back(id);
+  }
@@ -6,6 +6,9 @@
 #include <Tempest/UniformBuffer>
 #include <Tempest/UniformsLayout>
 
+#include <mutex>
+#include <vector>
+
 #include "bounds.h"
 #include "material.h"
 #include "resources.h"
@@ -28,6 +31,21 @@ class ObjectsBucket final {
       MAX_LIGHT    = 64,
       };
 
+    // light lists of objects, packed into power of two blocks
+    class LightPool final {
+      public:
+        void                assign(uint32_t& id, uint32_t& cnt, const Light* const* l, size_t count);
+        void                free  (uint32_t  id, uint32_t  cnt);
+        const Light* const* data  (uint32_t  id) const { return pool.data()+id; }
+
+      private:
+        static size_t       blockClass(size_t count);
+
+        std::mutex                sync;
+        std::vector<const Light*> pool;
+        std::vector<uint32_t>     freeList[7];
+      };
+
   public:
     enum {
       CAPACITY     = 128,
@@ -82,6 +100,7 @@ class ObjectsBucket final {
       public:
         UboStorage<UboAnim>     ani;
         UboStorage<UboMaterial> mat;
+        LightPool               light;
         bool                    commitUbo(Tempest::Device &device, uint8_t fId);
       };
 
@@ -148,35 +167,47 @@ class ObjectsBucket final {
       void                    alloc(ObjectsBucket& owner);
       };
 
+    // data, that is read by draw loops
     struct Object final {
       VboType                               vboType = VboType::NoVbo;
       const Tempest::VertexBuffer<Vertex>*  vbo     = nullptr;
       const Tempest::VertexBuffer<Vertex>*  vboM[Resources::MaxFramesInFlight] = {};
       const Tempest::VertexBuffer<VertexA>* vboA    = nullptr;
       const Tempest::IndexBuffer<uint32_t>* ibo     = nullptr;
-      Bounds                                bounds;
       Tempest::Matrix4x4                    pos;
-
-      Descriptors                           ubo;
       size_t                                storageAni = size_t(-1);
 
-      const Light*                          light[MAX_LIGHT] = {};
-      size_t                                lightCnt=0;
-      int                                   lightCacheKey[3]={};
-
-      size_t                                texAnim=0;
+      uint32_t                              lightId  = 0; // in Storage::light
+      uint32_t                              lightCnt = 0;
       uint64_t                              timeShift=0;
 
       bool                                  isValid() const { return vboType!=VboType::NoVbo; }
       };
 
+    struct ObjectCold final {
+      Bounds                                bounds;
+      int                                   lightCacheKey[3]={};
+      };
+
+    // bounding spheres of 'val', packed for batched culling
+    struct Spheres final {
+      std::vector<float>      x, y, z, r;
+      };
+
     Descriptors               uboShared;
 
-    Object                    val  [CAPACITY];
+    // slots are reused through free list; trailing free slots are released
+    std::vector<Object>       val;
+    std::vector<ObjectCold>   valCold;
+    std::vector<size_t>       freeList;
     size_t                    valSz=0;
-    size_t                    valLast=0;
-    Object*                   index[CAPACITY] = {};
-    size_t                    indexSz=0;
+    std::vector<size_t>       index;
+    // descriptors of non-shared ubo objects - never released, as they may be in use by frames in flight
+    std::vector<Descriptors>  uboObj;
+
+    Spheres                   sphere;
+    uint32_t                  validMask[CAPACITY/32] = {};
+    uint32_t                  morphMask[CAPACITY/32] = {};
     size_t                    polySz=0;
     size_t                    polyAvg=0;
 
@@ -197,15 +228,16 @@ class ObjectsBucket final {
     const Tempest::RenderPipeline* pLight   = nullptr;
     const Tempest::RenderPipeline* pShadow  = nullptr;
 
-    Object& implAlloc(const VboType type, const Bounds& bounds);
+    size_t  implAlloc(const VboType type, const Bounds& bounds);
     void    uboSetCommon(Descriptors& v);
     bool    groupVisibility(Painter3d& p);
+    void    updateSphere(size_t i);
 
     void    setObjMatrix(size_t i,const Tempest::Matrix4x4& m);
     void    setPose     (size_t i,const Pose& sk);
     void    setBounds   (size_t i,const Bounds& b);
 
-    void    setupLights (Object& val, bool noCache);
+    void    setupLights (size_t i, bool noCache);
 
     void    setAnim(Object& val, Tempest::Uniforms& ubo);
     template<class T>
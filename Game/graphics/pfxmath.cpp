@@ -0,0 +1,35 @@
+#include "pfxmath.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#include <emmintrin.h>
+#define PFXMATH_SSE2
+#endif
+
+void pfxIntegrate(float* px, float* py, float* pz, float* dx, float* dy, float* dz,
+                  const float* vel, size_t count, float dt, const Tempest::Vec3& g) {
+  size_t i = 0;
+#if defined(PFXMATH_SSE2)
+  const __m128 vdt = _mm_set1_ps(dt);
+  const __m128 gx  = _mm_set1_ps(g.x), gy = _mm_set1_ps(g.y), gz = _mm_set1_ps(g.z);
+  for(; i+4<=count; i+=4) {
+    const __m128 v  = _mm_loadu_ps(vel+i);
+    const __m128 ix = _mm_loadu_ps(dx+i);
+    const __m128 iy = _mm_loadu_ps(dy+i);
+    const __m128 iz = _mm_loadu_ps(dz+i);
+    _mm_storeu_ps(px+i,_mm_add_ps(_mm_loadu_ps(px+i),_mm_mul_ps(_mm_mul_ps(ix,v),vdt)));
+    _mm_storeu_ps(py+i,_mm_add_ps(_mm_loadu_ps(py+i),_mm_mul_ps(_mm_mul_ps(iy,v),vdt)));
+    _mm_storeu_ps(pz+i,_mm_add_ps(_mm_loadu_ps(pz+i),_mm_mul_ps(_mm_mul_ps(iz,v),vdt)));
+    _mm_storeu_ps(dx+i,_mm_add_ps(ix,gx));
+    _mm_storeu_ps(dy+i,_mm_add_ps(iy,gy));
+    _mm_storeu_ps(dz+i,_mm_add_ps(iz,gz));
+    }
+#endif
+  for(; i<count; ++i) {
+    px[i] += dx[i]*vel[i]*dt;
+    py[i] += dy[i]*vel[i]*dt;
+    pz[i] += dz[i]*vel[i]*dt;
+    dx[i] += g.x;
+    dy[i] += g.y;
+    dz[i] += g.z;
+    }
+  }
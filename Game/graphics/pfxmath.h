@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstddef>
+#include <Tempest/Point>
+
+// integration step of particles, stored as soa streams of 'count' floats:
+// pos += dir*velocity*dt; dir += gravity
+void pfxIntegrate(float* px, float* py, float* pz, float* dx, float* dy, float* dz,
+                  const float* vel, size_t count, float dt, const Tempest::Vec3& gravity);
@@ -3,19 +3,21 @@
 
 #include <cstring>
 #include <cassert>
+#include <atomic>
+#include <random>
 
 #include "graphics/submesh/pfxemittermesh.h"
 #include "graphics/dynamic/painter3d.h"
 #include "light.h"
 #include "particlefx.h"
+#include "pfxmath.h"
 #include "pose.h"
 #include "rendererstorage.h"
 #include "skeleton.h"
+#include "utils/workers.h"
 
 using namespace Tempest;
 
-std::mt19937 PfxObjects::rndEngine;
-
 PfxObjects::Emitter::Emitter(PfxObjects::Bucket& b, size_t id)
   :bucket(&b), id(id) {
   }
@@ -104,10 +106,10 @@ PfxObjects::Bucket::Bucket(const ParticleFx &ow, PfxObjects *parent)
   Bounds bbox;
   bbox.assign(Vec3(0,0,0),1000000); //TODO
 
-  const Tempest::VertexBuffer<Resources::Vertex>* vbo[Resources::MaxFramesInFlight] = {};
+  const Tempest::VertexBuffer<Resources::Vertex>* vboGpu[Resources::MaxFramesInFlight] = {};
   for(size_t i=0;i<Resources::MaxFramesInFlight;++i)
-    vbo[i] = &vboGpu[i];
-  item = parent->visual.get(vbo,owner->visMaterial,bbox);
+    vboGpu[i] = &vbo.gpu(uint8_t(i));
+  item = parent->visual.get(vboGpu,owner->visMaterial,bbox);
 
   Matrix4x4 ident;
   ident.identity();
@@ -121,7 +123,7 @@ PfxObjects::Bucket::Bucket(const ParticleFx &ow, PfxObjects *parent)
 
 bool PfxObjects::Bucket::isEmpty() const {
   for(size_t i=0;i<Resources::MaxFramesInFlight;++i) {
-    if(vboGpu[i].size()>0)
+    if(vbo.gpu(uint8_t(i)).size()>0)
       return false;
     }
   return impl.size()==0;
@@ -141,10 +143,7 @@ size_t PfxObjects::Bucket::allocBlock() {
   b.offset = particles.size();
 
   particles.resize(particles.size()+blockSize);
-  vboCpu.resize(particles.size()*6);
-
-  for(size_t i=0; i<blockSize; ++i)
-    particles[i].life = 0;
+  vbo.resize(particles.size()*6);
   return block.size()-1;
   }
 
@@ -204,70 +203,70 @@ bool PfxObjects::Bucket::shrink() {
     }
   if(particles.size()!=block.size()*blockSize) {
     particles.resize(block.size()*blockSize);
-    vboCpu.resize(particles.size()*6);
+    vbo.resize(particles.size()*6);
     return true;
     }
   return false;
   }
 
 void PfxObjects::Bucket::init(PfxObjects::Block& emitter, size_t particle) {
-  auto& p   = particles[particle];
   auto& pfx = *owner;
+  Vec3  pos, dir;
+  float rotation = 0;
 
-  p.life    = uint16_t(randf(pfx.lspPartAvg,pfx.lspPartVar));
-  p.maxLife = p.life;
+  const uint16_t life = uint16_t(randf(pfx.lspPartAvg,pfx.lspPartVar));
 
   // TODO: pfx.shpDistribType, pfx.shpDistribWalkSpeed;
   switch(pfx.shpType) {
     case ParticleFx::EmitterType::Point:{
-      p.pos = Vec3();
+      pos = Vec3();
       break;
       }
     case ParticleFx::EmitterType::Line:{
       float at = randf();
-      p.pos = Vec3(at,at,at);
+      pos = Vec3(at,at,at);
       break;
       }
     case ParticleFx::EmitterType::Box:{
       if(pfx.shpIsVolume) {
-        p.pos = Vec3(randf()*2.f-1.f,
+        pos = Vec3(randf()*2.f-1.f,
                      randf()*2.f-1.f,
                      randf()*2.f-1.f);
-        p.pos*=0.5;
+        pos*=0.5;
         } else {
         // TODO
-        p.pos = Vec3(randf()*2.f-1.f,
+        pos = Vec3(randf()*2.f-1.f,
                      randf()*2.f-1.f,
                      randf()*2.f-1.f);
-        p.pos*=0.5;
+        pos*=0.5;
         }
       break;
       }
     case ParticleFx::EmitterType::Sphere:{
       float theta = float(2.0*M_PI)*randf();
       float phi   = std::acos(1.f - 2.f * randf());
-      p.pos = Vec3(std::sin(phi) * std::cos(theta),
+      pos = Vec3(std::sin(phi) * std::cos(theta),
                    std::sin(phi) * std::sin(theta),
                    std::cos(phi));
       if(pfx.shpIsVolume)
-        p.pos*=randf();
+        pos*=randf();
       break;
       }
     case ParticleFx::EmitterType::Circle:{
       float a = float(2.0*M_PI)*randf();
-      p.pos = Vec3(std::sin(a),
+      pos = Vec3(std::sin(a),
                    0,
                    std::cos(a));
-      p.pos*=0.5;
+      pos*=0.5;
       if(pfx.shpIsVolume)
-        p.pos = p.pos*std::sqrt(randf());
+        pos = pos*std::sqrt(randf());
       break;
       }
     case ParticleFx::EmitterType::Mesh:{
-      p.pos = Vec3();
+      pos = Vec3();
       if(pfx.shpMesh!=nullptr) {
         auto pos = pfx.shpMesh->randCoord(randf());
-        p.pos = emitter.direction[0]*pos.x +
+        pos = emitter.direction[0]*pos.x +
                 emitter.direction[1]*pos.y +
                 emitter.direction[2]*pos.z;
         }
@@ -276,24 +275,24 @@ void PfxObjects::Bucket::init(PfxObjects::Block& emitter, size_t particle) {
     }
 
   Vec3 dim = pfx.shpDim*pfx.shpScale(emitter.timeTotal);
-  p.pos.x*=dim.x;
-  p.pos.y*=dim.y;
-  p.pos.z*=dim.z;
+  pos.x*=dim.x;
+  pos.y*=dim.y;
+  pos.z*=dim.z;
 
   switch(pfx.shpFOR) {
     case ParticleFx::Frame::Object: {
-      p.pos += emitter.direction[0]*pfx.shpOffsetVec.x +
+      pos += emitter.direction[0]*pfx.shpOffsetVec.x +
                emitter.direction[1]*pfx.shpOffsetVec.y +
                emitter.direction[2]*pfx.shpOffsetVec.z;
       break;
       }
     case ParticleFx::Frame::World: {
-      p.pos += pfx.shpOffsetVec;
+      pos += pfx.shpOffsetVec;
       break;
       }
     }
 
-  p.velocity = randf(pfx.velAvg,pfx.velVar);
+  const float velocity = randf(pfx.velAvg,pfx.velVar);
 
   float dirRotation = 0;
   switch(pfx.dirMode) {
@@ -305,7 +304,7 @@ void PfxObjects::Bucket::init(PfxObjects::Block& emitter, size_t particle) {
       float dz    = sn * std::sin(theta);
 
       dirRotation = std::atan2(dy,(dx>0 ? sn : -sn));
-      p.dir = Vec3(dx,dy,dz);
+      dir = Vec3(dx,dy,dz);
       break;
       }
     case ParticleFx::Dir::Dir: {
@@ -320,27 +319,27 @@ void PfxObjects::Bucket::init(PfxObjects::Block& emitter, size_t particle) {
          pfx.shpType         ==ParticleFx::EmitterType::Sphere &&
          pfx.dirAngleHeadVar>=180 &&
          pfx.dirAngleElevVar>=180 ) {
-        dx = p.pos.x;
-        dy = p.pos.y;
-        dz = p.pos.z;
+        dx = pos.x;
+        dy = pos.y;
+        dz = pos.z;
         }
 
       switch(pfx.dirFOR) {
         case ParticleFx::Frame::Object: {
-          p.dir = emitter.direction[0]*dx +
+          dir = emitter.direction[0]*dx +
                   emitter.direction[1]*dy +
                   emitter.direction[2]*dz;
-          float l = p.dir.manhattanLength();
+          float l = dir.manhattanLength();
           if(l>0)
-            p.dir/=l;
+            dir/=l;
           break;
           }
         case ParticleFx::Frame::World: {
-          p.dir = Vec3(dx,dy,dz);
+          dir = Vec3(dx,dy,dz);
           break;
           }
         }
-      dirRotation = std::atan2(p.dir.x,p.dir.y);
+      dirRotation = std::atan2(dir.x,dir.y);
       break;
       }
     case ParticleFx::Dir::Target:
@@ -350,73 +349,111 @@ void PfxObjects::Bucket::init(PfxObjects::Block& emitter, size_t particle) {
 
   switch(pfx.visOrientation){
     case ParticleFx::Orientation::None:
-      p.rotation = randf()*float(2.0*M_PI);
+      rotation = randf()*float(2.0*M_PI);
       break;
     case ParticleFx::Orientation::Velocity:
-      p.rotation = dirRotation;
+      rotation = dirRotation;
       break;
     case ParticleFx::Orientation::Velocity3d:
-      p.rotation = dirRotation;
+      rotation = dirRotation;
       break;
     }
 
   if(pfx.useEmittersFOR==0)
-    p.pos += emitter.pos;
+    pos += emitter.pos;
+
+  auto& p = particles;
+  p.life    [particle] = life;
+  p.maxLife [particle] = life;
+  p.posX    [particle] = pos.x;
+  p.posY    [particle] = pos.y;
+  p.posZ    [particle] = pos.z;
+  p.dirX    [particle] = dir.x;
+  p.dirY    [particle] = dir.y;
+  p.dirZ    [particle] = dir.z;
+  p.velocity[particle] = velocity;
+  p.rotation[particle] = rotation;
   }
 
+
 void PfxObjects::Bucket::finalize(size_t particle) {
-  Vertex* v = &vboCpu[particle*6];
+  Vertex* v = &vbo[particle*6];
   std::memset(v,0,sizeof(*v)*6);
-  auto& p = particles[particle];
-  p = {};
+  vbo.invalidate(particle*6,particle*6+6);
+  particles.reset(particle);
   }
 
-void PfxObjects::Bucket::tick(Block& sys, size_t particle, uint64_t dt) {
-  ParState& ps = particles[particle+sys.offset];
-  if(ps.life==0)
-    return;
+void PfxObjects::Bucket::tick(Block& sys, uint64_t dt) {
+  auto&        p   = particles;
+  const size_t b   = sys.offset;
+  const size_t e   = sys.offset+blockSize;
 
-  if(ps.life<=dt){
-    ps.life = 0;
-    sys.count--;
-    finalize(particle+sys.offset);
-    return;
+  for(size_t i=b; i<e; ++i) {
+    if(p.life[i]==0)
+      continue;
+    if(p.life[i]<=dt) {
+      p.life[i] = 0;
+      sys.count--;
+      finalize(i);
+      continue;
+      }
+    p.life[i] = uint16_t(p.life[i]-dt);
     }
 
-  auto&       pfx  = *owner;
-  const float dtF  = float(dt);
-  Vec3        dpos = {};
+  auto&       pfx = *owner;
+  const float dtF = float(dt);
+  const Vec3  g   = pfx.flyGravity*dtF;
 
-  switch(pfx.dirMode) {
-    case ParticleFx::Dir::Dir:
-      dpos = ps.dir*ps.velocity;
-      break;
-    case ParticleFx::Dir::Target: {
-      Vec3 dx, to;
-      if(sys.hasTarget)
-        to = sys.target; else
-        to = sys.pos;
-
-      dx = to - (ps.pos+sys.pos);
-      const float dplen = dx.manhattanLength();
-      if(ps.velocity*dtF>dplen)
-        dpos = dx/dtF; else
-        dpos = dx*ps.velocity/dplen;
-      break;
-      }
-    case ParticleFx::Dir::Rand:
-      dpos = ps.dir*ps.velocity;
-      break;
+  if(pfx.dirMode!=ParticleFx::Dir::Target) {
+    // dead slots are integrated too: they are overwritten by 'init' anyway
+    pfxIntegrate(&p.posX[b],&p.posY[b],&p.posZ[b],&p.dirX[b],&p.dirY[b],&p.dirZ[b],&p.velocity[b],blockSize,dtF,g);
+    return;
     }
 
-  // eval particle
-  ps.life  = uint16_t(ps.life-dt);
-  ps.pos  += dpos*dtF;
-  ps.dir  += pfx.flyGravity*dtF;
+  const Vec3 to = sys.hasTarget ? sys.target : sys.pos;
+  for(size_t i=b; i<e; ++i) {
+    if(p.life[i]==0)
+      continue;
+    Vec3        dx    = to - (Vec3(p.posX[i],p.posY[i],p.posZ[i])+sys.pos);
+    const float dplen = dx.manhattanLength();
+    Vec3        dpos;
+    if(p.velocity[i]*dtF>dplen)
+      dpos = dx/dtF; else
+      dpos = dx*p.velocity[i]/dplen;
+    p.posX[i] += dpos.x*dtF;
+    p.posY[i] += dpos.y*dtF;
+    p.posZ[i] += dpos.z*dtF;
+    p.dirX[i] += g.x;
+    p.dirY[i] += g.y;
+    p.dirZ[i] += g.z;
+    }
+  }
+
+void PfxObjects::ParState::resize(size_t sz) {
+  // new slots are zero - free
+  life    .resize(sz);
+  maxLife .resize(sz,1);
+  posX    .resize(sz);
+  posY    .resize(sz);
+  posZ    .resize(sz);
+  dirX    .resize(sz);
+  dirY    .resize(sz);
+  dirZ    .resize(sz);
+  velocity.resize(sz);
+  rotation.resize(sz);
+  }
+
+void PfxObjects::ParState::reset(size_t i) {
+  life[i]     = 0;
+  maxLife[i]  = 1;
+  posX[i]     = posY[i] = posZ[i] = 0;
+  dirX[i]     = dirY[i] = dirZ[i] = 0;
+  velocity[i] = 0;
+  rotation[i] = 0;
   }
 
-float PfxObjects::ParState::lifeTime() const {
-  return 1.f-life/float(maxLife);
+float PfxObjects::ParState::lifeTime(size_t i) const {
+  return 1.f-life[i]/float(maxLife[i]);
   }
 
 
@@ -493,10 +530,26 @@ void PfxObjects::tick(uint64_t ticks) {
   ctx.leftA[2] = ctx.left[2];
   ctx.topA[1]  = -1;
 
-  for(auto& i:bucket) {
-    tickSys(*i,dt);
-    buildVbo(*i,ctx);
-    }
+  // buckets are independent; blocks of one bucket write disjoint ranges of vbo
+  Workers::parallelFor(bucket,1,[this,dt](std::unique_ptr<Bucket>& b){
+    tickSys(*b,dt);
+    });
+
+  struct Job {
+    Bucket*      b;
+    const Block* p;
+    };
+  static thread_local std::vector<Job> jobs;
+  jobs.clear();
+  for(auto& b:bucket)
+    for(auto& p:b->block)
+      if(p.count>0) {
+        b->vbo.invalidate(p.offset*6,(p.offset+b->blockSize)*6);
+        jobs.push_back(Job{b.get(),&p});
+        }
+  Workers::parallelFor(jobs,[this,&ctx](Job& j){
+    buildVbo(*j.b,*j.p,ctx);
+    });
   lastUpdate = ticks;
   }
 
@@ -511,17 +564,15 @@ void PfxObjects::preFrameUpdate(uint8_t fId) {
     }
 
   auto& device = scene.storage.device;
-  for(auto& pi:bucket) {
-    auto& i=*pi;
-    auto& vbo = i.vboGpu[fId];
-    if(i.vboCpu.size()!=vbo.size())
-      vbo = device.vboDyn(i.vboCpu); else
-      vbo.update(i.vboCpu);
-    }
+  for(auto& i:bucket)
+    i->vbo.commit(device,fId);
   }
 
 float PfxObjects::randf() {
-  return float(rndEngine()%10000)/10000.f;
+  // particles are simulated on workers - stream per thread
+  static std::atomic<uint32_t>     seed{0};
+  static thread_local std::mt19937 rndEngine(std::mt19937::default_seed+seed.fetch_add(1));
+  return float(rndEngine()>>8)*(1.f/16777216.f);
   }
 
 float PfxObjects::randf(float base, float var) {
@@ -577,8 +628,7 @@ void PfxObjects::tickSys(PfxObjects::Bucket &b, uint64_t dt) {
 
     auto& p = b.getBlock(emitter);
     if(p.count>0) {
-      for(size_t i=0;i<b.blockSize;++i)
-        b.tick(p,i,dt);
+      b.tick(p,dt);
       if(p.count==0 && !process) {
         // free mem
         b.freeBlock(emitter.block);
@@ -605,8 +655,7 @@ void PfxObjects::tickSysEmit(PfxObjects::Bucket& b, PfxObjects::Block& p, uint64
   size_t lastI = 0;
   for(size_t id=1; emited>0; ++id) {
     const size_t i = id%b.blockSize;
-    ParState& ps = b.particles[i+p.offset];
-    if(ps.life==0) { // free slot
+    if(b.particles.life[i+p.offset]==0) { // free slot
       lastI = i;
       p.count++;
       b.init(p,i+p.offset);
@@ -635,7 +684,7 @@ static void cross(float* out,const float* u,const float* v) {
   out[2] = (u[0]*v[1] - u[1]*v[0]);
   }
 
-void PfxObjects::buildVbo(PfxObjects::Bucket &b, const VboContext& ctx) {
+void PfxObjects::buildVbo(PfxObjects::Bucket &b, const Block& p, const VboContext& ctx) {
   static const float dx[6] = {-0.5f, 0.5f, -0.5f,  0.5f,  0.5f, -0.5f};
   static const float dy[6] = { 0.5f, 0.5f, -0.5f,  0.5f, -0.5f, -0.5f};
 
@@ -655,90 +704,85 @@ void PfxObjects::buildVbo(PfxObjects::Bucket &b, const VboContext& ctx) {
     top  = ctx.topA;
     }
 
-  for(auto& p:b.block) {
-    if(p.count==0)
+  auto& ps = b.particles;
+  for(size_t id=p.offset;id<p.offset+b.blockSize;++id) {
+    Vertex* v = &b.vbo[id*6];
+
+    if(ps.life[id]==0) {
+      std::memset(v,0,6*sizeof(*v));
       continue;
+      }
 
-    for(size_t i=0;i<b.blockSize;++i) {
-      ParState& ps = b.particles[i+p.offset];
-      Vertex*   v  = &b.vboCpu[(p.offset+i)*6];
+    const float a   = ps.lifeTime(id);
+    const Vec3  cl  = colorS*(1.f-a)        + colorE*a;
+    const float clA = visAlphaStart*(1.f-a) + visAlphaEnd*a;
+
+    const float scale = 1.f*(1.f-a) + a*visSizeEndScale;
+    const float szX   = visSizeStart.x*scale;
+    const float szY   = visSizeStart.y*scale;
+    const float szZ   = 0.1f*((szX+szY)*0.5f);
+
+    float l[3]={};
+    float t[3]={};
+
+    if(pfx.visOrientation==ParticleFx::Orientation::Velocity3d) {
+      static float k1 = 1, k2 = -1;
+      t[0] = k1* ps.dirX[id];
+      t[1] = k1* ps.dirY[id];
+      t[2] = k1* ps.dirZ[id];
+      cross(l, t,ctx.z);
+      l[0]*=k2;
+      l[1]*=k2;
+      l[2]*=k2;
+      } else {
+      rotate(l,t,ps.rotation[id],left,top);
+      }
 
-      if(ps.life==0) {
-        std::memset(v,0,6*sizeof(*v));
-        continue;
-        }
+    struct Color {
+      uint8_t r=255;
+      uint8_t g=255;
+      uint8_t b=255;
+      uint8_t a=255;
+      } color;
+
+    if(visAlphaFunc==Material::AlphaFunc::AdditiveLight) {
+      color.r = uint8_t(cl.x*clA);
+      color.g = uint8_t(cl.y*clA);
+      color.b = uint8_t(cl.z*clA);
+      color.a = uint8_t(255);
+      }
+    else if(visAlphaFunc==Material::AlphaFunc::Transparent) {
+      color.r = uint8_t(cl.x);
+      color.g = uint8_t(cl.y);
+      color.b = uint8_t(cl.z);
+      color.a = uint8_t(clA*255);
+      }
 
-      const float a   = ps.lifeTime();
-      const Vec3  cl  = colorS*(1.f-a)        + colorE*a;
-      const float clA = visAlphaStart*(1.f-a) + visAlphaEnd*a;
-
-      const float scale = 1.f*(1.f-a) + a*visSizeEndScale;
-      const float szX   = visSizeStart.x*scale;
-      const float szY   = visSizeStart.y*scale;
-      const float szZ   = 0.1f*((szX+szY)*0.5f);
-
-      float l[3]={};
-      float t[3]={};
-
-      if(pfx.visOrientation==ParticleFx::Orientation::Velocity3d) {
-        static float k1 = 1, k2 = -1;
-        t[0] = k1* ps.dir.x;
-        t[1] = k1* ps.dir.y;
-        t[2] = k1* ps.dir.z;
-        cross(l, t,ctx.z);
-        l[0]*=k2;
-        l[1]*=k2;
-        l[2]*=k2;
+    for(int i=0;i<6;++i) {
+      float sx = l[0]*dx[i]*szX + t[0]*dy[i]*szY;
+      float sy = l[1]*dx[i]*szX + t[1]*dy[i]*szY;
+      float sz = l[2]*dx[i]*szX + t[2]*dy[i]*szY;
+
+      if(b.owner->useEmittersFOR) {
+        v[i].pos[0] = p.pos.x + ps.posX[id] + sx;
+        v[i].pos[1] = p.pos.y + ps.posY[id] + sy;
+        v[i].pos[2] = p.pos.z + ps.posZ[id] + sz;
         } else {
-        rotate(l,t,ps.rotation,left,top);
+        v[i].pos[0] = ps.posX[id] + sx;
+        v[i].pos[1] = ps.posY[id] + sy;
+        v[i].pos[2] = ps.posZ[id] + sz;
         }
 
-      struct Color {
-        uint8_t r=255;
-        uint8_t g=255;
-        uint8_t b=255;
-        uint8_t a=255;
-        } color;
-
-      if(visAlphaFunc==Material::AlphaFunc::AdditiveLight) {
-        color.r = uint8_t(cl.x*clA);
-        color.g = uint8_t(cl.y*clA);
-        color.b = uint8_t(cl.z*clA);
-        color.a = uint8_t(255);
-        }
-      else if(visAlphaFunc==Material::AlphaFunc::Transparent) {
-        color.r = uint8_t(cl.x);
-        color.g = uint8_t(cl.y);
-        color.b = uint8_t(cl.z);
-        color.a = uint8_t(clA*255);
+      if(pfx.visZBias) {
+        v[i].pos[0] -= szZ*ctx.z[0];
+        v[i].pos[1] -= szZ*ctx.z[1];
+        v[i].pos[2] -= szZ*ctx.z[2];
         }
 
-      for(int i=0;i<6;++i) {
-        float sx = l[0]*dx[i]*szX + t[0]*dy[i]*szY;
-        float sy = l[1]*dx[i]*szX + t[1]*dy[i]*szY;
-        float sz = l[2]*dx[i]*szX + t[2]*dy[i]*szY;
-
-        if(b.owner->useEmittersFOR) {
-          v[i].pos[0] = p.pos.x + ps.pos.x + sx;
-          v[i].pos[1] = p.pos.y + ps.pos.y + sy;
-          v[i].pos[2] = p.pos.z + ps.pos.z + sz;
-          } else {
-          v[i].pos[0] = ps.pos.x + sx;
-          v[i].pos[1] = ps.pos.y + sy;
-          v[i].pos[2] = ps.pos.z + sz;
-          }
-
-        if(pfx.visZBias) {
-          v[i].pos[0] -= szZ*ctx.z[0];
-          v[i].pos[1] -= szZ*ctx.z[1];
-          v[i].pos[2] -= szZ*ctx.z[2];
-          }
+      v[i].uv[0]  = (dx[i]+0.5f);
+      v[i].uv[1]  = (0.5f-dy[i]);
 
-        v[i].uv[0]  = (dx[i]+0.5f);
-        v[i].uv[1]  = (0.5f-dy[i]);
-
-        std::memcpy(&v[i].color,&color,4);
-        }
+      std::memcpy(&v[i].color,&color,4);
       }
     }
   }
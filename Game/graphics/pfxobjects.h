@@ -5,8 +5,8 @@
 
 #include <memory>
 #include <list>
-#include <random>
 
+#include "graphics/dynamic/streambuffer.h"
 #include "visualobjects.h"
 #include "resources.h"
 
@@ -84,24 +84,26 @@ class PfxObjects final {
       bool          active       = true;
       };
 
+    // particles in structure-of-arrays layout
     struct ParState final {
-      uint16_t      life=0,maxLife=1;
-      Tempest::Vec3 pos, dir;
-
-      float         velocity=0;
-      float         rotation=0;
-
-      float         lifeTime() const;
+      std::vector<uint16_t> life, maxLife;
+      std::vector<float>    posX, posY, posZ;
+      std::vector<float>    dirX, dirY, dirZ;
+      std::vector<float>    velocity, rotation;
+
+      size_t                size() const { return life.size(); }
+      void                  resize(size_t sz);
+      void                  reset(size_t i);
+      float                 lifeTime(size_t i) const;
       };
 
     struct Bucket final {
       Bucket(const ParticleFx &ow, PfxObjects* parent);
 
       ObjectsBucket::Item         item;
-      Tempest::VertexBufferDyn<Vertex> vboGpu[Resources::MaxFramesInFlight];
-      std::vector<Vertex>         vboCpu;
+      StreamBuffer<Vertex>        vbo;
 
-      std::vector<ParState>       particles;
+      ParState                    particles;
 
       std::vector<ImplEmitter>    impl;
       std::vector<Block>          block;
@@ -122,7 +124,7 @@ class PfxObjects final {
 
       void                        init    (Block& emitter, size_t particle);
       void                        finalize(size_t particle);
-      void                        tick    (Block& sys, size_t particle, uint64_t dt);
+      void                        tick    (Block& sys, uint64_t dt);
       };
 
     struct SpriteEmitter {
@@ -147,7 +149,7 @@ class PfxObjects final {
     Bucket&                       getBucket(const Material& mat, const ZenLoad::zCVobData& vob);
     void                          tickSys    (Bucket& b, uint64_t dt);
     void                          tickSysEmit(Bucket& b, Block&  p, uint64_t emited);
-    void                          buildVbo(Bucket& b, const VboContext& ctx);
+    void                          buildVbo(Bucket& b, const Block& p, const VboContext& ctx);
 
     const SceneGlobals&           scene;
     VisualObjects&                visual;
@@ -158,6 +160,5 @@ class PfxObjects final {
 
     Tempest::Vec3                 viewePos={};
 
-    static std::mt19937           rndEngine;
     uint64_t                      lastUpdate=0;
   };
@@ -266,12 +266,17 @@ bool Pose::update(uint64_t tickCount) {
   return false;
   }
 
+void Pose::skipUpdate(uint64_t tickCount) {
+  if(lastUpdate!=0)
+    lastUpdate = tickCount;
+  }
+
 bool Pose::updateFrame(const Animation::Sequence &s,
                        uint64_t barrier, uint64_t sTime, uint64_t now) {
   auto&        d         = *s.data;
   const size_t numFrames = d.numFrames;
   const size_t idSize    = d.nodeIndex.size();
-  if(numFrames==0 || idSize==0 || d.samples.size()%idSize!=0)
+  if(numFrames==0 || idSize==0 || d.soa.size()<numFrames*d.soaStride*7)
     return false;
 
   (void)barrier;
@@ -297,13 +302,9 @@ bool Pose::updateFrame(const Animation::Sequence &s,
     frameB = d.numFrames-1-frameB;
     }
 
-  auto* sampleA = &d.samples[size_t(frameA*idSize)];
-  auto* sampleB = &d.samples[size_t(frameB*idSize)];
-
-  for(size_t i=0;i<idSize;++i) {
-    auto smp = mix(sampleA[i],sampleB[i],a);
-    base[d.nodeIndex[i]] = mkMatrix(smp);
-    }
+  auto* sampleA = &d.soa[size_t(frameA)*d.soaStride*7];
+  auto* sampleB = &d.soa[size_t(frameB)*d.soaStride*7];
+  mixSamples(sampleA,sampleB,d.soaStride,idSize,a,d.nodeIndex.data(),base.data());
   return true;
   }
 
@@ -311,16 +312,14 @@ void Pose::mkSkeleton(const Animation::Sequence &s, BodyState bs) {
   if(skeleton==nullptr)
     return;
   Matrix4x4 m = mkBaseTranslation(&s,bs);
-  if(skeleton->ordered)
-    mkSkeleton(m); else
-    mkSkeleton(m,size_t(-1));
+  mkSkeleton(m);
   }
 
 void Pose::mkSkeleton(const Matrix4x4 &mt) {
   if(skeleton==nullptr)
     return;
   auto& nodes=skeleton->nodes;
-  for(size_t i=0; i<nodes.size(); ++i) {
+  for(auto i:skeleton->order) {
     if(nodes[i].parent==size_t(-1)) {
       tr[i] = mt*base[i];
       } else {
@@ -329,18 +328,6 @@ void Pose::mkSkeleton(const Matrix4x4 &mt) {
     }
   }
 
-void Pose::mkSkeleton(const Tempest::Matrix4x4 &mt, size_t parent) {
-  if(skeleton==nullptr)
-    return;
-  auto& nodes=skeleton->nodes;
-  for(size_t i=0;i<nodes.size();++i){
-    if(nodes[i].parent!=parent)
-      continue;
-    tr[i] = mt*base[i];
-    mkSkeleton(tr[i],i);
-    }
-  }
-
 const Animation::Sequence* Pose::getNext(const AnimationSolver &solver, const Layer& lay) {
   auto sq = lay.seq;
 
@@ -42,6 +42,8 @@ class Pose final {
     void               interrupt();
     void               stopAllAnim();
     bool               update(uint64_t tickCount);
+    // keep current skeleton, but advance time barrier; next update samples frames at it's own time
+    void               skipUpdate(uint64_t tickCount);
     void               processLayers(AnimationSolver &solver, int comb, uint64_t tickCount);
 
     Tempest::Vec3      animMoveSpeed(uint64_t tickCount, uint64_t dt) const;
@@ -87,7 +89,6 @@ class Pose final {
     auto mkBaseTranslation(const Animation::Sequence *s, BodyState bs) -> Tempest::Matrix4x4;
     void mkSkeleton(const Animation::Sequence &s, BodyState bs);
     void mkSkeleton(const Tempest::Matrix4x4 &mt);
-    void mkSkeleton(const Tempest::Matrix4x4 &mt, size_t parent);
     void zeroSkeleton();
 
     bool updateFrame(const Animation::Sequence &s, uint64_t barrier, uint64_t sTime, uint64_t now);
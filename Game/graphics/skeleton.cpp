@@ -35,6 +35,18 @@ Skeleton::Skeleton(const ZenLoad::zCModelMeshLib &src, std::string meshLib)
     if(nodes[i].parent==size_t(-1))
       rootNodes.push_back(i);
 
+  order.reserve(nodes.size());
+  if(ordered) {
+    for(size_t i=0;i<nodes.size();++i)
+      order.push_back(i);
+    } else {
+    order = rootNodes;
+    for(size_t i=0;i<order.size();++i)
+      for(size_t r=0;r<nodes.size();++r)
+        if(nodes[r].parent==order[i])
+          order.push_back(r);
+    }
+
   anim = Resources::loadAnimation(this->meshLib);
 
   auto tr = src.getRootNodeTranslation();
@@ -21,6 +21,7 @@ class Skeleton final {
     bool                            ordered=true;
     std::vector<Node>               nodes;
     std::vector<size_t>             rootNodes;
+    std::vector<size_t>             order; // parent goes before child
     std::vector<Tempest::Matrix4x4> tr;
     std::array<float,3>             rootTr={};
 
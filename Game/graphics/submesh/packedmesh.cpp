@@ -12,8 +12,10 @@ PackedMesh::PackedMesh(const ZenLoad::zCMesh& mesh, PkgType type) {
   mesh.getBoundingBox(bbox[0],bbox[1]);
   if(type==PK_Visual || type==PK_VisualLnd) {
     subMeshes.resize(mesh.getMaterials().size());
-    for(size_t i=0;i<subMeshes.size();++i)
-      subMeshes[i].material = mesh.getMaterials()[i];
+    for(size_t i=0;i<subMeshes.size();++i) {
+      subMeshes[i].material   = mesh.getMaterials()[i];
+      subMeshes[i].materialId = uint32_t(i);
+      }
     }
 
   if(type==PK_Physic) {
@@ -196,8 +198,10 @@ void PackedMesh::split(std::vector<SubMesh>& out, SubMesh& src) {
 
   for(int pass=0; pass<3; ++pass) {
     SubMesh left, right;
-    left .material = src.material;
-    right.material = src.material;
+    left .material   = src.material;
+    right.material   = src.material;
+    left .materialId = src.materialId;
+    right.materialId = src.materialId;
 
     for(size_t i=0; i<src.indices.size(); i+=3) {
       auto& a = vertices[src.indices[i+0]].Position;
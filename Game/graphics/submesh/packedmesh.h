@@ -23,12 +23,15 @@ class PackedMesh {
     struct SubMesh final {
       ZenLoad::zCMaterialData material;
       std::vector<uint32_t>   indices;
+      // index in source material list, or -1 for generated materials
+      uint32_t                materialId = uint32_t(-1);
       };
 
     std::vector<WorldVertex>   vertices;
     std::vector<SubMesh>       subMeshes;
     ZMath::float3              bbox[2] = {};
 
+    PackedMesh() = default;
     PackedMesh(const ZenLoad::zCMesh& mesh, PkgType type);
 
   private:
@@ -102,7 +102,7 @@ void VisualObjects::draw(Tempest::Encoder<Tempest::CommandBuffer>& enc, Painter3
 void VisualObjects::drawGBuffer(Tempest::Encoder<CommandBuffer>& enc, Painter3d& painter, uint8_t fId) {
   mkIndex();
 
-  Workers::parallelFor(index,[&painter](ObjectsBucket* c){
+  Workers::parallelFor(index,1,[&painter](ObjectsBucket* c){
     c->visibilityPass(painter);
     });
 
@@ -117,12 +117,12 @@ void VisualObjects::drawGBuffer(Tempest::Encoder<CommandBuffer>& enc, Painter3d&
 void VisualObjects::drawShadow(Tempest::Encoder<Tempest::CommandBuffer>& enc, Painter3d& painter, uint8_t fId, int layer) {
   if(layer+1==Resources::ShadowLayers) {
     mkIndex();
-    Workers::parallelFor(index.data(),index.data()+lastSolidBucket,[&painter](ObjectsBucket* c){
+    Workers::parallelFor(index.data(),index.data()+lastSolidBucket,1,[&painter](ObjectsBucket* c){
       c->visibilityPass(painter);
       });
     commitUbo(fId);
     } else {
-    Workers::parallelFor(index.data(),index.data()+lastSolidBucket,[&painter](ObjectsBucket* c){
+    Workers::parallelFor(index.data(),index.data()+lastSolidBucket,1,[&painter](ObjectsBucket* c){
       c->visibilityPassAnd(painter);
       });
     }
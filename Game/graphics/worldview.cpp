@@ -47,21 +47,7 @@ void WorldView::tick(uint64_t /*dt*/) {
   }
 
 size_t WorldView::addLight(const ZenLoad::zCVobData& vob) {
-  Light l;
-  l.setPosition(Vec3(vob.position.x,vob.position.y,vob.position.z));
-
-  if(vob.zCVobLight.dynamic.rangeAniScale.size()>0) {
-    l.setRange(vob.zCVobLight.dynamic.rangeAniScale,vob.zCVobLight.range,vob.zCVobLight.dynamic.rangeAniFPS,vob.zCVobLight.dynamic.rangeAniSmooth);
-    } else {
-    l.setRange(vob.zCVobLight.range);
-    }
-
-  if(vob.zCVobLight.dynamic.colorAniList.size()>0) {
-    l.setColor(vob.zCVobLight.dynamic.colorAniList,vob.zCVobLight.dynamic.colorAniListFPS,vob.zCVobLight.dynamic.colorAniSmooth);
-    } else {
-    l.setColor(vob.zCVobLight.color);
-    }
-
+  Light l(vob);
   needToUpdateUbo = true;
   return sGlobal.lights.add(std::move(l));
   }
@@ -72,6 +58,8 @@ void WorldView::setModelView(const Matrix4x4& view, const Tempest::Matrix4x4* sh
   }
 
 void WorldView::setFrameGlobals(const Texture2d& shadow, uint64_t tickCount, uint8_t fId) {
+  // light index is rebuilt here, before objects query it in setupUbo
+  sGlobal.lights.tick(tickCount);
   if(needToUpdateUbo || &shadow!=sGlobal.shadowMap) {
     needToUpdateUbo = false;
     // wait before update all descriptors
@@ -80,7 +68,6 @@ void WorldView::setFrameGlobals(const Texture2d& shadow, uint64_t tickCount, uin
     visuals.setupUbo();
     }
   pfxGroup.tick(tickCount);
-  sGlobal.lights.tick(tickCount);
   sGlobal .setTime(tickCount);
   sGlobal .commitUbo(fId);
 
@@ -29,6 +29,7 @@ class WorldView {
 
     Tempest::Matrix4x4        viewProj(const Tempest::Matrix4x4 &view) const;
     const Tempest::Matrix4x4& projective() const { return proj; }
+    const Tempest::Matrix4x4& viewProject() const { return sGlobal.viewProject(); }
     const Light&              mainLight() const;
 
     void tick(uint64_t dt);
@@ -718,6 +718,8 @@ void MainWindow::onWorldLoaded() {
   device.waitIdle();
   for(auto& c:commandDynamic)
     c = device.commandBuffer();
+  // previous world is gone and gpu is idle - drop assets over budget
+  Resources::trim();
 
   if(auto pl = gothic.player())
     pl->multSpeed(1.f);
@@ -34,10 +34,15 @@
 #pragma GCC diagnostic pop
 #endif
 
+#include <Tempest/Application>
+#include <Tempest/Log>
+
 #include <algorithm>
 #include <cmath>
 
 #include "world/bullet.h"
+#include "world/world.h"
+#include "world/worldcache.h"
 #include "graphics/submesh/packedmesh.h"
 
 const float DynamicWorld::ghostPadding=50-22.5f;
@@ -78,12 +83,16 @@ struct DynamicWorld::Broadphase : btDbvtBroadphase {
 
   Broadphase() {
     m_deferedcollide = true;
-    rayTestStk.reserve(btDbvt::DOUBLE_STACKSIZE);
     m_paircache->setOverlapFilterCallback(&overlapFilter);
     }
 
   void rayTest(const btVector3& rayFrom, const btVector3& rayTo, btBroadphaseRayCallback& rayCallback,
                const btVector3& aabbMin, const btVector3& aabbMax) {
+    // per-thread traversal stack: ray queries may come from workers
+    static thread_local btAlignedObjectArray<const btDbvtNode*> rayTestStk;
+    if(rayTestStk.capacity()==0)
+      rayTestStk.reserve(btDbvt::DOUBLE_STACKSIZE);
+
     BroadphaseRayTester callback(rayCallback);
     btAlignedObjectArray<const btDbvtNode*>* stack = &rayTestStk;
 
@@ -110,8 +119,7 @@ struct DynamicWorld::Broadphase : btDbvtBroadphase {
         callback);
     }
 
-  btAlignedObjectArray<const btDbvtNode*> rayTestStk;
-  OverlapFilter                           overlapFilter;
+  OverlapFilter overlapFilter;
   };
 
 struct DynamicWorld::NpcBody : btRigidBody {
@@ -470,7 +478,34 @@ struct DynamicWorld::BBoxList final {
   DynamicWorld&        wrld;
   };
 
-DynamicWorld::DynamicWorld(World&,const ZenLoad::zCMesh& worldMesh) {
+static btMultimaterialTriangleMeshShape* mkLandShape(PhysicVbo& mesh, WorldCache& cache) {
+  size_t   size = 0;
+  uint8_t* data = cache.readBlob(size);
+  if(data!=nullptr && size>=sizeof(btQuantizedBvh)) {
+    if(auto bvh = btOptimizedBvh::deSerializeInPlace(data,unsigned(size),false)) {
+      auto ret = new btMultimaterialTriangleMeshShape(&mesh,mesh.useQuantization(),false);
+      ret->setOptimizedBvh(bvh);
+      return ret;
+      }
+    }
+
+  auto ret = new btMultimaterialTriangleMeshShape(&mesh,mesh.useQuantization(),true);
+  auto bvh = ret->getOptimizedBvh();
+  if(bvh==nullptr) {
+    cache.writeBlob(nullptr,0);
+    return ret;
+    }
+  // serialized bvh must be 16-byte aligned
+  const unsigned sz  = bvh->calculateSerializeBufferSize();
+  void*          buf = btAlignedAlloc(sz,16);
+  if(bvh->serializeInPlace(buf,sz,false))
+    cache.writeBlob(buf,sz); else
+    cache.writeBlob(nullptr,0);
+  btAlignedFree(buf);
+  return ret;
+  }
+
+DynamicWorld::DynamicWorld(World& owner,const ZenLoad::zCMesh& worldMesh) {
   // collision configuration contains default setup for memory, collision setup
   conf.reset(new btDefaultCollisionConfiguration());
 
@@ -485,7 +520,8 @@ DynamicWorld::DynamicWorld(World&,const ZenLoad::zCMesh& worldMesh) {
   // the default constraint solver. For parallel processing you can use a different solver (see Extras/BulletMultiThreaded)
   world.reset(new btCollisionWorld(dispatcher.get(),broadphase.get(),conf.get()));
 
-  PackedMesh pkg(worldMesh,PackedMesh::PK_PhysicZoned);
+  bake.reset(new WorldCache(owner.name(),"phy"));
+  PackedMesh pkg = bake->packedMesh(worldMesh,PackedMesh::PK_PhysicZoned);
   sectors.resize(pkg.subMeshes.size());
   for(size_t i=0;i<sectors.size();++i)
     sectors[i] = pkg.subMeshes[i].material.matName;
@@ -510,15 +546,19 @@ DynamicWorld::DynamicWorld(World&,const ZenLoad::zCMesh& worldMesh) {
       }
     }
 
+  const uint64_t t0 = Tempest::Application::tickCount();
   if(!landMesh->isEmpty()) {
-    landShape.reset(new btMultimaterialTriangleMeshShape(landMesh.get(),landMesh->useQuantization(),true));
+    landShape.reset(mkLandShape(*landMesh,*bake));
     landBody = landObj();
     }
 
   if(!waterMesh->isEmpty()) {
-    waterShape.reset(new btMultimaterialTriangleMeshShape(waterMesh.get(),waterMesh->useQuantization(),true));
+    waterShape.reset(mkLandShape(*waterMesh,*bake));
     waterBody = waterObj();
     }
+  Tempest::Log::i("world cache[",owner.name(),"]: bvh ",(bake->isLoaded() ? "loaded" : "built")," in ",
+                  int(Tempest::Application::tickCount()-t0),"ms");
+  bake->flush();
 
   if(landBody!=nullptr)
     world->addCollisionObject(landBody.get());
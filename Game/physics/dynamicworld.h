@@ -28,6 +28,7 @@ class PhysicMeshShape;
 class PhysicVbo;
 class PackedMesh;
 class World;
+class WorldCache;
 class Bullet;
 class Npc;
 
@@ -206,6 +207,8 @@ class DynamicWorld final {
     BBoxBody*   bboxObj(BBoxCallback* cb, const ZMath::float3* bbox);
 
     void        tick(uint64_t dt);
+    // ray queries are safe to run concurrently, once bounding boxes are up to date
+    void        updateAabbs() const;
 
     void        deleteObj(BulletBody* obj);
     void        deleteObj(BBoxBody*   obj);
@@ -228,12 +231,13 @@ class DynamicWorld final {
     std::unique_ptr<btRigidBody> waterObj();
 
     void       updateSingleAabb(btCollisionObject* obj);
-    void       updateAabbs() const;
 
     std::unique_ptr<btCollisionConfiguration>   conf;
     std::unique_ptr<btDispatcher>               dispatcher;
     std::unique_ptr<btBroadphaseInterface>      broadphase;
     std::unique_ptr<btCollisionWorld>           world;
+    // owns memory of cached bvh - must outlive collision shapes
+    std::unique_ptr<WorldCache>                 bake;
 
     std::vector<std::string>                    sectors;
 
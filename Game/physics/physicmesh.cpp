@@ -8,6 +8,7 @@
 #include "graphics/attachbinder.h"
 #include "graphics/skeleton.h"
 #include "graphics/pose.h"
+#include "resources.h"
 
 PhysicMesh::PhysicMesh(const ProtoMesh& proto, DynamicWorld& owner)
   :ani(&proto) {
@@ -18,6 +19,23 @@ PhysicMesh::PhysicMesh(const ProtoMesh& proto, DynamicWorld& owner)
     auto physic = owner.staticObj(i.shape.get(),pos);
     sub.emplace_back(std::move(physic));
     }
+  Resources::retain(ani);
+  }
+
+PhysicMesh::PhysicMesh(PhysicMesh&& other) {
+  *this = std::move(other);
+  }
+
+PhysicMesh::~PhysicMesh() {
+  Resources::release(ani);
+  }
+
+PhysicMesh& PhysicMesh::operator = (PhysicMesh&& other) {
+  std::swap(sub,      other.sub);
+  std::swap(ani,      other.ani);
+  std::swap(skeleton, other.skeleton);
+  std::swap(binder,   other.binder);
+  return *this;
   }
 
 void PhysicMesh::setObjMatrix(const Tempest::Matrix4x4& mt) {
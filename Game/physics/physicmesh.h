@@ -8,6 +8,9 @@ class PhysicMesh final {
   public:
     PhysicMesh()=default;
     PhysicMesh(const ProtoMesh& proto, DynamicWorld& owner);
+    PhysicMesh(PhysicMesh&& other);
+    ~PhysicMesh();
+    PhysicMesh& operator = (PhysicMesh&& other);
 
     void   setObjMatrix  (const Tempest::Matrix4x4& m);
     void   setSkeleton   (const Skeleton* sk);
@@ -18,6 +18,7 @@
 #include <zenload/ztex2dds.h>
 
 #include <fstream>
+#include <limits>
 
 #include "graphics/submesh/staticmesh.h"
 #include "graphics/submesh/animmesh.h"
@@ -38,6 +39,8 @@
 using namespace Tempest;
 
 Resources* Resources::inst=nullptr;
+// resources are decoded concurrently - scratch memory is per thread
+static thread_local std::vector<uint8_t> fBuff, ddsBuf;
 
 static void emplaceTag(char* buf, char tag){
   for(size_t i=1;buf[i];++i){
@@ -72,9 +75,6 @@ Resources::Resources(Gothic &gothic, Tempest::Device &device)
   dxMusic->addPath(gothic.nestedPath({u"_work",u"Data",u"Music",u"menu_men"}, Dir::FT_Dir));
   dxMusic->addPath(gothic.nestedPath({u"_work",u"Data",u"Music",u"orchestra"},Dir::FT_Dir));
 
-  fBuff .reserve(8*1024*1024);
-  ddsBuf.reserve(8*1024*1024);
-
   {
   Pixmap pm(1,1,Pixmap::Format::RGBA);
   uint8_t* pix = reinterpret_cast<uint8_t*>(pm.data());
@@ -99,8 +99,18 @@ Resources::Resources(Gothic &gothic, Tempest::Device &device)
            std::make_tuple(bIsMod,b.time,int(b.ord));
     });
 
-  for(auto& i:archives)
+  // FNV-1a
+  gothicAssetsKey = 14695981039346656037ull;
+  auto hash = [this](const void* data, size_t sz) {
+    auto d = reinterpret_cast<const uint8_t*>(data);
+    for(size_t i=0; i<sz; ++i)
+      gothicAssetsKey = (gothicAssetsKey^d[i])*1099511628211ull;
+    };
+  for(auto& i:archives) {
     gothicAssets.loadVDF(i.name);
+    hash(i.name.data(),i.name.size()*sizeof(char16_t));
+    hash(&i.time,sizeof(i.time));
+    }
   gothicAssets.finalizeLoad();
 
   //for(auto& i:gothicAssets.getKnownFiles())
@@ -112,6 +122,7 @@ Resources::Resources(Gothic &gothic, Tempest::Device &device)
   }
 
 Resources::~Resources() {
+  Workers::wait([this](){ return asyncPending.load()==0; });
   inst=nullptr;
   }
 
@@ -192,6 +203,10 @@ VDFS::FileIndex& Resources::vdfsIndex() {
   return inst->gothicAssets;
   }
 
+uint64_t Resources::vdfsKey() {
+  return inst->gothicAssetsKey;
+  }
+
 const Tempest::VertexBuffer<Resources::VertexFsq> &Resources::fsqVbo() {
   return inst->fsq;
   }
@@ -219,16 +234,9 @@ int64_t Resources::vdfTimestamp(const std::u16string& name) {
     }
   }
 
-Tempest::Texture2d* Resources::implLoadTexture(TextureCache& cache,const char* cname) {
-  std::string name = cname;
-  if(name.size()==0)
-    return nullptr;
-
-  auto it=cache.find(name);
-  if(it!=cache.end())
-    return it->second.get();
-
-  if(FileExt::hasExt(name,"TGA")){
+auto Resources::implLoadTexture(const std::string& cname) -> std::unique_ptr<const Texture2d> {
+  if(FileExt::hasExt(cname,"TGA")){
+    std::string name = cname;
     name.resize(name.size()+2);
     std::memcpy(&name[0]+name.size()-6,"-C.TEX",6);
     if(hasFile(name)) {
@@ -238,61 +246,51 @@ Tempest::Texture2d* Resources::implLoadTexture(TextureCache& cache,const char* c
         }
       ddsBuf.clear();
       ZenLoad::convertZTEX2DDS(fBuff,ddsBuf);
-      auto t = implLoadTexture(cache,cname,ddsBuf);
+      auto t = implLoadTexture(ddsBuf);
       if(t!=nullptr) {
         return t;
         }
       }
     }
 
-  if(getFileData(cname,fBuff))
-    return implLoadTexture(cache,cname,fBuff);
-
-  cache[name]=nullptr;
+  if(getFileData(cname.c_str(),fBuff))
+    return implLoadTexture(fBuff);
   return nullptr;
   }
 
-Texture2d *Resources::implLoadTexture(TextureCache& cache,std::string&& name,const std::vector<uint8_t> &data) {
+auto Resources::implLoadTexture(const std::vector<uint8_t>& data) -> std::unique_ptr<const Texture2d> {
   try {
     Tempest::MemReader rd(data.data(),data.size());
     Tempest::Pixmap    pm(rd);
 
-    std::unique_ptr<Texture2d> t{new Texture2d(device.loadTexture(pm))};
-    Texture2d* ret=t.get();
-    cache[std::move(name)] = std::move(t);
-    return ret;
+    std::lock_guard<std::mutex> g(gpuSync);
+    return std::unique_ptr<const Texture2d>{new Texture2d(device.loadTexture(pm))};
     }
   catch(...){
     return nullptr;
     }
   }
 
-ProtoMesh* Resources::implLoadMesh(const std::string &name) {
-  if(name.size()==0)
-    return nullptr;
-
-  auto it=aniMeshCache.find(name);
-  if(it!=aniMeshCache.end())
-    return it->second.get();
-
+auto Resources::implLoadMesh(const std::string& name) -> std::unique_ptr<ProtoMesh> {
   if(FileExt::hasExt(name,"TGA")){
-    static std::unordered_set<std::string> dec;
-    if(dec.find(name)==dec.end()) {
-      Log::e("decals are not implemented yet \"",name,"\"");
-      dec.insert(name);
-      }
+    // failed load is cached - reported once per name
+    Log::e("decals are not implemented yet \"",name,"\"");
     return nullptr;
     }
 
   try {
     ZenLoad::PackedMesh        sPacked;
     ZenLoad::zCModelMeshLib    library;
-    auto                       code=loadMesh(sPacked,library,name);
-    std::unique_ptr<ProtoMesh> t{code==MeshLoadCode::Static ? new ProtoMesh(std::move(sPacked),name) : new ProtoMesh(library,name)};
-    ProtoMesh* ret=t.get();
-    aniMeshCache[name] = std::move(t);
+    MeshLoadCode               code=MeshLoadCode::Error;
+    {
+    std::lock_guard<std::recursive_mutex> g(vdfsSync);
+    code=loadMesh(sPacked,library,name);
+    }
     if(code==MeshLoadCode::Error)
       throw std::runtime_error("load failed");
+    // gpu upload and materials are outside of vdfs lock
+    std::unique_ptr<ProtoMesh> ret{code==MeshLoadCode::Static ? new ProtoMesh(std::move(sPacked),name) : new ProtoMesh(library,name)};
+    retainTextures(*ret,true);
     return ret;
     }
   catch(...){
@@ -344,25 +342,16 @@ ProtoMesh* Resources::implDecalMesh(const ZenLoad::zCVobData& vob) {
   return ret;
   }
 
-Skeleton* Resources::implLoadSkeleton(std::string name) {
-  if(name.size()==0)
-    return nullptr;
-
-  FileExt::exchangeExt(name,"MDS","MDH") ||
-  FileExt::exchangeExt(name,"ASC","MDL");
-
-  auto it=skeletonCache.find(name);
-  if(it!=skeletonCache.end())
-    return it->second.get();
-
+auto Resources::implLoadSkeleton(const std::string& name) -> std::unique_ptr<Skeleton> {
   try {
-    ZenLoad::zCModelMeshLib library(name,gothicAssets,1.f);
-    std::unique_ptr<Skeleton> t{new Skeleton(library,name)};
-    Skeleton* ret=t.get();
-    skeletonCache[name] = std::move(t);
+    std::unique_ptr<ZenLoad::zCModelMeshLib> library;
+    {
+    std::lock_guard<std::recursive_mutex> g(vdfsSync);
     if(!hasFile(name))
       throw std::runtime_error("load failed");
-    return ret;
+    library.reset(new ZenLoad::zCModelMeshLib(name,gothicAssets,1.f));
+    }
+    return std::unique_ptr<Skeleton>{new Skeleton(*library,name)};
     }
   catch(...){
     Log::e("unable to load skeleton \"",name,"\"");
@@ -370,38 +359,28 @@ Skeleton* Resources::implLoadSkeleton(std::string name) {
     }
   }
 
-Animation* Resources::implLoadAnimation(std::string name) {
-  if(name.size()<4)
-    return nullptr;
-
-  auto it=animCache.find(name);
-  if(it!=animCache.end())
-    return it->second.get();
-
+auto Resources::implLoadAnimation(std::string name) -> std::unique_ptr<Animation> {
   try {
-    Animation* ret=nullptr;
+    // animation sequences are parsed from archive as well
+    std::lock_guard<std::recursive_mutex> g(vdfsSync);
     if(gothic.version().game==2){
       FileExt::exchangeExt(name,"MDS","MSB") ||
       FileExt::exchangeExt(name,"MDH","MSB");
+      } else {
+      FileExt::exchangeExt(name,"MDH","MDS");
+      }
+    if(!hasFile(name))
+      throw std::runtime_error("load failed");
 
+    if(gothic.version().game==2){
       ZenLoad::ZenParser            zen(name,gothicAssets);
       ZenLoad::MdsParserBin         p(zen);
-
-      std::unique_ptr<Animation> t{new Animation(p,name.substr(0,name.size()-4),false)};
-      ret=t.get();
-      animCache[name] = std::move(t);
+      return std::unique_ptr<Animation>{new Animation(p,name.substr(0,name.size()-4),false)};
       } else {
-      FileExt::exchangeExt(name,"MDH","MDS");
       ZenLoad::ZenParser zen(name,gothicAssets);
       ZenLoad::MdsParserTxt p(zen);
-
-      std::unique_ptr<Animation> t{new Animation(p,name.substr(0,name.size()-4),true)};
-      ret=t.get();
-      animCache[name] = std::move(t);
+      return std::unique_ptr<Animation>{new Animation(p,name.substr(0,name.size()-4),true)};
       }
-    if(!hasFile(name))
-      throw std::runtime_error("load failed");
-    return ret;
     }
   catch(...){
     Log::e("unable to load animation \"",name,"\"");
@@ -502,47 +481,57 @@ GthFont &Resources::implLoadFont(const char* fname, FontType type) {
       break;
     }
 
+  // texture first: font parser holds archive lock, and must not wait for other loads
+  loadTexture(tex);
+  std::lock_guard<std::recursive_mutex> g(vdfsSync);
   auto ptr   = std::make_unique<GthFont>(fnt,tex,color,gothicAssets);
   GthFont* f = ptr.get();
   gothicFnt[std::make_pair(fname,type)] = std::move(ptr);
   return *f;
   }
 
-PfxEmitterMesh* Resources::implLoadEmiterMesh(const char* name) {
-  auto it = emiMeshCache.find(name);
-  if(it!=emiMeshCache.end())
-    return it->second.get();
-
+auto Resources::implLoadEmiterMesh(const std::string& name) -> std::unique_ptr<PfxEmitterMesh> {
   ZenLoad::PackedMesh        packed;
   ZenLoad::zCModelMeshLib    library;
+  {
+  std::lock_guard<std::recursive_mutex> g(vdfsSync);
   auto                       code=loadMesh(packed,library,name);
   (void)code;
-  std::unique_ptr<PfxEmitterMesh> ptr{new PfxEmitterMesh(packed)};
+  }
+  return std::unique_ptr<PfxEmitterMesh>{new PfxEmitterMesh(packed)};
   // std::unique_ptr<PfxEmitterMesh> ptr{code==MeshLoadCode::Static ? new PfxEmitterMesh(std::move(sPacked)) :
   //                                                                  new PfxEmitterMesh(library)};
-  auto ret = ptr.get();
-  emiMeshCache[name] = std::move(ptr);
-  return ret;
   }
 
 bool Resources::hasFile(const std::string &fname) {
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
+  std::lock_guard<std::recursive_mutex> g(inst->vdfsSync);
   return inst->gothicAssets.hasFile(fname);
   }
 
 const Texture2d *Resources::loadTexture(const char *name) {
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
-  return inst->implLoadTexture(inst->texCache,name);
+  if(name==nullptr || name[0]=='\0')
+    return nullptr;
+  return loadTexture(std::string(name));
   }
 
 const Tempest::Texture2d* Resources::loadTexture(const std::string &name) {
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
-  return inst->implLoadTexture(inst->texCache,name.c_str());
+  // pointer escapes residency tracking - texture is never evicted
+  return inst->getTexture(name,true);
   }
 
-const Texture2d *Resources::loadTexture(const std::string &name, int32_t iv, int32_t ic) {
+const Texture2d* Resources::loadMeshTexture(const std::string& name) {
+  return inst->getTexture(name,false);
+  }
+
+auto Resources::getTexture(const std::string& name, bool pin) -> const Texture2d* {
+  if(name.size()==0)
+    return nullptr;
+  return texCache.get(name,[&name](){ return inst->implLoadTexture(name); },pin);
+  }
+
+static std::string textureVariant(const std::string &name, int32_t iv, int32_t ic) {
   if(name.size()>=128)
-    return loadTexture(name);
+    return name;
 
   char v[16]={};
   char c[16]={};
@@ -559,7 +548,15 @@ const Texture2d *Resources::loadTexture(const std::string &name, int32_t iv, int
   emplaceTag(buf2,'C');
   std::snprintf(buf1,sizeof(buf1),buf2,c);
 
-  return loadTexture(buf1);
+  return buf1;
+  }
+
+const Texture2d *Resources::loadTexture(const std::string &name, int32_t iv, int32_t ic) {
+  return loadTexture(textureVariant(name,iv,ic));
+  }
+
+const Texture2d* Resources::loadMeshTexture(const std::string& name, int32_t iv, int32_t ic) {
+  return loadMeshTexture(textureVariant(name,iv,ic));
   }
 
 std::vector<const Texture2d*> Resources::loadTextureAnim(const std::string& name) {
@@ -589,7 +586,7 @@ std::vector<const Texture2d*> Resources::loadTextureAnim(const std::string& name
   }
 
 Texture2d Resources::loadTexture(const Pixmap &pm) {
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
+  std::lock_guard<std::mutex> g(inst->gpuSync);
   return inst->device.loadTexture(pm);
   }
 
@@ -598,27 +595,143 @@ Material Resources::loadMaterial(const ZenLoad::zCMaterialData& src, bool enable
   }
 
 const ProtoMesh *Resources::loadMesh(const std::string &name) {
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
-  return inst->implLoadMesh(name);
+  if(name.size()==0)
+    return nullptr;
+  return inst->aniMeshCache.get(name,[&name](){ return inst->implLoadMesh(name); },false);
+  }
+
+std::shared_future<const ProtoMesh*> Resources::loadMeshAsync(const std::string& name) {
+  return inst->aniMeshCache.getAsync(name,[name](){ return inst->implLoadMesh(name); },inst->asyncPending,false);
+  }
+
+void Resources::retain(const Material& mat) {
+  if(mat.tex!=nullptr)
+    inst->texCache.retain(mat.tex);
+  for(auto i:mat.frames)
+    inst->texCache.retain(i);
+  }
+
+void Resources::release(const Material& mat) {
+  if(inst==nullptr)
+    return;
+  if(mat.tex!=nullptr)
+    inst->texCache.release(mat.tex);
+  for(auto i:mat.frames)
+    inst->texCache.release(i);
+  }
+
+void Resources::retain(const ProtoMesh* mesh) {
+  if(mesh!=nullptr)
+    inst->aniMeshCache.retain(mesh);
+  }
+
+void Resources::release(const ProtoMesh* mesh) {
+  if(mesh!=nullptr && inst!=nullptr)
+    inst->aniMeshCache.release(mesh);
+  }
+
+void Resources::trim() {
+  auto&     r        = *inst;
+  // not a vanilla key: eviction is off, unless enabled explicitly
+  const int budgetMb = r.gothic.settingsGetI("OPENGOTHIC","resourceBudgetMb");
+  if(budgetMb<=0)
+    return;
+
+  const size_t limit = size_t(std::min<uint64_t>(uint64_t(budgetMb)*1024*1024,std::numeric_limits<size_t>::max()));
+  size_t       total = r.texCache.stats().bytes + r.aniMeshCache.stats().bytes;
+  if(total>limit) {
+    // meshes first: evicted mesh releases it's textures
+    total -= r.aniMeshCache.evict(total-limit,[](const ProtoMesh& m){ inst->onEvict(m); });
+    }
+  if(total>limit)
+    total -= r.texCache.evict(total-limit,[](const Texture2d&){});
+
+  auto tex  = r.texCache.stats();
+  auto mesh = r.aniMeshCache.stats();
+  Log::i("resources: textures ",tex.count," (",tex.bytes/1024/1024,"Mb, ",tex.evictions," evicted), ",
+         "meshes ",mesh.count," (",mesh.bytes/1024/1024,"Mb, ",mesh.evictions," evicted), budget ",limit/1024/1024,"Mb");
+  }
+
+Resources::Stats Resources::textureStats() {
+  return inst->texCache.stats();
+  }
+
+Resources::Stats Resources::meshStats() {
+  return inst->aniMeshCache.stats();
+  }
+
+size_t Resources::residentSize(const Texture2d& t) {
+  size_t px = size_t(t.w())*size_t(t.h());
+  switch(t.format()) {
+    case TextureFormat::DXT1:
+      px = px/2;
+      break;
+    case TextureFormat::DXT3:
+    case TextureFormat::DXT5:
+      break;
+    default:
+      px = px*4;
+      break;
+    }
+  // mip chain
+  return px+px/3;
+  }
+
+size_t Resources::residentSize(const ProtoMesh& m) {
+  size_t ret = 0;
+  for(auto& i:m.attach) {
+    ret += i.vbo.size()*sizeof(Vertex);
+    for(auto& s:i.sub)
+      ret += s.ibo.size()*sizeof(uint32_t);
+    }
+  for(auto& i:m.skined) {
+    ret += i.vbo.size()*sizeof(VertexA);
+    for(auto& s:i.sub)
+      ret += s.ibo.size()*sizeof(uint32_t);
+    }
+  return ret;
+  }
+
+void Resources::retainTextures(const ProtoMesh& m, bool retain) {
+  // resident mesh holds materials - it's textures must stay alive
+  for(auto& i:m.attach)
+    for(auto& s:i.sub)
+      retain ? Resources::retain(s.material) : Resources::release(s.material);
+  for(auto& i:m.skined)
+    for(auto& s:i.sub)
+      retain ? Resources::retain(s.material) : Resources::release(s.material);
+  }
+
+void Resources::onEvict(const ProtoMesh& m) {
+  retainTextures(m,false);
+  std::lock_guard<std::recursive_mutex> g(sync);
+  for(auto it=bindCache.begin(); it!=bindCache.end();) {
+    if(std::get<1>(it->first)==&m)
+      it = bindCache.erase(it); else
+      ++it;
+    }
   }
 
 const PfxEmitterMesh* Resources::loadEmiterMesh(const char* name) {
   if(name==nullptr || name[0]=='\0')
     return nullptr;
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
-  return inst->implLoadEmiterMesh(name);
+  std::string key = name;
+  return inst->emiMeshCache.get(key,[&key](){ return inst->implLoadEmiterMesh(key); });
   }
 
 const Skeleton *Resources::loadSkeleton(const char* name) {
-  if(FileExt::hasExt(name,"3ds"))
+  if(name==nullptr || name[0]=='\0' || FileExt::hasExt(name,"3ds"))
     return nullptr;
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
-  return inst->implLoadSkeleton(name);
+  std::string key = name;
+  FileExt::exchangeExt(key,"MDS","MDH") ||
+  FileExt::exchangeExt(key,"ASC","MDL");
+  return inst->skeletonCache.get(key,[&key](){ return inst->implLoadSkeleton(key); });
   }
 
 const Animation *Resources::loadAnimation(const std::string &name) {
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
-  return inst->implLoadAnimation(name);
+  if(name.size()<4)
+    return nullptr;
+  return inst->animCache.get(name,[&name](){ return inst->implLoadAnimation(name); });
   }
 
 SoundEffect *Resources::loadSound(const char *name) {
@@ -653,17 +766,20 @@ const ProtoMesh* Resources::decalMesh(const ZenLoad::zCVobData& vob) {
 
 bool Resources::getFileData(const char *name, std::vector<uint8_t> &dat) {
   dat.clear();
+  std::lock_guard<std::recursive_mutex> g(inst->vdfsSync);
   return inst->gothicAssets.getFileData(name,dat);
   }
 
 std::vector<uint8_t> Resources::getFileData(const char *name) {
   std::vector<uint8_t> data;
+  std::lock_guard<std::recursive_mutex> g(inst->vdfsSync);
   inst->gothicAssets.getFileData(name,data);
   return data;
   }
 
 std::vector<uint8_t> Resources::getFileData(const std::string &name) {
   std::vector<uint8_t> data;
+  std::lock_guard<std::recursive_mutex> g(inst->vdfsSync);
   inst->gothicAssets.getFileData(name,data);
   return data;
   }
@@ -11,10 +11,16 @@
 #include <zenload/zCModelMeshLib.h>
 #include <zenload/zTypes.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
 #include <tuple>
 
 #include "graphics/material.h"
 #include "world/soundfx.h"
+#include "utils/workers.h"
 
 class Gothic;
 class StaticMesh;
@@ -78,6 +84,14 @@ class Resources final {
       Tempest::Vec3 color;
       };
 
+    struct Stats {
+      size_t count     = 0;
+      size_t bytes     = 0;
+      size_t hits      = 0;
+      size_t misses    = 0;
+      size_t evictions = 0;
+      };
+
     static const char* renderer();
     static void        waitDeviceIdle();
 
@@ -91,10 +105,14 @@ class Resources final {
 
     static const Tempest::Texture2d& fallbackTexture();
     static const Tempest::Texture2d& fallbackBlack();
+    // load* calls are blocking: on cache miss, asset is decoded on calling thread
     static const Tempest::Texture2d* loadTexture(const char* name);
     static const Tempest::Texture2d* loadTexture(const std::string& name);
     static const Tempest::Texture2d* loadTexture(const std::string& name,int32_t v,int32_t c);
     static auto                      loadTextureAnim(const std::string& name) -> std::vector<const Tempest::Texture2d*>;
+    // texture of mesh material: kept resident, while retained by mesh or draw-bucket
+    static const Tempest::Texture2d* loadMeshTexture(const std::string& name);
+    static const Tempest::Texture2d* loadMeshTexture(const std::string& name,int32_t v,int32_t c);
     static       Tempest::Texture2d  loadTexture(const Tempest::Pixmap& pm);
     static       Material            loadMaterial(const ZenLoad::zCMaterialData& src, bool enableAlphaTest);
 
@@ -113,18 +131,41 @@ class Resources final {
     static Dx8::PatternList          loadDxMusic(const char *name);
     static const ProtoMesh*          decalMesh(const ZenLoad::zCVobData& vob);
 
+    // residency: textures and meshes are evictable, when not retained and over budget
+    static void                      retain (const Material&  mat);
+    static void                      release(const Material&  mat);
+    static void                      retain (const ProtoMesh* mesh);
+    static void                      release(const ProtoMesh* mesh);
+    // evict least-recently-used assets over [OPENGOTHIC] resourceBudgetMb; device must be idle
+    static void                      trim();
+    static Stats                     textureStats();
+    static Stats                     meshStats();
+
+    // non-blocking request: mesh is loaded on worker pool, future is shared with blocking calls
+    // only used to warm up cache on world load; views still can't be created from pending mesh
+    static std::shared_future<const ProtoMesh*>          loadMeshAsync   (const std::string& name);
+
     template<class V>
-    static Tempest::VertexBuffer<V>  vbo(const V* data,size_t sz){ return inst->device.vbo(data,sz); }
+    static Tempest::VertexBuffer<V>  vbo(const V* data,size_t sz){
+      std::lock_guard<std::mutex> g(inst->gpuSync);
+      return inst->device.vbo(data,sz);
+      }
 
     template<class V>
-    static Tempest::IndexBuffer<V>   ibo(const V* data,size_t sz){ return inst->device.ibo(data,sz); }
+    static Tempest::IndexBuffer<V>   ibo(const V* data,size_t sz){
+      std::lock_guard<std::mutex> g(inst->gpuSync);
+      return inst->device.ibo(data,sz);
+      }
 
     static std::vector<uint8_t>      getFileData(const char*        name);
     static bool                      getFileData(const char*        name,std::vector<uint8_t>& dat);
     static std::vector<uint8_t>      getFileData(const std::string& name);
 
     static bool                      hasFile(const std::string& fname);
+    // not thread-safe: prefer getFileData/hasFile, that are synchronized
     static VDFS::FileIndex&          vdfsIndex();
+    // hash of loaded archive names and timestamps; changes, when game data is updated
+    static uint64_t                  vdfsKey();
 
     static const Tempest::VertexBuffer<VertexFsq>& fsqVbo();
 
@@ -157,22 +198,173 @@ class Resources final {
         }
       };
 
-    using TextureCache = std::unordered_map<std::string,std::unique_ptr<Tempest::Texture2d>>;
+    // Thread-safe cache: value is loaded once, by first requester; others are waiting for it.
+    // No lock is held while loading, so loaders are free to request other resources.
+    // Entries, that are not pinned and not retained, can be evicted in least-recently-used order.
+    template<class T,class K=std::string>
+    class Cache final {
+      public:
+        using Future = std::shared_future<T*>;
+
+        template<class F>
+        T*     get(const K& key, F load, bool pin=true) {
+          Entry* e = nullptr;
+          Future f = acquire(key,pin,e);
+          if(e!=nullptr)
+            publish(*e,load);
+          // value might be still queued by async request - help with pending work, instead of blocking
+          Workers::wait([&f](){ return f.wait_for(std::chrono::seconds(0))==std::future_status::ready; });
+          return f.get();
+          }
+
+        template<class F>
+        Future getAsync(const K& key, F load, std::atomic<size_t>& pending, bool pin=true) {
+          Entry* e = nullptr;
+          Future f = acquire(key,pin,e);
+          if(e!=nullptr) {
+            pending.fetch_add(1);
+            Workers::async([this,e,load,&pending]() mutable {
+              publish(*e,load);
+              pending.fetch_sub(1);
+              });
+            }
+          return f;
+          }
+
+        void   retain(T* v) {
+          std::lock_guard<std::mutex> guard(sync);
+          auto it = byValue.find(v);
+          if(it!=byValue.end())
+            it->second->refs++;
+          }
+
+        void   release(T* v) {
+          std::lock_guard<std::mutex> guard(sync);
+          auto it = byValue.find(v);
+          if(it!=byValue.end())
+            it->second->refs--;
+          }
+
+        // drop unused entries, until at least 'need' bytes are freed; must not run concurrently with loads
+        template<class F>
+        size_t evict(size_t need, F onEvict) {
+          std::vector<std::unique_ptr<T>> drop;
+          size_t freed = 0;
+          {
+          std::lock_guard<std::mutex> guard(sync);
+          std::vector<typename Map::iterator> lru;
+          for(auto it=data.begin(); it!=data.end(); ++it) {
+            auto& e = it->second;
+            if(e.done && e.value!=nullptr && !e.pinned && e.refs==0)
+              lru.push_back(it);
+            }
+          std::sort(lru.begin(),lru.end(),[](typename Map::iterator a, typename Map::iterator b){
+            return a->second.tick<b->second.tick;
+            });
+          for(auto it:lru) {
+            if(freed>=need)
+              break;
+            auto& e = it->second;
+            freed += e.bytes;
+            stat.bytes -= e.bytes;
+            stat.count--;
+            stat.evictions++;
+            byValue.erase(e.value.get());
+            drop.emplace_back(std::move(e.value));
+            data.erase(it);
+            }
+          }
+          for(auto& i:drop)
+            onEvict(*i);
+          return freed;
+          }
+
+        Stats  stats() {
+          std::lock_guard<std::mutex> guard(sync);
+          return stat;
+          }
+
+      private:
+        struct Entry {
+          std::unique_ptr<T> value;
+          std::promise<T*>   promise;
+          Future             ready;
+          size_t             bytes  = 0;
+          uint64_t           tick   = 0;
+          int32_t            refs   = 0;
+          bool               pinned = false;
+          bool               done   = false;
+          };
+        using Map = std::unordered_map<K,Entry>;
+
+        Future acquire(const K& key, bool pin, Entry*& e) {
+          std::lock_guard<std::mutex> guard(sync);
+          auto it = data.find(key);
+          if(it!=data.end()) {
+            stat.hits++;
+            it->second.tick    = ++tick;
+            it->second.pinned |= pin;
+            return it->second.ready;
+            }
+          stat.misses++;
+          e = &data[key];
+          e->tick   = ++tick;
+          e->pinned = pin;
+          e->ready  = e->promise.get_future().share();
+          return e->ready;
+          }
+
+        template<class F>
+        void publish(Entry& e, F& load) {
+          // entry is exclusively owned by loader thread, until promise is fulfilled
+          try {
+            e.value = load();
+            }
+          catch(...) {
+            e.value = nullptr;
+            }
+          {
+          std::lock_guard<std::mutex> guard(sync);
+          if(e.value!=nullptr) {
+            e.bytes = residentSize(*e.value);
+            byValue[e.value.get()] = &e;
+            stat.bytes += e.bytes;
+            stat.count++;
+            }
+          e.done = true;
+          }
+          e.promise.set_value(e.value.get());
+          }
+
+        std::mutex                    sync;
+        Map                           data;
+        std::unordered_map<T*,Entry*> byValue;
+        uint64_t                      tick = 0;
+        Stats                         stat;
+      };
+
+    template<class T>
+    static size_t         residentSize(const T&) { return 0; }
+    static size_t         residentSize(const Tempest::Texture2d& t);
+    static size_t         residentSize(const ProtoMesh& m);
 
     int64_t               vdfTimestamp(const std::u16string& name);
     void                  detectVdf(std::vector<Archive>& ret, const std::u16string& root);
 
-    Tempest::Texture2d*   implLoadTexture(TextureCache& cache, const char* cname);
-    Tempest::Texture2d*   implLoadTexture(TextureCache& cache, std::string &&name, const std::vector<uint8_t> &data);
-    ProtoMesh*            implLoadMesh(const std::string &name);
+    auto                  implLoadTexture(const std::string& name) -> std::unique_ptr<const Tempest::Texture2d>;
+    auto                  implLoadTexture(const std::vector<uint8_t>& data) -> std::unique_ptr<const Tempest::Texture2d>;
+    auto                  implLoadMesh(const std::string& name) -> std::unique_ptr<ProtoMesh>;
+    void                  retainTextures(const ProtoMesh& m, bool retain);
+    void                  onEvict(const ProtoMesh& m);
+    auto                  getTexture(const std::string& name, bool pin) -> const Tempest::Texture2d*;
     ProtoMesh*            implDecalMesh(const ZenLoad::zCVobData& vob);
-    Skeleton*             implLoadSkeleton(std::string name);
-    Animation*            implLoadAnimation(std::string name);
+    auto                  implLoadSkeleton(const std::string& name) -> std::unique_ptr<Skeleton>;
+    auto                  implLoadAnimation(std::string name) -> std::unique_ptr<Animation>;
     Tempest::Sound        implLoadSoundBuffer(const char* name);
     Tempest::SoundEffect* implLoadSound(const char *name);
     Dx8::PatternList      implLoadDxMusic(const char *name);
     GthFont&              implLoadFont(const char* fname, FontType type);
-    PfxEmitterMesh*       implLoadEmiterMesh(const char* name);
+    auto                  implLoadEmiterMesh(const std::string& name) -> std::unique_ptr<PfxEmitterMesh>;
 
     MeshLoadCode          loadMesh(ZenLoad::PackedMesh &sPacked, ZenLoad::zCModelMeshLib &lib, std::string  name);
     ZenLoad::zCModelMeshLib loadMDS (std::string& name);
@@ -199,21 +391,25 @@ class Resources final {
     Tempest::Device&      device;
     Tempest::SoundDevice  sound;
     std::recursive_mutex  sync;
+    // archive index and parsers are not thread-safe
+    std::recursive_mutex  vdfsSync;
+    std::mutex            gpuSync;
+    std::atomic<size_t>   asyncPending{0};
     std::unique_ptr<Dx8::DirectMusic> dxMusic;
     Gothic&               gothic;
     VDFS::FileIndex       gothicAssets;
+    uint64_t              gothicAssetsKey=0;
 
-    std::vector<uint8_t>  fBuff, ddsBuf;
     Tempest::VertexBuffer<VertexFsq>         fsq;
 
-    TextureCache                                                          texCache;
+    Cache<const Tempest::Texture2d>                                       texCache;
+    Cache<const ProtoMesh>                                                aniMeshCache;
+    Cache<const Skeleton>                                                 skeletonCache;
+    Cache<const Animation>                                                animCache;
+    Cache<const PfxEmitterMesh>                                           emiMeshCache;
 
-    std::unordered_map<std::string,std::unique_ptr<ProtoMesh>>            aniMeshCache;
     std::unordered_map<DecalK,std::unique_ptr<ProtoMesh>,Hash>            decalMeshCache;
-    std::unordered_map<std::string,std::unique_ptr<Skeleton>>             skeletonCache;
-    std::unordered_map<std::string,std::unique_ptr<Animation>>            animCache;
     std::unordered_map<BindK,std::unique_ptr<AttachBinder>,Hash>          bindCache;
-    std::unordered_map<std::string,std::unique_ptr<PfxEmitterMesh>>       emiMeshCache;
 
     std::unordered_map<std::string,std::unique_ptr<Tempest::SoundEffect>> sndCache;
     std::unordered_map<FontK,std::unique_ptr<GthFont>,Hash>               gothicFnt;
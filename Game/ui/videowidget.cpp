@@ -5,7 +5,14 @@
 #include <Tempest/Log>
 #include <Tempest/Application>
 
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
 #include "bink/video.h"
+#include "bink/yuv.h"
+#include "utils/workers.h"
+#include "utils/samplering.h"
 #include "utils/fileutil.h"
 #include "gamemusic.h"
 #include "gothic.h"
@@ -46,7 +53,8 @@ struct VideoWidget::Sound : Tempest::SoundProducer {
   };
 
 struct VideoWidget::SoundContext {
-  SoundContext(Context& ctx, SoundDevice& dev, uint16_t sampleRate, bool isMono):  ctx(ctx) {
+  SoundContext(Context& ctx, SoundDevice& dev, uint16_t sampleRate, bool isMono)
+    :ctx(ctx), samples(size_t(sampleRate)*(isMono ? 1 : 2)*2) {
     snd = dev.load(std::unique_ptr<VideoWidget::Sound>(new VideoWidget::Sound(*this,sampleRate,isMono)));
     }
 
@@ -55,33 +63,46 @@ struct VideoWidget::SoundContext {
     }
 
   void pushSamples(const std::vector<float>& s) {
-    std::lock_guard<std::mutex> guard(syncSamples);
-    size_t sz = samples.size();
-    samples.resize(sz+s.size());
-    std::memcpy(samples.data()+sz, s.data(), s.size()*sizeof(s[0]));
+    samples.push(s.data(),s.size());
     }
 
   Context&             ctx;
+  SampleRing           samples; // 2 seconds: decoder runs ahead of playback by a few frames only
   Tempest::SoundEffect snd;
-  std::mutex           syncSamples;
-  std::vector<float>   samples;
   };
 
 void VideoWidget::Sound::renderSound(int16_t *out, size_t n) {
   n = n*channels; // stereo
 
-  std::lock_guard<std::mutex> guard(ctx.syncSamples);
   auto& s = ctx.samples;
-  if(s.size()<n)
+  if(s.size()<n) {
+    // keep stream aligned: play silence, until whole chunk is available
+    s.skip(n);
     return;
-  for(size_t i=0; i<n; ++i) {
-    float v = s[i];
-    out[i] = (v < -1.00004566f ? int16_t(-32768) : (v > 1.00001514f ? int16_t(32767) : int16_t(v * 32767.5f)));
     }
-  ctx.samples.erase(ctx.samples.begin(),ctx.samples.begin()+n);
+
+  float buf[512];
+  while(n>0) {
+    const size_t cnt = s.pop(buf,std::min(n,sizeof(buf)/sizeof(buf[0])));
+    for(size_t i=0; i<cnt; ++i) {
+      float v = buf[i];
+      out[i] = (v < -1.00004566f ? int16_t(-32768) : (v > 1.00001514f ? int16_t(32767) : int16_t(v * 32767.5f)));
+      }
+    out += cnt;
+    n   -= cnt;
+    }
   }
 
 struct VideoWidget::Context {
+  enum {
+    MaxQueue = 4
+    };
+
+  struct Frame {
+    Pixmap   pm;
+    uint64_t pts = 0; // presentation time in ms, relative to playback start
+    };
+
   Context(Gothic& gothic, const std::u16string& path) : fin(path), input(fin), vid(&input) {
     sndCtx.resize(vid.audioCount());
     for(size_t i=0; i<sndCtx.size(); ++i) {
@@ -92,58 +113,118 @@ struct VideoWidget::Context {
     const float volume = gothic.settingsGetF("SOUND","soundVolume");
     sndDev.setGlobalVolume(volume);
     frameTime = Application::tickCount();
+    decoder   = std::thread([this]() noexcept { decodeLoop(); });
     }
 
   ~Context() {
+    {
+    std::lock_guard<std::mutex> guard(sync);
+    stop = true;
+    }
+    cv.notify_all();
+    decoder.join();
+    Log::i("video: ",presented," frames presented, ",dropped.load()," dropped, ",
+           "decoded ahead avg ",presented>0 ? float(depthSum)/float(presented) : 0.f," max ",depthMax);
+    for(auto& s:sndCtx)
+      Log::i("video audio: ",size_t(s->samples.underruns())," samples underrun, ",size_t(s->samples.overruns())," overrun");
     }
 
-  void advance() {
-    auto& f = vid.nextFrame();
-    if(pm.w()!=f.width() || pm.h()!=f.height())
-      pm = Pixmap(f.width(),f.height(),Pixmap::Format::RGBA);
+  // picks latest due frame from decode queue; returns null, if no new frame is due yet
+  const Pixmap* advance() {
+    const uint64_t now = Application::tickCount()-frameTime;
+    std::lock_guard<std::mutex> guard(sync);
+    if(queue.empty() || queue.front().pts>now)
+      return nullptr;
+    // frames decoded ahead of presented one: zero means decoder barely keeps up
+    const size_t ahead = queue.size()-1;
+    depthSum += ahead;
+    depthMax  = std::max(depthMax,ahead);
+    // render is behind: skip frames, that already are out of date
+    while(queue.size()>1 && queue[1].pts<=now) {
+      recycle(std::move(queue.front().pm));
+      queue.pop_front();
+      dropped.fetch_add(1);
+      }
+    recycle(std::move(pm));
+    pm = std::move(queue.front().pm);
+    queue.pop_front();
+    presented++;
+    cv.notify_one();
+    return &pm;
+    }
 
-    yuvToRgba(f,pm);
-    for(size_t i=0; i<vid.audioCount(); ++i)
-      sndCtx[i]->pushSamples(f.audio(uint8_t(i)).samples);
+  bool isEof() {
+    std::lock_guard<std::mutex> guard(sync);
+    return eof && queue.empty();
+    }
 
-    uint64_t destTick = frameTime+(1000*vid.fps().den*vid.currentFrame())/vid.fps().num;
-    uint64_t tick     = Application::tickCount();
-    if(tick<destTick) {
-      Application::sleep(uint32_t(destTick-tick));
+  void decodeLoop() {
+    while(true) {
+      Frame fr;
+      {
+      std::unique_lock<std::mutex> guard(sync);
+      cv.wait(guard,[this](){ return stop || queue.size()<MaxQueue; });
+      if(stop)
+        return;
+      if(freePm.size()>0) {
+        fr.pm = std::move(freePm.back());
+        freePm.pop_back();
+        }
       }
-    }
 
-  void yuvToRgba(const Bink::Frame& f,Pixmap& pm) {
-    auto planeY = f.plane(0);
-    auto planeU = f.plane(1);
-    auto planeV = f.plane(2);
-    auto dst    = reinterpret_cast<uint8_t*>(pm.data());
-
-    const uint32_t w = pm.w();
-    for(uint32_t y=0; y<pm.h(); ++y)
-      for(uint32_t x=0; x<w; ++x) {
-        uint8_t* rgb = &dst[(x+y*w)*4];
-        float Y = planeY.at(x,  y  );
-        float U = planeU.at(x/2,y/2);
-        float V = planeV.at(x/2,y/2);
-
-        float r = 1.164f * (Y - 16.f) + 1.596f * (V - 128.f);
-        float g = 1.164f * (Y - 16.f) - 0.813f * (V - 128.f) - 0.391f * (U - 128.f);
-        float b = 1.164f * (Y - 16.f) + 2.018f * (U - 128.f);
-
-        r = std::max(0.f,std::min(r,255.f));
-        g = std::max(0.f,std::min(g,255.f));
-        b = std::max(0.f,std::min(b,255.f));
-
-        rgb[0] = uint8_t(r);
-        rgb[1] = uint8_t(g);
-        rgb[2] = uint8_t(b);
-        rgb[3] = 255;
+      if(vid.currentFrame()>=vid.frameCount()) {
+        finish();
+        return;
+        }
+
+      try {
+        auto& f = vid.nextFrame();
+        if(fr.pm.w()!=f.width() || fr.pm.h()!=f.height())
+          fr.pm = Pixmap(f.width(),f.height(),Pixmap::Format::RGBA);
+        yuvToRgba(f,fr.pm);
+        // audio is queued in sound-context, at decode time: playback is independent from render
+        for(size_t i=0; i<vid.audioCount(); ++i)
+          sndCtx[i]->pushSamples(f.audio(uint8_t(i)).samples);
+        fr.pts = (1000*vid.fps().den*(vid.currentFrame()-1))/vid.fps().num;
+        }
+      catch(const Bink::VideoDecodingException& e) { // video exception is recoverable
+        Log::e("video decoding error. frame: ",vid.currentFrame(),", what: \"", e.what(), "\"");
+        continue;
         }
+      catch(...) {
+        Log::e("video decoding error. frame: ",vid.currentFrame());
+        finish();
+        return;
+        }
+
+      std::lock_guard<std::mutex> guard(sync);
+      queue.emplace_back(std::move(fr));
+      }
+    }
+
+  void finish() {
+    std::lock_guard<std::mutex> guard(sync);
+    eof = true;
     }
 
-  bool isEof() const {
-    return vid.currentFrame()>=vid.frameCount();
+  void recycle(Pixmap&& p) {
+    if(p.w()>0)
+      freePm.emplace_back(std::move(p));
+    }
+
+  void yuvToRgba(const Bink::Frame& f,Pixmap& pm) {
+    enum { BandRows = 32 };
+    const uint32_t h      = pm.h();
+    const size_t   stride = size_t(pm.w())*4;
+    const bool     alpha  = vid.hasAlpha();
+    auto           dst    = reinterpret_cast<uint8_t*>(pm.data());
+
+    bands.resize((h+BandRows-1)/BandRows);
+    for(size_t i=0; i<bands.size(); ++i)
+      bands[i] = uint32_t(i*BandRows);
+    Workers::parallelFor(bands,1,[&](uint32_t row){
+      Bink::yuvToRgba(f,alpha,dst,stride,row,row+BandRows);
+      });
     }
 
   Tempest::RFile       fin;
@@ -151,6 +232,20 @@ struct VideoWidget::Context {
   Bink::Video          vid;
   Pixmap               pm;
   uint64_t             frameTime = 0;
+  size_t               presented = 0;
+  std::atomic<size_t>  dropped{0};
+  size_t               depthSum  = 0;
+  size_t               depthMax  = 0;
+
+  // decode-ahead: decoder thread owns 'vid', render thread only takes frames from queue
+  std::thread             decoder;
+  std::mutex              sync;
+  std::condition_variable cv;
+  std::deque<Frame>       queue;
+  std::vector<Pixmap>     freePm;
+  std::vector<uint32_t>   bands;
+  bool                    stop = false;
+  bool                    eof  = false;
 
   Tempest::SoundDevice      sndDev;
   std::vector<std::unique_ptr<SoundContext>> sndCtx;
@@ -239,19 +334,17 @@ void VideoWidget::stopVideo() {
 void VideoWidget::paint(Tempest::Device& device, uint8_t fId) {
   if(ctx==nullptr)
     return;
-  try {
-    ctx->advance();
-    tex[fId] = device.loadTexture(ctx->pm,false);
-    frame    = &tex[fId];
-    update();
-    }
-  catch(const Bink::VideoDecodingException& e) { // video exception is recoverable
-    Log::e("video decoding error. frame: ",ctx->vid.currentFrame(),", what: \"", e.what(), "\"");
-    }
-  catch(...) {
-    Log::e("video decoding error. frame: ",ctx->vid.currentFrame());
-    ctx.reset();
+  // keep repainting: next frame might become due at any time
+  update();
+  auto pm = ctx->advance();
+  if(pm==nullptr) {
+    // no new frame: previous one is in other slot, that might be still in flight
+    if(frame==nullptr || frame==&tex[fId] || ctx->pm.w()==0)
+      return;
+    pm = &ctx->pm;
     }
+  tex[fId] = device.loadTexture(*pm,false);
+  frame    = &tex[fId];
   }
 
 void VideoWidget::paintEvent(PaintEvent& e) {
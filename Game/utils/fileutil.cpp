@@ -22,6 +22,17 @@ bool FileUtil::exists(const std::u16string &path) {
 #endif
   }
 
+bool FileUtil::createDirectory(const std::u16string& path) {
+  if(exists(path))
+    return true;
+#ifdef __WINDOWS__
+  return CreateDirectoryW(reinterpret_cast<const WCHAR*>(path.c_str()),nullptr)!=FALSE;
+#else
+  std::string p=Tempest::TextCodec::toUtf8(path);
+  return mkdir(p.c_str(),0755)==0;
+#endif
+  }
+
 std::u16string FileUtil::caseInsensitiveSegment(const std::u16string& path,const char16_t* segment,Dir::FileType type) {
   std::u16string next=path+segment;
   if(FileUtil::exists(next)) {
@@ -0,0 +1,64 @@
+#include "mappedfile.h"
+
+#include <Tempest/Platform>
+#include <Tempest/TextCodec>
+
+#ifdef __WINDOWS__
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::u16string& path) {
+#ifdef __WINDOWS__
+  HANDLE f = CreateFileW(reinterpret_cast<const WCHAR*>(path.c_str()),GENERIC_READ,FILE_SHARE_READ,
+                         nullptr,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,nullptr);
+  if(f==INVALID_HANDLE_VALUE)
+    return;
+  LARGE_INTEGER fsz = {};
+  if(!GetFileSizeEx(f,&fsz) || fsz.QuadPart<=0) {
+    CloseHandle(f);
+    return;
+    }
+  HANDLE m = CreateFileMappingW(f,nullptr,PAGE_WRITECOPY,0,0,nullptr);
+  CloseHandle(f);
+  if(m==nullptr)
+    return;
+  void* p = MapViewOfFile(m,FILE_MAP_COPY,0,0,0);
+  // view holds a reference to the mapping object
+  CloseHandle(m);
+  if(p==nullptr)
+    return;
+  ptr = reinterpret_cast<uint8_t*>(p);
+  sz  = size_t(fsz.QuadPart);
+#else
+  std::string p = Tempest::TextCodec::toUtf8(path);
+  int f = open(p.c_str(),O_RDONLY);
+  if(f<0)
+    return;
+  struct stat st = {};
+  if(fstat(f,&st)!=0 || st.st_size<=0) {
+    close(f);
+    return;
+    }
+  void* m = mmap(nullptr,size_t(st.st_size),PROT_READ|PROT_WRITE,MAP_PRIVATE,f,0);
+  close(f);
+  if(m==MAP_FAILED)
+    return;
+  ptr = reinterpret_cast<uint8_t*>(m);
+  sz  = size_t(st.st_size);
+#endif
+  }
+
+MappedFile::~MappedFile() {
+  if(ptr==nullptr)
+    return;
+#ifdef __WINDOWS__
+  UnmapViewOfFile(ptr);
+#else
+  munmap(ptr,sz);
+#endif
+  }
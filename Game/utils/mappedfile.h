@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+// Read-only file, mapped to memory with copy-on-write pages:
+// data can be patched in place, without changes being written back to disk.
+class MappedFile final {
+  public:
+    MappedFile(const std::u16string& path);
+    MappedFile(const MappedFile&)=delete;
+    ~MappedFile();
+
+    bool     isOpen() const { return ptr!=nullptr; }
+    uint8_t* data()         { return ptr;  }
+    size_t   size()   const { return sz;   }
+
+  private:
+    uint8_t* ptr = nullptr;
+    size_t   sz  = 0;
+  };
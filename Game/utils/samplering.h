@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+// Wait-free single-producer/single-consumer ring of audio samples.
+// push() is called by one producer thread, pop() by one consumer (audio callback); none of them locks or allocates.
+class SampleRing final {
+  public:
+    explicit SampleRing(size_t minCapacity) {
+      cap = 1;
+      while(cap<minCapacity)
+        cap <<= 1;
+      mask = cap-1;
+      buf.reset(new float[cap]);
+      }
+
+    SampleRing(const SampleRing&) = delete;
+    SampleRing& operator = (const SampleRing&) = delete;
+
+    size_t capacity() const { return cap; }
+
+    // samples available for pop: may only grow, while observed by consumer
+    size_t size() const {
+      const size_t r = tail.load(std::memory_order_acquire);
+      return head.load(std::memory_order_acquire) - r;
+      }
+
+    // producer: appends up to n samples; samples, that do not fit, are dropped and counted as overrun
+    size_t push(const float* s, size_t n) {
+      const size_t w    = head.load(std::memory_order_relaxed);
+      const size_t r    = tail.load(std::memory_order_acquire);
+      const size_t cnt  = std::min(n, cap-(w-r));
+      const size_t at   = w&mask;
+      const size_t part = std::min(cnt, cap-at);
+      std::memcpy(buf.get()+at, s,      part*sizeof(float));
+      std::memcpy(buf.get(),    s+part, (cnt-part)*sizeof(float));
+      head.store(w+cnt, std::memory_order_release);
+      if(cnt<n)
+        overrun.fetch_add(n-cnt, std::memory_order_relaxed);
+      return cnt;
+      }
+
+    // consumer: takes up to n samples; missing samples are counted as underrun
+    size_t pop(float* out, size_t n) {
+      const size_t r    = tail.load(std::memory_order_relaxed);
+      const size_t w    = head.load(std::memory_order_acquire);
+      const size_t cnt  = std::min(n, w-r);
+      const size_t at   = r&mask;
+      const size_t part = std::min(cnt, cap-at);
+      std::memcpy(out,      buf.get()+at, part*sizeof(float));
+      std::memcpy(out+part, buf.get(),    (cnt-part)*sizeof(float));
+      tail.store(r+cnt, std::memory_order_release);
+      if(cnt<n)
+        underrun.fetch_add(n-cnt, std::memory_order_relaxed);
+      return cnt;
+      }
+
+    // consumer: counts n samples as underrun, without touching the buffer
+    void skip(size_t n) {
+      underrun.fetch_add(n, std::memory_order_relaxed);
+      }
+
+    uint64_t overruns()  const { return overrun.load(std::memory_order_relaxed);  }
+    uint64_t underruns() const { return underrun.load(std::memory_order_relaxed); }
+
+  private:
+    std::unique_ptr<float[]> buf;
+    size_t                   cap  = 0;
+    size_t                   mask = 0;
+
+    // positions grow monotonically, index in buf is position&mask
+    std::atomic<size_t>      head{0};
+    std::atomic<size_t>      tail{0};
+    std::atomic<uint64_t>    overrun{0};
+    std::atomic<uint64_t>    underrun{0};
+  };
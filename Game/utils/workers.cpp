@@ -1,20 +1,33 @@
 #include "workers.h"
 
+#include <algorithm>
+
+static const size_t NoWorker = size_t(-1);
+static thread_local size_t workerId = NoWorker;
+
 Workers::Workers() {
-  size_t id=0;
-  for(auto& i:th) {
-    i = std::thread([this,id]() noexcept {
+  const size_t hw = std::max<size_t>(1,std::thread::hardware_concurrency());
+  // caller thread participates in the work as well
+  const size_t cnt = hw-1;
+
+  queue.resize(std::max<size_t>(cnt,1));
+  for(auto& i:queue)
+    i.reset(new Queue());
+
+  th.resize(cnt);
+  for(size_t id=0; id<cnt; ++id) {
+    th[id] = std::thread([this,id]() noexcept {
       threadFunc(id);
       });
-    ++id;
     }
   }
 
 Workers::~Workers() {
-  std::lock_guard<std::mutex> guard(sync);(void)guard;
+  {
+  std::lock_guard<std::mutex> guard(sleepSync);
   running=false;
-  for(size_t i=0;i<MAX_THREADS;++i)
-    workInc[i].release(1);
+  }
+  sleepCv.notify_all();
   for(auto& i:th)
     i.join();
   }
@@ -24,21 +37,160 @@ Workers &Workers::inst() {
   return w;
   }
 
+size_t Workers::threadCount() {
+  return inst().th.size()+1;
+  }
+
+size_t Workers::autoChunk(size_t sz) const {
+  // few chunks per thread, so stealing can compensate uneven cost of elements
+  const size_t parts = (th.size()+1)*8;
+  return std::max<size_t>(1,sz/parts);
+  }
+
+void Workers::execRange(Range& r) {
+  while(true) {
+    const size_t b = r.next.fetch_add(r.chunk);
+    if(b>=r.size)
+      return;
+    const size_t e = std::min(b+r.chunk,r.size);
+    r.body(r.ctx,b,e);
+    }
+  }
+
+void Workers::rangeHelper(void* ctx) {
+  auto& r = *reinterpret_cast<Range*>(ctx);
+  execRange(r);
+  // range is owned by the caller stack - must be last access
+  r.refs.fetch_sub(1);
+  }
+
+void Workers::runRange(Range& r) {
+  const size_t chunks  = (r.size+r.chunk-1)/r.chunk;
+  const size_t helpers = std::min(chunks-1,th.size());
+
+  r.refs.store(helpers);
+  for(size_t i=0; i<helpers; ++i)
+    push(Job{&Workers::rangeHelper,&r});
+
+  execRange(r);
+  waitFor([&r](){ return r.refs.load()==0; });
+  }
+
+void Workers::push(const Job& j) {
+  size_t id = workerId;
+  if(id==NoWorker)
+    id = rrQueue.fetch_add(1);
+  auto& q = *queue[id%queue.size()];
+  {
+  std::lock_guard<std::mutex> guard(q.sync);
+  q.jobs.push_back(j);
+  }
+  queued.fetch_add(1);
+
+  if(sleeping.load()>0) {
+    std::lock_guard<std::mutex> guard(sleepSync);
+    sleepCv.notify_one();
+    }
+  }
+
+bool Workers::pop(size_t id, Job& out) {
+  auto& q = *queue[id];
+  std::lock_guard<std::mutex> guard(q.sync);
+  if(q.jobs.empty())
+    return false;
+  out = q.jobs.back();
+  q.jobs.pop_back();
+  queued.fetch_sub(1);
+  return true;
+  }
+
+bool Workers::steal(size_t id, Job& out) {
+  for(size_t i=1; i<=queue.size(); ++i) {
+    auto& q = *queue[(id+i)%queue.size()];
+    std::unique_lock<std::mutex> guard(q.sync,std::try_to_lock);
+    if(!guard.owns_lock() || q.jobs.empty())
+      continue;
+    out = q.jobs.front();
+    q.jobs.pop_front();
+    queued.fetch_sub(1);
+    return true;
+    }
+  return false;
+  }
+
+bool Workers::runOne() {
+  if(queued.load()==0)
+    return false;
+
+  Job    j;
+  size_t id = workerId;
+  if(id!=NoWorker) {
+    if(!pop(id,j) && !steal(id,j))
+      return false;
+    } else {
+    if(!steal(0,j))
+      return false;
+    }
+  j.exec(j.ctx);
+  return true;
+  }
+
 void Workers::threadFunc(size_t id) {
+  workerId = id;
   while(true) {
-    workInc[id].acquire(1);
-    if(!running) {
-      workDone.release(1);
+    if(runOne())
+      continue;
+
+    std::unique_lock<std::mutex> lck(sleepSync);
+    if(!running)
       return;
+    sleeping.fetch_add(1);
+    sleepCv.wait(lck,[this](){ return !running || queued.load()>0; });
+    sleeping.fetch_sub(1);
+    }
+  }
+
+void Workers::TaskGraph::depend(Id task, Id on) {
+  nodes[on]->next.push_back(task);
+  nodes[task]->deps++;
+  }
+
+void Workers::TaskGraph::execNode(void* ctx) {
+  auto& n     = *reinterpret_cast<Node*>(ctx);
+  auto& owner = *n.owner;
+  if(!owner.failed.load()) {
+    try {
+      n.exec();
       }
+    catch(...) {
+      if(!owner.failed.exchange(true))
+        owner.err = std::current_exception();
+      }
+    }
+  for(auto i:n.next) {
+    auto& s = *owner.nodes[i];
+    if(s.pending.fetch_sub(1)==1)
+      Workers::inst().push(Job{&TaskGraph::execNode,&s});
+    }
+  // graph is owned by the caller stack - must be last access
+  owner.remaining.fetch_sub(1);
+  }
 
-    size_t b = ((id  )*workSize)/workTasks;
-    size_t e = ((id+1)*workSize)/workTasks;
+void Workers::TaskGraph::run() {
+  if(nodes.size()==0)
+    return;
 
-    void* d = &workSet[b*workEltSize];
-    if(b!=e)
-      workFunc(d,e-b);
+  auto& w = Workers::inst();
+  remaining.store(nodes.size());
+  failed.store(false);
+  err = nullptr;
+  for(auto& i:nodes)
+    i->pending.store(i->deps);
 
-    workDone.release(1);
-    }
+  for(auto& i:nodes)
+    if(i->deps==0)
+      w.push(Job{&TaskGraph::execNode,i.get()});
+  w.waitFor([this](){ return remaining.load()==0; });
+  if(err!=nullptr)
+    std::rethrow_exception(err);
   }
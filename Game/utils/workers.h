@@ -1,11 +1,13 @@
 #pragma once
 
-#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <vector>
-#include <functional>
-
-#include "semaphore.h"
 
 class Workers final {
   public:
@@ -13,58 +15,184 @@ class Workers final {
     ~Workers();
 
     static Workers& inst();
+    // number of threads, that can execute work at once (including caller thread)
+    static size_t   threadCount();
+
+    class TaskGraph;
 
     template<class T,class F>
     static void parallelFor(T* b, T* e, F func) {
-      inst().runParallelFor(b,std::distance(b,e),std::thread::hardware_concurrency(),func);
+      inst().runParallelFor(b,size_t(std::distance(b,e)),0,func);
+      }
+
+    template<class T,class F>
+    static void parallelFor(T* b, T* e, size_t chunk, F func) {
+      inst().runParallelFor(b,size_t(std::distance(b,e)),chunk,func);
       }
 
     template<class T,class F>
     static void parallelFor(std::vector<T>& data, F func) {
-      inst().runParallelFor(data.data(),data.size(),std::thread::hardware_concurrency(),func);
+      inst().runParallelFor(data.data(),data.size(),0,func);
       }
 
     template<class T,class F>
-    static void parallelFor(std::vector<T>& data, size_t maxTh, F func) {
-      inst().runParallelFor(data.data(),data.size(),maxTh,func);
+    static void parallelFor(std::vector<T>& data, size_t chunk, F func) {
+      inst().runParallelFor(data.data(),data.size(),chunk,func);
+      }
+
+    // run function on worker pool, without waiting for completion
+    template<class F>
+    static void async(F func) {
+      auto& w = inst();
+      if(w.th.size()==0) {
+        func();
+        return;
+        }
+      w.push(Job{[](void* ctx){
+        std::unique_ptr<F> f(reinterpret_cast<F*>(ctx));
+        (*f)();
+        },new F(std::move(func))});
+      }
+
+    // block until condition is true, helping with pending work meanwhile
+    template<class Pred>
+    static void wait(Pred p) {
+      inst().waitFor(p);
       }
 
     template<class T,class F>
-    void runParallelFor(T* data, size_t sz, size_t maxTh, F func) {
-      std::lock_guard<std::mutex> guard(sync);(void)guard;
-      workSet     = reinterpret_cast<uint8_t*>(data);
-      workSize    = sz;
-      workEltSize = sizeof(T);
-
-      workFunc = [&func](void* data,size_t sz) {
-        T* tdata = reinterpret_cast<T*>(data);
+    void runParallelFor(T* data, size_t sz, size_t chunk, F& func) {
+      if(sz==0)
+        return;
+      if(chunk==0)
+        chunk = autoChunk(sz);
+      if(sz<=chunk || th.size()==0) {
         for(size_t i=0;i<sz;++i)
-          func(tdata[i]);
-        };
-
-      if(maxTh>MAX_THREADS)
-        workTasks = MAX_THREADS; else
-        workTasks = maxTh;
+          func(data[i]);
+        return;
+        }
 
-      for(size_t i=0;i<workTasks;++i)
-        workInc[i].release(1);
-      workDone.acquire(uint32_t(workTasks));
+      struct Ctx {
+        T* data;
+        F* func;
+        };
+      Ctx   ctx = {data,&func};
+      Range r;
+      r.size  = sz;
+      r.chunk = chunk;
+      r.ctx   = &ctx;
+      r.body  = [](void* c, size_t b, size_t e) {
+        auto& cx = *reinterpret_cast<Ctx*>(c);
+        for(size_t i=b;i<e;++i)
+          (*cx.func)(cx.data[i]);
+        };
+      runRange(r);
       }
 
   private:
-    enum { MAX_THREADS=16 };
+    struct Job {
+      void (*exec)(void* ctx) = nullptr;
+      void* ctx               = nullptr;
+      };
+
+    struct Queue {
+      std::mutex      sync;
+      std::deque<Job> jobs;
+      };
+
+    struct Range {
+      std::atomic<size_t> next{0};
+      std::atomic<size_t> refs{0};
+      size_t              size  = 0;
+      size_t              chunk = 1;
+      void*               ctx   = nullptr;
+      void              (*body)(void* ctx, size_t b, size_t e) = nullptr;
+      };
+
+    static void execRange(Range& r);
+    static void rangeHelper(void* ctx);
+
+    size_t      autoChunk(size_t sz) const;
+    void        runRange(Range& r);
+
+    void        push(const Job& j);
+    bool        pop(size_t id, Job& out);
+    bool        steal(size_t id, Job& out);
+    bool        runOne();
+    template<class Pred>
+    void        waitFor(Pred p) {
+      // help with pending work, instead of blocking - this makes nested submissions safe
+      while(!p()) {
+        if(!runOne())
+          std::this_thread::yield();
+        }
+      }
+
+    void        threadFunc(size_t id);
 
-    void threadFunc(size_t id);
+    std::vector<std::thread>            th;
+    std::vector<std::unique_ptr<Queue>> queue;
 
-    std::thread th     [MAX_THREADS];
-    Semaphore   workInc[MAX_THREADS];
-    std::mutex  sync;
-    bool        running=true;
+    std::atomic<size_t>                 queued{0};
+    std::atomic<size_t>                 sleeping{0};
+    std::atomic<size_t>                 rrQueue{0};
+    std::mutex                          sleepSync;
+    std::condition_variable             sleepCv;
+    bool                                running=true;
+  };
+
+// Set of tasks with dependencies. Task is started, once all of it's dependencies are complete.
+// Tasks may submit nested work (parallelFor or another graph) - waiting threads help with pending jobs.
+// First exception thrown by a task cancels tasks, that are not started yet, and is rethrown from run().
+class Workers::TaskGraph final {
+  public:
+    using Id = size_t;
 
-    uint8_t*                          workSet=nullptr;
-    size_t                            workSize=0,workEltSize=0;
-    size_t                            workTasks=0;
-    std::function<void(void*,size_t)> workFunc;
+    TaskGraph() = default;
+    TaskGraph(const TaskGraph&) = delete;
 
-    Semaphore   workDone;
+    template<class F>
+    Id   add(F func) {
+      nodes.emplace_back(new Impl<F>(std::move(func)));
+      nodes.back()->owner = this;
+      return nodes.size()-1;
+      }
+
+    template<class F>
+    Id   add(F func, std::initializer_list<Id> deps) {
+      Id ret = add(std::move(func));
+      for(auto i:deps)
+        depend(ret,i);
+      return ret;
+      }
+
+    // task will not start before 'on' is complete
+    void depend(Id task, Id on);
+    // execute all tasks and wait for completion; graph must be acyclic
+    void run();
+
+  private:
+    struct Node {
+      virtual ~Node() = default;
+      virtual void         exec() = 0;
+
+      TaskGraph*           owner = nullptr;
+      std::atomic<size_t>  pending{0};
+      size_t               deps  = 0;
+      std::vector<Id>      next;
+      };
+
+    template<class F>
+    struct Impl : Node {
+      Impl(F&& f):func(std::move(f)){}
+      void exec() override { func(); }
+      F    func;
+      };
+
+    static void execNode(void* ctx);
+
+    std::vector<std::unique_ptr<Node>> nodes;
+    std::atomic<size_t>                remaining{0};
+    std::atomic_bool                   failed{false};
+    std::exception_ptr                 err;
   };
@@ -62,6 +62,10 @@ Interactive::Interactive(Vob* parent, World &world, ZenLoad::zCVobData&& vob, bo
   world.addInteractive(this);
   }
 
+Interactive::~Interactive() {
+  Resources::release(mesh);
+  }
+
 void Interactive::load(Serialize &fin) {
   Tempest::Matrix4x4 pos;
   uint8_t vt=0;
@@ -132,8 +136,12 @@ void Interactive::resetPositionToTA() {
   }
 
 void Interactive::setVisual(const std::string& body) {
-  const Skeleton* skeleton = Resources::loadSkeleton(body.c_str());
-  mesh        = Resources::loadMesh(body);
+  const Skeleton*  skeleton = Resources::loadSkeleton(body.c_str());
+  const ProtoMesh* proto    = Resources::loadMesh(body);
+  // mesh is used for attach points and scheme, even if not shown - keep it resident
+  Resources::retain (proto);
+  Resources::release(mesh);
+  mesh        = proto;
   animChanged = true;
 
   if(mesh) {
@@ -158,8 +166,8 @@ void Interactive::setVisual(const std::string& body) {
   setAnim(Interactive::Active); // setup default anim
   }
 
-void Interactive::updateAnimation() {
-  animChanged |= visual.updateAnimation(nullptr,world);
+void Interactive::updateAnimation(bool compose) {
+  animChanged |= visual.updateAnimation(nullptr,world,compose);
   }
 
 void Interactive::tick(uint64_t dt) {
@@ -25,12 +25,13 @@ class Interactive : public Vob {
       };
 
     Interactive(Vob* parent, World& world, ZenLoad::zCVobData &&vob, bool startup);
+    ~Interactive() override;
 
     void                load(Serialize& fin) override;
     void                save(Serialize& fout) const override;
 
     void                resetPositionToTA();
-    void                updateAnimation();
+    void                updateAnimation(bool compose);
     void                tick(uint64_t dt);
 
     const std::string&  tag() const;
@@ -634,7 +634,7 @@ int Npc::calcAniComb() const {
   return comb;
   }
 
-void Npc::updateAnimation() {
+void Npc::updateAnimation(bool compose) {
   if(currentTarget!=nullptr)
     visual.setTarget(currentTarget->position()); else
     visual.setTarget(position());
@@ -643,7 +643,7 @@ void Npc::updateAnimation() {
     updatePos();
     durtyTranform=0;
     }
-  visual.updateAnimation(this,owner);
+  visual.updateAnimation(this,owner,compose);
   }
 
 void Npc::updateTransform() {
@@ -786,10 +786,6 @@ void Npc::updateWeaponSkeleton() {
   }
 
 void Npc::tickTimedEvt(Animation::EvCount& ev) {
-  std::sort(ev.timed.begin(),ev.timed.end(),[](const Animation::EvTimed& a,const Animation::EvTimed& b){
-    return a.time<b.time;
-    });
-
   for(auto& i:ev.timed) {
     switch(i.def) {
       case ZenLoad::DEF_CREATE_ITEM: {
@@ -1617,10 +1613,24 @@ Npc* Npc::updateNearestBody() {
   return ret;
   }
 
-void Npc::tick(uint64_t dt) {
-  Animation::EvCount ev;
-  visual.pose().processEvents(lastEventTime,owner.tickCount(),ev);
+void Npc::preTick(uint64_t dt) {
+  tickEv.def_opt_frame = 0;
+  tickEv.groundSounds  = 0;
+  tickEv.weaponCh      = ZenLoad::FM_LAST;
+  tickEv.timed.clear();
+
+  visual.pose().processEvents(lastEventTime,owner.tickCount(),tickEv);
   visual.processLayers(owner,calcAniComb());
+  if(!tickEv.timed.empty()) {
+    std::sort(tickEv.timed.begin(),tickEv.timed.end(),[](const Animation::EvTimed& a,const Animation::EvTimed& b){
+      return a.time<b.time;
+      });
+    }
+  mvAlgo.prefetch(dt);
+  }
+
+void Npc::tick(uint64_t dt) {
+  auto& ev = tickEv;
   if(!visual.pose().hasAnim())
     setAnim(AnimationSolver::Idle);
 
@@ -3271,6 +3281,16 @@ bool Npc::canSeeNpc(float tx, float ty, float tz, bool freeLos) const {
   return int32_t(s&SensesBit::SENSE_SEE)!=0;
   }
 
+int32_t Npc::room() const {
+  // bsp lookup is only repeated, when npc has moved
+  auto pos = position();
+  if(pos!=roomCacheKey) {
+    roomCacheKey = pos;
+    roomCache    = owner.sectorAt(pos);
+    }
+  return roomCache;
+  }
+
 SensesBit Npc::canSenseNpc(const Npc &oth, bool freeLos, float extRange) const {
   const bool isNoisy = (oth.bodyState()&BodyState::BS_SNEAK)==0;
   return canSenseNpc(oth.x,oth.y+180,oth.z,freeLos,isNoisy,extRange);
@@ -3285,7 +3305,7 @@ SensesBit Npc::canSenseNpc(float tx, float ty, float tz, bool freeLos, bool isNo
     return SensesBit::SENSE_NONE;
 
   SensesBit ret=SensesBit::SENSE_NONE;
-  if(owner.roomAt({tx,ty,tz})==owner.roomAt({x,y,z})) {
+  if(owner.sectorAt({tx,ty,tz})==room()) {
     ret = ret | SensesBit::SENSE_SMELL;
     if(isNoisy)
       ret = ret | SensesBit::SENSE_HEAR;
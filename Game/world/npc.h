@@ -185,6 +185,8 @@ class Npc final {
     bool       isPlayer() const;
     void       setWalkMode(WalkBit m);
     auto       walkMode() const { return wlkMode; }
+    // part of tick, that doesn't touch script or other npc's; safe to run in parallel
+    void       preTick(uint64_t dt);
     void       tick(uint64_t dt);
     bool       startClimb(JumpCode code);
 
@@ -207,7 +209,7 @@ class Npc final {
     float      qDistTo(const Npc& p) const;
     float      qDistTo(const Interactive& p) const;
 
-    void       updateAnimation();
+    void       updateAnimation(bool compose);
     void       updateTransform();
 
     const char*displayName() const;
@@ -444,6 +446,7 @@ class Npc final {
 
     bool      canSeeNpc(const Npc& oth,bool freeLos) const;
     bool      canSeeNpc(float x,float y,float z,bool freeLos) const;
+    int32_t   room() const;
     auto      canSenseNpc(const Npc& oth,bool freeLos, float extRange=0.f) const -> SensesBit;
     auto      canSenseNpc(float x,float y,float z,bool freeLos,bool isNoisy,float extRange=0.f) const -> SensesBit;
 
@@ -682,6 +685,8 @@ class Npc final {
     AiOuputPipe*                   outputPipe     =nullptr;
 
     Tempest::Vec3                  moveMobCacheKey={std::numeric_limits<float>::infinity(),0.f,0.f};
+    mutable Tempest::Vec3          roomCacheKey   ={std::numeric_limits<float>::infinity(),0.f,0.f};
+    mutable int32_t                roomCache      =-1;
     Interactive*                   moveMob        =nullptr;
 
     GoTo                           go2;
@@ -692,6 +697,7 @@ class Npc final {
     MoveAlgo                       mvAlgo;
     FightAlgo                      fghAlgo;
     uint64_t                       lastEventTime=0;
+    Animation::EvCount             tickEv;
 
   friend class MoveAlgo;
   };
@@ -1,116 +1,271 @@
 #include "spaceindex.h"
 
+#include <cmath>
+
+#include "graphics/dynamic/frustrum.h"
 #include "vob.h"
 
 void BaseSpaceIndex::clear() {
   arr.clear();
-  index.clear();
+  nodes.clear();
+  slot.clear();
+  cells.clear();
+  pending.obj.clear();
+  dirty = false;
   }
 
 void BaseSpaceIndex::invalidate() {
-  index.clear();
+  dirty = true;
   }
 
 void BaseSpaceIndex::add(Vob* v) {
+  if(v==nullptr || slot.find(v)!=slot.end())
+    return;
+  const uint32_t id = uint32_t(arr.size());
   arr.push_back(v);
-  index.reserve(arr.size());
-  index.clear();
+  nodes.emplace_back();
+  slot[v] = id;
+
+  // position is not final at this point(caller may set matrix after add) - bucket it on next query
+  auto& n = nodes[id];
+  n.queued = true;
+  n.cellId = uint32_t(pending.obj.size());
+  pending.obj.push_back(id);
   }
 
 void BaseSpaceIndex::del(Vob* v) {
-  for(size_t i=0;i<arr.size();++i) {
-    if(arr[i]==v) {
-      arr[i] = arr.back();
-      arr.pop_back();
-      index.clear();
-      return;
-      }
+  auto it = slot.find(v);
+  if(it==slot.end())
+    return;
+  const uint32_t id   = it->second;
+  const uint32_t last = uint32_t(arr.size()-1);
+  slot.erase(it);
+  remove(id);
+
+  if(id!=last) {
+    arr  [id] = arr  [last];
+    nodes[id] = nodes[last];
+    slot[arr[id]] = id;
+    cellOf(nodes[id]).obj[nodes[id].cellId] = id;
     }
+  arr.pop_back();
+  nodes.pop_back();
+  }
+
+void BaseSpaceIndex::update(Vob* v) {
+  auto it = slot.find(v);
+  if(it==slot.end())
+    return;
+  // object is moved out of it's cell now and rebucketed together with others on next query
+  const uint32_t id = it->second;
+  auto&          n  = nodes[id];
+  if(n.queued)
+    return;
+  remove(id);
+  n.queued = true;
+  n.cellId = uint32_t(pending.obj.size());
+  pending.obj.push_back(id);
   }
 
 bool BaseSpaceIndex::hasObject(const Vob* v) const {
   if(v==nullptr)
     return false;
-  for(size_t i=0;i<arr.size();++i)
-    if(arr[i]==v)
-      return true;
-  return false;
+  return slot.find(v)!=slot.end();
   }
 
 void BaseSpaceIndex::find(const Tempest::Vec3& p, float R, void* ctx, void (*func)(void*, Vob*)) {
-  if(index.size()==0)
-    buildIndex();
-  implFind(index.data(),index.size(),0,p,R,ctx,func);
+  commit();
+  const float R2 = R*R;
+  forCells(p.x-R,p.z-R,p.x+R,p.z+R,[&](Cell& c){
+    if(c.ymax<p.y-R || p.y+R<c.ymin)
+      return;
+    for(auto id:c.obj)
+      if((nodes[id].pos-p).quadLength()<=R2)
+        func(ctx,arr[id]);
+    });
   }
 
-void BaseSpaceIndex::buildIndex() {
-  index.resize(arr.size());
-  for(size_t i=0; i<arr.size(); ++i)
-    index[i] = arr[i];
-  buildIndex(index.data(),index.size(),0);
+void BaseSpaceIndex::find(const Tempest::Vec3& min, const Tempest::Vec3& max, void* ctx, void (*func)(void*, Vob*)) {
+  commit();
+  forCells(min.x,min.z,max.x,max.z,[&](Cell& c){
+    if(c.ymax<min.y || max.y<c.ymin)
+      return;
+    for(auto id:c.obj) {
+      auto& pos = nodes[id].pos;
+      if(min.x<=pos.x && pos.x<=max.x &&
+         min.y<=pos.y && pos.y<=max.y &&
+         min.z<=pos.z && pos.z<=max.z)
+        func(ctx,arr[id]);
+      }
+    });
   }
 
-void BaseSpaceIndex::buildIndex(Vob** v, size_t cnt, uint8_t depth) {
-  depth%=3;
-  sort(v,cnt,depth);
-  size_t mid = cnt/2;
-  if(mid>0) {
-    // [0..mid)
-    buildIndex(v,mid,uint8_t(depth+1u));
-    }
-  if(mid+1<cnt) {
-    // (mid..cnt)
-    buildIndex(v+mid+1,cnt-mid-1,uint8_t(depth+1u));
+void BaseSpaceIndex::find(const Frustrum& f, void* ctx, void (*func)(void*, Vob*)) {
+  commit();
+  const float hs = CellSize*0.5f;
+  for(auto& i:cells) {
+    auto& c  = i.second;
+    float cx = (float(int32_t(i.first>>32))+0.5f)*CellSize;
+    float cz = (float(int32_t(i.first    ))+0.5f)*CellSize;
+    float cy = (c.ymin+c.ymax)*0.5f;
+    float hy = (c.ymax-c.ymin)*0.5f;
+    if(!f.testPoint(cx,cy,cz,std::sqrt(2.f*hs*hs+hy*hy)))
+      continue;
+    for(auto id:c.obj) {
+      auto& pos = nodes[id].pos;
+      if(f.testPoint(pos.x,pos.y,pos.z))
+        func(ctx,arr[id]);
+      }
     }
   }
 
-void BaseSpaceIndex::sort(Vob** v, size_t cnt, uint8_t component) {
-  bool (*predicate)(const Vob* a, const Vob* b) = nullptr;
-  switch(component) {
-    case 0:
-      predicate = [](const Vob* a, const Vob* b){ return a->position().x < b->position().x; };
-      break;
-    case 1:
-      predicate = [](const Vob* a, const Vob* b){ return a->position().y < b->position().y; };
-      break;
-    case 2:
-      predicate = [](const Vob* a, const Vob* b){ return a->position().z < b->position().z; };
-      break;
+size_t BaseSpaceIndex::findNearest(const Tempest::Vec3& p, float R, Vob** out, size_t k) {
+  commit();
+  if(k==0 || cells.size()==0)
+    return 0;
+
+  std::vector<std::pair<float,uint32_t>> best;
+  best.reserve(k+1);
+  float R2 = R*R;
+
+  auto test = [&](Cell& c) {
+    for(auto id:c.obj) {
+      float d = (nodes[id].pos-p).quadLength();
+      if(d>R2)
+        continue;
+      auto at = std::upper_bound(best.begin(),best.end(),std::make_pair(d,id));
+      best.insert(at,std::make_pair(d,id));
+      if(best.size()>k) {
+        best.pop_back();
+        R2 = best.back().first;
+        }
+      }
+    };
+
+  const float rings = R/CellSize+1.f;
+  if(rings*rings*4.f>=float(cells.size())) {
+    // sparse index or large radius - cheaper to walk over populated cells
+    for(auto& i:cells)
+      test(i.second);
+    } else {
+    // rings of cells around 'p': cell at ring 'r+1' is at least r*CellSize away
+    const int32_t cx      = cellCoord(p.x);
+    const int32_t cz      = cellCoord(p.z);
+    const int32_t maxRing = int32_t(rings);
+    for(int32_t r=0; r<=maxRing; ++r) {
+      if(r>1 && float(r-1)*float(r-1)*CellSize*CellSize>R2)
+        break;
+      for(int32_t x=cx-r; x<=cx+r; ++x) {
+        for(int32_t z=cz-r; z<=cz+r; ++z) {
+          if(x!=cx-r && x!=cx+r && z!=cz-r && z!=cz+r)
+            z = cz+r;
+          auto c = cells.find(cellKey(x,z));
+          if(c!=cells.end())
+            test(c->second);
+          }
+        }
+      }
     }
-  std::sort(v,v+cnt,predicate);
+
+  for(size_t i=0; i<best.size(); ++i)
+    out[i] = arr[best[i].second];
+  return best.size();
   }
 
-void BaseSpaceIndex::implFind(Vob** v, size_t cnt, uint8_t depth,
-                              const Tempest::Vec3& p, float R, void* ctx, void (*func)(void*, Vob*)) {
-  if(cnt==0)
+int32_t BaseSpaceIndex::cellCoord(float v) {
+  return int32_t(std::floor(v/CellSize));
+  }
+
+uint64_t BaseSpaceIndex::cellKey(int32_t x, int32_t z) {
+  return (uint64_t(uint32_t(x))<<32) | uint64_t(uint32_t(z));
+  }
+
+BaseSpaceIndex::Cell& BaseSpaceIndex::cellOf(const Node& n) {
+  if(n.queued)
+    return pending;
+  return cells[n.cell];
+  }
+
+template<class Fn>
+void BaseSpaceIndex::forCells(float x0, float z0, float x1, float z1, Fn fn) {
+  const int32_t ix0 = cellCoord(x0), ix1 = cellCoord(x1);
+  const int32_t iz0 = cellCoord(z0), iz1 = cellCoord(z1);
+  const uint64_t cnt = uint64_t(ix1-ix0+1)*uint64_t(iz1-iz0+1);
+
+  if(cnt>cells.size()) {
+    // large query - cheaper to walk over populated cells
+    for(auto& i:cells) {
+      int32_t x = int32_t(i.first>>32);
+      int32_t z = int32_t(i.first);
+      if(ix0<=x && x<=ix1 && iz0<=z && z<=iz1)
+        fn(i.second);
+      }
     return;
+    }
+
+  for(int32_t x=ix0; x<=ix1; ++x)
+    for(int32_t z=iz0; z<=iz1; ++z) {
+      auto c = cells.find(cellKey(x,z));
+      if(c!=cells.end())
+        fn(c->second);
+      }
+  }
+
+void BaseSpaceIndex::commit() {
+  if(dirty) {
+    for(uint32_t i=0; i<arr.size(); ++i)
+      refit(i);
+    dirty = false;
+    }
+  while(pending.obj.size()>0)
+    refit(pending.obj.back());
+  }
 
-  auto mid = cnt/2;
-  auto pos = v[mid]->position();
+void BaseSpaceIndex::insert(uint32_t id) {
+  auto&   n   = nodes[id];
+  int32_t x   = cellCoord(n.pos.x);
+  int32_t z   = cellCoord(n.pos.z);
+  auto    key = cellKey(x,z);
+  auto&   c   = cells[key];
 
-  if((pos-p).quadLength()<=R*R) {
-    func(ctx,v[mid]);
+  if(c.obj.size()==0) {
+    c.ymin = n.pos.y;
+    c.ymax = n.pos.y;
+    } else {
+    c.ymin = std::min(c.ymin,n.pos.y);
+    c.ymax = std::max(c.ymax,n.pos.y);
     }
 
-  depth%=3;
-  switch(depth) {
-    case 0:
-      if(p.x-R<=pos.x)
-        implFind(v,mid,uint8_t(depth+1u),p,R, ctx,func);
-      if(p.x+R>=pos.x)
-        implFind(v+mid+1,cnt-mid-1,uint8_t(depth+1u),p,R, ctx,func);
-      break;
-    case 1:
-      if(p.y-R<=pos.y)
-        implFind(v,mid,uint8_t(depth+1u),p,R, ctx,func);
-      if(p.y+R>=pos.y)
-        implFind(v+mid+1,cnt-mid-1,uint8_t(depth+1u),p,R, ctx,func);
-      break;
-    case 2:
-      if(p.z-R<=pos.z)
-        implFind(v,mid,uint8_t(depth+1u),p,R, ctx,func);
-      if(p.z+R>=pos.z)
-        implFind(v+mid+1,cnt-mid-1,uint8_t(depth+1u),p,R, ctx,func);
-      break;
+  n.queued = false;
+  n.cell   = key;
+  n.cellId = uint32_t(c.obj.size());
+  c.obj.push_back(id);
+  }
+
+void BaseSpaceIndex::remove(uint32_t id) {
+  auto& n = nodes[id];
+  auto& c = cellOf(n);
+
+  const uint32_t last = c.obj.back();
+  c.obj[n.cellId]      = last;
+  nodes[last].cellId   = n.cellId;
+  c.obj.pop_back();
+
+  if(!n.queued && c.obj.size()==0)
+    cells.erase(n.cell);
+  }
+
+void BaseSpaceIndex::refit(uint32_t id) {
+  auto& n   = nodes[id];
+  auto  pos = arr[id]->position();
+  if(!n.queued && n.cell==cellKey(cellCoord(pos.x),cellCoord(pos.z))) {
+    auto& c = cells[n.cell];
+    n.pos  = pos;
+    c.ymin = std::min(c.ymin,n.pos.y);
+    c.ymax = std::max(c.ymax,n.pos.y);
+    return;
     }
+  remove(id);
+  n.pos = pos;
+  insert(id);
   }
@@ -5,38 +5,72 @@
 #include <algorithm>
 #include <array>
 #include <memory>
+#include <unordered_map>
 #include <Tempest/Point>
 
 #include "utils/workers.h"
 
 class Vob;
+class Frustrum;
 
 class BaseSpaceIndex {
   public:
     void   clear();
     size_t size() const { return arr.size(); }
+    // positions of objects are changed - cells are refitted on next query
     void   invalidate();
 
   protected:
     BaseSpaceIndex() = default;
     void               add(Vob* v);
     void               del(Vob* v);
+    void               update(Vob* v);
     bool               hasObject(const Vob* v) const;
 
     void               find(const Tempest::Vec3& p,float R,void* ctx,void (*func)(void*, Vob*));
+    void               find(const Tempest::Vec3& min,const Tempest::Vec3& max,void* ctx,void (*func)(void*, Vob*));
+    void               find(const Frustrum& f,void* ctx,void (*func)(void*, Vob*));
+    size_t             findNearest(const Tempest::Vec3& p,float R,Vob** out,size_t k);
     template<class Func>
     void               parallelFor(Func f);
     Vob**              data() { return arr.data(); }
     Vob*const*         data() const { return arr.data(); }
 
   private:
-    std::vector<Vob*>  arr;
-    std::vector<Vob*>  index;
-
-    void               buildIndex();
-    void               buildIndex(Vob** v, size_t cnt, uint8_t depth);
-    void               sort(Vob** v, size_t cnt, uint8_t component);
-    void               implFind(Vob** v, size_t cnt, uint8_t depth, const Tempest::Vec3& p, float R, void* ctx, void(*func)(void*, Vob*));
+    // objects are bucketed into uniform grid over horizontal plane
+    static constexpr float CellSize = 1000.f;
+
+    struct Node {
+      Tempest::Vec3 pos;
+      uint64_t      cell   = 0;
+      uint32_t      cellId = 0;
+      bool          queued = false;
+      };
+
+    struct Cell {
+      std::vector<uint32_t> obj;
+      float                 ymin = 0;
+      float                 ymax = 0;
+      };
+
+    std::vector<Vob*>                       arr;
+    std::vector<Node>                       nodes;
+    std::unordered_map<const Vob*,uint32_t> slot;
+    std::unordered_map<uint64_t,Cell>       cells;
+    Cell                                    pending;
+    bool                                    dirty = false;
+
+    static int32_t     cellCoord(float v);
+    static uint64_t    cellKey(int32_t x, int32_t z);
+    Cell&              cellOf(const Node& n);
+
+    void               commit();
+    void               insert(uint32_t id);
+    void               remove(uint32_t id);
+    void               refit(uint32_t id);
+
+    template<class Fn>
+    void               forCells(float x0, float z0, float x1, float z1, Fn fn);
   };
 
 template<class Func>
@@ -58,6 +92,11 @@ class SpaceIndex final : public BaseSpaceIndex {
       BaseSpaceIndex::del(v);
       }
 
+    // position of 'v' is changed - cheaper than invalidate, when few objects are moving
+    void update(T* v) {
+      BaseSpaceIndex::update(v);
+      }
+
     bool hasObject(const T* v) const {
       return BaseSpaceIndex::hasObject(v);
       }
@@ -76,6 +115,27 @@ class SpaceIndex final : public BaseSpaceIndex {
         });
       }
 
+    template<class Func>
+    void find(const Tempest::Vec3& min,const Tempest::Vec3& max,Func f) {
+      return BaseSpaceIndex::find(min,max,&f,[](void* ctx, Vob* v){
+        auto& f = *reinterpret_cast<Func*>(ctx);
+        f(*reinterpret_cast<T*>(v));
+        });
+      }
+
+    template<class Func>
+    void find(const Frustrum& fr,Func f) {
+      return BaseSpaceIndex::find(fr,&f,[](void* ctx, Vob* v){
+        auto& f = *reinterpret_cast<Func*>(ctx);
+        f(*reinterpret_cast<T*>(v));
+        });
+      }
+
+    // up to k closest objects within R, sorted by distance
+    size_t findNearest(const Tempest::Vec3& p,float R,T** out,size_t k) {
+      return BaseSpaceIndex::findNearest(p,R,reinterpret_cast<Vob**>(out),k);
+      }
+
     template<class F>
     void parallelFor(F func) {
       BaseSpaceIndex::parallelFor([&func](Vob* v){ func(*reinterpret_cast<T*>(v)); });
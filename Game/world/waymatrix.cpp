@@ -2,6 +2,7 @@
 
 #include <Tempest/Log>
 #include <algorithm>
+#include <cmath>
 #include <limits>
 
 #include "world.h"
@@ -9,6 +10,36 @@
 
 using namespace Tempest;
 
+// per-thread search state: path queries don't touch shared waypoints and can run concurrently
+struct PathScratch final {
+  struct Open {
+    float    f  = 0; // priority: path length + heuristic
+    int32_t  g  = 0; // path length, at the moment of push
+    uint32_t id = 0;
+    };
+
+  std::vector<uint32_t> gen;
+  std::vector<int32_t>  len;
+  std::vector<uint32_t> parent;
+  std::vector<Open>     open;
+  uint32_t              curGen=0;
+
+  void begin(size_t sz) {
+    curGen++;
+    if(gen.size()!=sz || curGen==0) {
+      gen   .assign(sz,0);
+      len   .resize(sz);
+      parent.resize(sz);
+      curGen = 1;
+      }
+    open.clear();
+    }
+
+  bool isVisited(uint32_t id) const { return gen[id]==curGen; }
+  };
+
+static thread_local PathScratch pathScratch;
+
 WayMatrix::WayMatrix(World &world, const ZenLoad::zCWayNetData &dat)
   :world(world) {
   wayPoints.resize(dat.waypoints.size());
@@ -25,9 +56,6 @@ WayMatrix::WayMatrix(World &world, const ZenLoad::zCWayNetData &dat)
   for(auto& i:wayPoints)
     if(i.name.find("START")!=std::string::npos)
       startPoints.push_back(i);
-
-  stk[0].reserve(256);
-  stk[1].reserve(256);
   }
 
 void WayMatrix::buildIndex() {
@@ -39,11 +67,12 @@ void WayMatrix::buildIndex() {
     return a->name<b->name;
     });
 
-  for(auto& i:freePoints)
-    fpInd.push_back(&i);
-  std::sort(fpInd.begin(),fpInd.end(),[](const WayPoint* a,const WayPoint* b){
-    return a->x<b->x;
-    });
+  std::vector<const WayPoint*> pt(wayPoints.size());
+  for(size_t i=0;i<wayPoints.size();++i)
+    pt[i] = &wayPoints[i];
+  wpIndex.build(std::move(pt));
+  allIndex.build(std::vector<const WayPoint*>(indexPoints.begin(),indexPoints.end()));
+  fpIndex.clear();
 
   for(auto& i:edges){
     if(i.first<wayPoints.size() && i.second<wayPoints.size()){
@@ -54,22 +83,19 @@ void WayMatrix::buildIndex() {
       b.connect(a);
       }
     }
+
+  heuristicScale = 1.f;
+  for(auto& w:wayPoints)
+    for(auto& c:w.connections()) {
+      float d = std::sqrt(w.qDistTo(c.point->x,c.point->y,c.point->z));
+      if(d>0)
+        heuristicScale = std::min(heuristicScale,float(c.len)/d);
+      }
+  clearPathCache();
   }
 
 const WayPoint *WayMatrix::findWayPoint(float x, float y, float z) const {
-  const WayPoint* ret =nullptr;
-  float           dist=std::numeric_limits<float>::max();
-  for(auto& w:wayPoints){
-    float dx = w.x-x;
-    float dy = w.y-y;
-    float dz = w.z-z;
-    float l=dx*dx+dy*dy+dz*dz;
-    if(l<dist){
-      ret  = &w;
-      dist = l;
-      }
-    }
-  return ret;
+  return wpIndex.findNearest(x,y,z,std::numeric_limits<float>::max());
   }
 
 const WayPoint *WayMatrix::findFreePoint(float x, float y, float z, const char *name) const {
@@ -89,22 +115,11 @@ const WayPoint *WayMatrix::findNextFreePoint(float x, float y, float z, const ch
   }
 
 const WayPoint *WayMatrix::findNextPoint(float x, float y, float z) const {
-  const WayPoint* ret   = nullptr;
-  float           dist  = 20.f*100.f; // see scripting doc
-
-  dist*=dist;
-  for(auto pw:indexPoints){
-    auto& w  = *pw;
-    float dx = w.x-x;
-    float dy = w.y-y;
+  const float R = 20.f*100.f; // see scripting doc
+  return allIndex.findNearest(x,y,z,R,[z](const WayPoint& w){
     float dz = w.z-z;
-    float l=dx*dx+dy*dy+dz*dz;
-    if(l<dist && dz*dz<300*300 && !w.isLocked()){
-      ret  = &w;
-      dist = l;
-      }
-    }
-  return ret;
+    return dz*dz<300*300 && !w.isLocked();
+    });
   }
 
 void WayMatrix::addFreePoint(const Vec3& pos, const Vec3& dir, const char *name) {
@@ -173,8 +188,11 @@ void WayMatrix::marchPoints(Tempest::Painter &p, const Tempest::Matrix4x4 &mvp,
   }
 
 void WayMatrix::adjustWaypoints(std::vector<WayPoint> &wp) {
+  // no physics: waynet is used as is (headless tools)
+  auto* phys = world.physic();
   for(auto& w:wp) {
-    w.y = world.physic()->dropRay(w.x,w.y,w.z).y();
+    if(phys!=nullptr)
+      w.y = phys->dropRay(w.x,w.y,w.z).y();
     indexPoints.push_back(&w);
     }
   }
@@ -189,15 +207,13 @@ const WayMatrix::FpIndex &WayMatrix::findFpIndex(const char *name) const {
 
   FpIndex id;
   id.key = name;
+  std::vector<const WayPoint*> pt;
   for(auto& w:freePoints){
     if(!w.checkName(name))
       continue;
-    id.index.push_back(&w);
+    pt.push_back(&w);
     }
-  // TODO: good index, not sort by 'x' :)
-  std::sort(id.index.begin(),id.index.end(),[](const WayPoint* a,const WayPoint* b){
-    return a->x<b->x;
-    });
+  id.index.build(std::move(pt));
 
   it = fpIndex.insert(it,std::move(id));
   return *it;
@@ -206,30 +222,10 @@ const WayMatrix::FpIndex &WayMatrix::findFpIndex(const char *name) const {
 const WayPoint *WayMatrix::findFreePoint(float x, float y, float z, const FpIndex& ind, const WayPoint *ex) const {
   // float R = 20.f*100.f; // see scripting doc
   float R = 5.f*100.f; // scripting doc says 20m, but number seems to be incorrect
-  auto b = std::lower_bound(ind.index.begin(),ind.index.end(), x-R ,[](const WayPoint *a, float b){
-    return a->x<b;
-    });
-  auto e = std::upper_bound(ind.index.begin(),ind.index.end(), x+R ,[](float a,const WayPoint *b){
-    return a<b->x;
-    });
-
-  const WayPoint *ret=nullptr;
-  auto  count = std::distance(b,e);(void) count;
-  float dist  = R*R;
-  for(auto i=b;i!=e;++i){
-    auto& w  = **i;
-    if(w.isLocked() || &w==ex)
-      continue;
-    float dx = w.x-x;
-    float dy = w.y-y;
+  return ind.index.findNearest(x,y,z,R,[z,ex](const WayPoint& w){
     float dz = w.z-z;
-    float l=dx*dx+dy*dy+dz*dz;
-    if(l<dist && dz*dz<300*300){
-      ret  = &w;
-      dist = l;
-      }
-    }
-  return ret;
+    return dz*dz<300*300 && !w.isLocked() && &w!=ex;
+    });
   }
 
 WayPath WayMatrix::wayTo(float npcX, float npcY, float npcZ, const WayPoint &end) const {
@@ -248,8 +244,8 @@ WayPath WayMatrix::wayTo(float npcX, float npcY, float npcZ, const WayPoint &end
   }
 
 WayPath WayMatrix::wayTo(const WayPoint& start, const WayPoint &end) const {
-  intptr_t endId = std::distance<const WayPoint*>(&wayPoints[0],&end);
-  if(endId<0 || size_t(endId)>=wayPoints.size()){
+  const uint32_t endId = pointId(end);
+  if(endId>=wayPoints.size()){
     if(end.name.find("FP_")==0) {
       WayPath ret;
       ret.add(end);
@@ -258,57 +254,115 @@ WayPath WayMatrix::wayTo(const WayPoint& start, const WayPoint &end) const {
     return WayPath();
     }
 
-  pathGen++;
-  if(pathGen==1){
-    // new cycle
-    for(auto& i:wayPoints)
-      i.pathGen=0;
+  if(&start==&end) {
+    WayPath ret;
+    ret.add(end);
+    return ret;
     }
-  start.pathLen = 0;
-  start.pathGen = pathGen;
-
-  std::vector<const WayPoint*> *front=&stk[0], *back=&stk[1];
-  stk[0].clear();
-  stk[1].clear();
-
-  front->push_back(&start);
-
-  while(end.pathGen!=pathGen && front->size()>0){
-    for(auto& wp:*front){
-      int32_t l0 = wp->pathLen;
-
-      for(auto i:wp->connections()){
-        auto& w  = *i.point;
-        int32_t l1 = l0+i.len;
-        if(w.pathGen!=pathGen || w.pathLen>l1){
-          w.pathLen = l1;
-          w.pathGen = pathGen;
-          back->push_back(&w);
-          }
-        }
+
+  const uint32_t startId = pointId(start);
+  if(startId>=wayPoints.size())
+    return WayPath();
+
+  const PathKey key = {startId,endId};
+  WayPath       ret;
+  if(cachedPath(key,ret))
+    return ret;
+  if(!findPath(startId,endId,ret))
+    return WayPath();
+  cachePath(key,ret);
+  return ret;
+  }
+
+uint32_t WayMatrix::pointId(const WayPoint& p) const {
+  intptr_t id = std::distance<const WayPoint*>(wayPoints.data(),&p);
+  if(id<0 || size_t(id)>=wayPoints.size())
+    return uint32_t(-1);
+  return uint32_t(id);
+  }
+
+bool WayMatrix::findPath(uint32_t start, uint32_t end, WayPath& out) const {
+  // A* over the waynet
+  auto& s    = pathScratch;
+  auto& dest = wayPoints[end];
+  auto  cmp  = [](const PathScratch::Open& a, const PathScratch::Open& b){
+    return a.f>b.f;
+    };
+
+  s.begin(wayPoints.size());
+  s.gen   [start] = s.curGen;
+  s.len   [start] = 0;
+  s.parent[start] = start;
+  s.open.push_back({0.f,0,start});
+
+  bool found = false;
+  while(s.open.size()>0) {
+    std::pop_heap(s.open.begin(),s.open.end(),cmp);
+    const PathScratch::Open top = s.open.back();
+    s.open.pop_back();
+
+    const uint32_t id  = top.id;
+    auto&          wp  = wayPoints[id];
+    const int32_t  l0  = s.len[id];
+    if(top.g!=l0)
+      continue; // outdated entry: shorter path was found after push
+    if(id==end) {
+      found = true;
+      break;
       }
-    std::swap(front,back);
-    back->clear();
-    }
 
-  WayPath ret;
-  ret.add(end);
-  const WayPoint* current = &end;
-  while(current!=&start){
-    int32_t l0 = current->pathLen, l1=l0;
-
-    const WayPoint* next=nullptr;
-    for(auto i:current->connections()){
-      if(i.point->pathGen==pathGen && i.point->pathLen+i.len<=l0 && i.point->pathLen<l1){
-        next = i.point;
-        l1   = i.point->pathLen;
-        }
+    for(auto& i:wp.connections()) {
+      const uint32_t nId = uint32_t(std::distance<const WayPoint*>(wayPoints.data(),i.point));
+      const int32_t  l1  = l0+i.len;
+      if(s.isVisited(nId) && s.len[nId]<=l1)
+        continue;
+      s.gen   [nId] = s.curGen;
+      s.len   [nId] = l1;
+      s.parent[nId] = id;
+
+      auto& w = *i.point;
+      float h = heuristicScale*std::sqrt(w.qDistTo(dest.x,dest.y,dest.z));
+      s.open.push_back({float(l1)+h,l1,nId});
+      std::push_heap(s.open.begin(),s.open.end(),cmp);
       }
-    if(next==nullptr)
-      return WayPath();
-    ret.add(*next);
-    current=next;
     }
 
-  return ret;
+  if(!found)
+    return false;
+
+  out.clear();
+  for(uint32_t i=end; ; i=s.parent[i]) {
+    out.add(wayPoints[i]);
+    if(i==start)
+      break;
+    }
+  return true;
+  }
+
+bool WayMatrix::cachedPath(const PathKey& k, WayPath& out) const {
+  std::lock_guard<std::mutex> guard(pathSync);
+  auto it = pathCache.find(k);
+  if(it==pathCache.end())
+    return false;
+  pathLru.splice(pathLru.begin(),pathLru,it->second);
+  out = it->second->second;
+  return true;
+  }
+
+void WayMatrix::cachePath(const PathKey& k, const WayPath& p) const {
+  std::lock_guard<std::mutex> guard(pathSync);
+  if(pathCache.find(k)!=pathCache.end())
+    return;
+  pathLru.emplace_front(k,p);
+  pathCache[k] = pathLru.begin();
+  if(pathLru.size()>PathCacheSize) {
+    pathCache.erase(pathLru.back().first);
+    pathLru.pop_back();
+    }
+  }
+
+void WayMatrix::clearPathCache() {
+  std::lock_guard<std::mutex> guard(pathSync);
+  pathLru.clear();
+  pathCache.clear();
   }
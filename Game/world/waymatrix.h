@@ -4,10 +4,14 @@
 #include <Tempest/Matrix4x4>
 
 #include <zenload/zTypes.h>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include "waypath.h"
 #include "waypoint.h"
+#include "waypointindex.h"
 
 class World;
 
@@ -42,19 +46,36 @@ class WayMatrix final {
     std::vector<WayPoint>  freePoints, startPoints;
     std::vector<WayPoint*> indexPoints;
 
-    std::vector<WayPoint*> fpInd;
+    WayPointIndex          wpIndex;  // connected waynet
+    WayPointIndex          allIndex; // waynet + free points + start points
 
     struct FpIndex {
       std::string                  key;
-      std::vector<const WayPoint*> index;
+      WayPointIndex                index;
       };
     mutable std::vector<FpIndex>          fpIndex;
 
-    mutable uint16_t                      pathGen=0;
-    mutable std::vector<const WayPoint*>  stk[2];
+    // edge lengths are truncated to int: heuristic is scaled down to stay admissible
+    float                                 heuristicScale=1.f;
+
+    using PathKey = std::pair<uint32_t,uint32_t>;
+    struct PathKeyHash {
+      size_t operator()(const PathKey& k) const { return std::hash<uint64_t>()((uint64_t(k.first)<<32) | k.second); }
+      };
+    using PathLru = std::list<std::pair<PathKey,WayPath>>;
+    static const size_t                   PathCacheSize = 512;
+    mutable std::mutex                    pathSync;
+    mutable PathLru                       pathLru;
+    mutable std::unordered_map<PathKey,PathLru::iterator,PathKeyHash> pathCache;
 
     void                   adjustWaypoints(std::vector<WayPoint> &wp);
 
+    uint32_t               pointId(const WayPoint& p) const;
+    bool                   findPath(uint32_t start, uint32_t end, WayPath& out) const;
+    bool                   cachedPath(const PathKey& k, WayPath& out) const;
+    void                   cachePath (const PathKey& k, const WayPath& p) const;
+    void                   clearPathCache();
+
     const FpIndex&         findFpIndex(const char* name) const;
     const WayPoint*        findFreePoint(float x, float y, float z, const FpIndex &ind, const WayPoint* ex) const;
   };
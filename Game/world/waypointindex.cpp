@@ -0,0 +1,101 @@
+#include "waypointindex.h"
+
+#include <algorithm>
+
+#include "waypoint.h"
+
+void WayPointIndex::build(std::vector<const WayPoint*> pt) {
+  index = std::move(pt);
+  build(index.data(),index.size(),0);
+  }
+
+void WayPointIndex::clear() {
+  index.clear();
+  }
+
+void WayPointIndex::build(const WayPoint** v, size_t cnt, uint8_t depth) {
+  if(cnt<=1)
+    return;
+  depth%=3;
+  const size_t mid = cnt/2;
+  std::nth_element(v,v+mid,v+cnt,[depth](const WayPoint* a, const WayPoint* b){
+    return component(*a,depth)<component(*b,depth);
+    });
+  build(v,mid,uint8_t(depth+1u));
+  build(v+mid+1,cnt-mid-1,uint8_t(depth+1u));
+  }
+
+const WayPoint* WayPointIndex::implFindNearest(float x, float y, float z, float R,
+                                               void* ctx, bool (*pred)(void*,const WayPoint&)) const {
+  Query q;
+  q.x    = x;
+  q.y    = y;
+  q.z    = z;
+  q.dist = R*R;
+  q.ctx  = ctx;
+  q.pred = pred;
+  implFindNearest(index.data(),index.size(),0,q);
+  return q.ret;
+  }
+
+void WayPointIndex::implFindNearest(const WayPoint*const* v, size_t cnt, uint8_t depth, Query& q) const {
+  if(cnt==0)
+    return;
+
+  depth%=3;
+  const size_t mid = cnt/2;
+  auto&        w   = *v[mid];
+  const float  l   = w.qDistTo(q.x,q.y,q.z);
+  if(l<q.dist && (q.pred==nullptr || q.pred(q.ctx,w))) {
+    q.dist = l;
+    q.ret  = &w;
+    }
+
+  const float d = (depth==0 ? q.x : (depth==1 ? q.y : q.z)) - component(w,depth);
+  // closer half first: shrinks search radius faster
+  if(d<0) {
+    implFindNearest(v,mid,uint8_t(depth+1u),q);
+    if(d*d<q.dist)
+      implFindNearest(v+mid+1,cnt-mid-1,uint8_t(depth+1u),q);
+    } else {
+    implFindNearest(v+mid+1,cnt-mid-1,uint8_t(depth+1u),q);
+    if(d*d<q.dist)
+      implFindNearest(v,mid,uint8_t(depth+1u),q);
+    }
+  }
+
+void WayPointIndex::implFind(float x, float y, float z, float R, void* ctx, void (*func)(void*,const WayPoint&)) const {
+  Query q;
+  q.x    = x;
+  q.y    = y;
+  q.z    = z;
+  q.dist = R*R;
+  q.ctx  = ctx;
+  q.func = func;
+  implFind(index.data(),index.size(),0,q);
+  }
+
+void WayPointIndex::implFind(const WayPoint*const* v, size_t cnt, uint8_t depth, Query& q) const {
+  if(cnt==0)
+    return;
+
+  depth%=3;
+  const size_t mid = cnt/2;
+  auto&        w   = *v[mid];
+  if(w.qDistTo(q.x,q.y,q.z)<=q.dist)
+    q.func(q.ctx,w);
+
+  const float d = (depth==0 ? q.x : (depth==1 ? q.y : q.z)) - component(w,depth);
+  if(d<=0 || d*d<=q.dist)
+    implFind(v,mid,uint8_t(depth+1u),q);
+  if(d>=0 || d*d<=q.dist)
+    implFind(v+mid+1,cnt-mid-1,uint8_t(depth+1u),q);
+  }
+
+float WayPointIndex::component(const WayPoint& w, uint8_t depth) {
+  switch(depth) {
+    case 0:  return w.x;
+    case 1:  return w.y;
+    default: return w.z;
+    }
+  }
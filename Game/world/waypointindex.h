@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+class WayPoint;
+
+// static kd-tree over way/free points
+class WayPointIndex final {
+  public:
+    WayPointIndex() = default;
+
+    void   build(std::vector<const WayPoint*> pt);
+    void   clear();
+    size_t size() const { return index.size(); }
+
+    template<class Pred>
+    const WayPoint* findNearest(float x, float y, float z, float R, Pred p) const {
+      return implFindNearest(x,y,z,R,&p,[](void* ctx, const WayPoint& w){
+        auto& p = *reinterpret_cast<Pred*>(ctx);
+        return bool(p(w));
+        });
+      }
+
+    const WayPoint* findNearest(float x, float y, float z, float R) const {
+      return implFindNearest(x,y,z,R,nullptr,nullptr);
+      }
+
+    template<class Func>
+    void find(float x, float y, float z, float R, Func f) const {
+      implFind(x,y,z,R,&f,[](void* ctx, const WayPoint& w){
+        auto& f = *reinterpret_cast<Func*>(ctx);
+        f(w);
+        });
+      }
+
+  private:
+    struct Query {
+      float             x=0, y=0, z=0;
+      float             dist=0;
+      const WayPoint*   ret=nullptr;
+      void*             ctx=nullptr;
+      bool            (*pred)(void*,const WayPoint&)=nullptr;
+      void            (*func)(void*,const WayPoint&)=nullptr;
+      };
+
+    std::vector<const WayPoint*> index;
+
+    void            build(const WayPoint** v, size_t cnt, uint8_t depth);
+    const WayPoint* implFindNearest(float x, float y, float z, float R, void* ctx, bool (*pred)(void*,const WayPoint&)) const;
+    void            implFindNearest(const WayPoint*const* v, size_t cnt, uint8_t depth, Query& q) const;
+    void            implFind(float x, float y, float z, float R, void* ctx, void (*func)(void*,const WayPoint&)) const;
+    void            implFind(const WayPoint*const* v, size_t cnt, uint8_t depth, Query& q) const;
+
+    static float    component(const WayPoint& w, uint8_t depth);
+  };
@@ -4,58 +4,48 @@
 #include <fstream>
 #include <functional>
 #include <cctype>
+#include <algorithm>
+#include <atomic>
 
 #include <Tempest/Log>
 #include <Tempest/Painter>
 
 #include "gothic.h"
 #include "focus.h"
+#include "worldcache.h"
 #include "resources.h"
 #include "game/serialize.h"
 #include "graphics/submesh/packedmesh.h"
 #include "graphics/visualfx.h"
 #include "graphics/skeleton.h"
+#include "utils/fileext.h"
+#include "utils/workers.h"
 
 using namespace Tempest;
 
+static void collectVisuals(const ZenLoad::zCVobData& vob, std::vector<std::string>& out) {
+  if(vob.showVisual && !vob.visual.empty() &&
+     !FileExt::hasExt(vob.visual,"PFX") && !FileExt::hasExt(vob.visual,"TGA"))
+    out.push_back(vob.visual);
+  for(auto& i:vob.childVobs)
+    collectVisuals(i,out);
+  }
+
 World::World(Gothic& gothic, GameSession& game,const RendererStorage &storage, std::string file, uint8_t isG2, std::function<void(int)> loadProgress)
   :wname(std::move(file)),game(game),wsound(gothic,game,*this),wobj(*this) {
-  using namespace Daedalus::GameState;
-
-  ZenLoad::ZenParser parser(wname,Resources::vdfsIndex());
-
-  loadProgress(1);
-  parser.readHeader();
-
-  loadProgress(10);
-  ZenLoad::oCWorldData world;
-  parser.readWorld(world,isG2==2);
-
-  ZenLoad::zCMesh* worldMesh = parser.getWorldMesh();
-  PackedMesh vmesh(*worldMesh,PackedMesh::PK_VisualLnd);
-
-  loadProgress(50);
-  wdynamic.reset(new DynamicWorld(*this,*worldMesh));
-  wview.reset   (new WorldView(*this,vmesh,storage));
-  loadProgress(70);
-
-  wmatrix.reset(new WayMatrix(*this,world.waynet));
-  if(1){
-    for(auto& vob:world.rootVobs)
-      wobj.addRoot(std::move(vob),true);
-    }
-  wmatrix->buildIndex();
-  bsp = std::move(world.bspTree);
-  bspSectors.resize(bsp.sectors.size());
-  loadProgress(100);
+  implLoad(storage,isG2,true,loadProgress);
   }
 
 World::World(Gothic& gothic, GameSession &game, const RendererStorage &storage,
              Serialize &fin, uint8_t isG2, std::function<void(int)> loadProgress)
   :wname(fin.read<std::string>()),game(game),wsound(gothic,game,*this),wobj(*this) {
-  using namespace Daedalus::GameState;
+  implLoad(storage,isG2,false,loadProgress);
+  }
 
-  ZenLoad::ZenParser parser(wname,Resources::vdfsIndex());
+void World::implLoad(const RendererStorage& storage, uint8_t isG2, bool startup, const std::function<void(int)>& loadProgress) {
+  // archive is accessed under resources lock; parsing is done in memory
+  std::vector<uint8_t> data = Resources::getFileData(wname);
+  ZenLoad::ZenParser   parser(data.data(),data.size());
 
   loadProgress(1);
   parser.readHeader();
@@ -63,24 +53,66 @@ World::World(Gothic& gothic, GameSession &game, const RendererStorage &storage,
   loadProgress(10);
   ZenLoad::oCWorldData world;
   parser.readWorld(world,isG2==2);
-
   ZenLoad::zCMesh* worldMesh = parser.getWorldMesh();
-  PackedMesh vmesh(*worldMesh,PackedMesh::PK_VisualLnd);
 
-  loadProgress(50);
-  wdynamic.reset(new DynamicWorld(*this,*worldMesh));
-  wview.reset   (new WorldView(*this,vmesh,storage));
-  loadProgress(70);
+  loadProgress(20);
+  std::atomic_int progress{20};
+  auto step = [&](int weight) {
+    loadProgress(progress.fetch_add(weight)+weight);
+    };
 
-  wmatrix.reset(new WayMatrix(*this,world.waynet));
-  if(1){
-    for(auto& vob:world.rootVobs)
-      wobj.addRoot(std::move(vob),false);
+  PackedMesh               vmesh;
+  std::vector<std::string> visuals;
+  Workers::TaskGraph       load;
+
+  auto visual = load.add([&](){
+    WorldCache cache(wname,"lnd");
+    vmesh = cache.packedMesh(*worldMesh,PackedMesh::PK_VisualLnd);
+    cache.flush();
+    step(10);
+    });
+  load.add([&](){
+    wdynamic.reset(new DynamicWorld(*this,*worldMesh));
+    step(15);
+    });
+  load.add([&](){
+    wmatrix.reset(new WayMatrix(*this,world.waynet));
+    initBsp(std::move(world.bspTree));
+    step(5);
+    });
+  auto prefetch = load.add([&](){
+    // warm up resource cache, before vobs are created
+    for(auto& i:world.rootVobs)
+      collectVisuals(i,visuals);
+    std::sort(visuals.begin(),visuals.end());
+    visuals.erase(std::unique(visuals.begin(),visuals.end()),visuals.end());
+    std::vector<std::shared_future<const ProtoMesh*>> meshes;
+    for(auto& i:visuals)
+      meshes.push_back(Resources::loadMeshAsync(i));
+    Workers::parallelFor(visuals,[](std::string& name){
+      Resources::loadSkeleton(name.c_str());
+      });
+    for(auto& i:meshes)
+      Workers::wait([&i](){ return i.wait_for(std::chrono::seconds(0))==std::future_status::ready; });
+    step(15);
+    });
+  // gpu objects are created by one stage at time
+  load.add([&](){
+    wview.reset(new WorldView(*this,vmesh,storage));
+    step(5);
+    },{visual,prefetch});
+  load.run();
+
+  // vobs are not thread-safe: instantiated in sequence, in batches to report progress
+  const size_t batch = 256;
+  const size_t count = world.rootVobs.size();
+  for(size_t i=0; i<count; ++i) {
+    wobj.addRoot(std::move(world.rootVobs[i]),startup);
+    if((i+1)%batch==0)
+      loadProgress(70+int(25*(i+1)/count));
     }
+  loadProgress(95);
   wmatrix->buildIndex();
-  bsp = std::move(world.bspTree);
-  bspSectors.resize(bsp.sectors.size());
-
   loadProgress(100);
   }
 
@@ -164,6 +196,7 @@ MeshObjects::Mesh World::getView(const Daedalus::ZString& visual, int32_t headTe
   }
 
 MeshObjects::Mesh World::getView(const char* visual, int32_t headTex, int32_t teetTex, int32_t bodyColor) const {
+  // visual, that was not prefetched on world load, is loaded synchronously here
   return view()->getView(visual,headTex,teetTex,bodyColor);
   }
 
@@ -229,13 +262,46 @@ Npc *World::findNpcByInstance(size_t instance) {
   return wobj.findNpcByInstance(instance);
   }
 
+void World::initBsp(ZenLoad::zCBspTreeData&& tree) {
+  bsp = std::move(tree);
+  bspSectors.resize(bsp.sectors.size());
+
+  bspSectorIndex.clear();
+  for(size_t i=0;i<bsp.sectors.size();++i)
+    bspSectorIndex.emplace(bsp.sectors[i].name,i);
+
+  // leaf -> sector; leaf referenced by more than one sector is a portal and has no room
+  bspLeafSector.assign(bsp.nodes.size(),-1);
+  std::vector<uint8_t> count(bsp.nodes.size(),0);
+  for(size_t i=0;i<bsp.sectors.size();++i) {
+    auto sector = int32_t(bspSectorIndex[bsp.sectors[i].name]);
+    for(auto r:bsp.sectors[i].bspNodeIndices) {
+      if(r>=bsp.leafIndices.size())
+        continue;
+      size_t idx = bsp.leafIndices[r];
+      if(idx>=bsp.nodes.size())
+        continue;
+      if(count[idx]<2)
+        count[idx]++;
+      bspLeafSector[idx] = count[idx]==1 ? sector : -1;
+      }
+    }
+  }
+
 const std::string& World::roomAt(const Tempest::Vec3& p) {
   static std::string empty;
+  auto id = sectorAt(p);
+  if(id<0)
+    return empty;
+  return bsp.sectors[size_t(id)].name;
+  }
 
+int32_t World::sectorAt(const Tempest::Vec3& p) const {
   if(bsp.nodes.empty())
-    return empty;
+    return -1;
 
   const ZenLoad::zCBspNode* node=&bsp.nodes[0];
+  uint32_t                  id  =0;
 
   while(true) {
     const float* v    = node->plane.v;
@@ -245,50 +311,26 @@ const std::string& World::roomAt(const Tempest::Vec3& p) {
       break;
 
     node = &bsp.nodes[next];
+    id   = next;
     }
 
   if(node->bbox3dMin.x <= p.x && p.x <node->bbox3dMax.x &&
      node->bbox3dMin.y <= p.y && p.y <node->bbox3dMax.y &&
      node->bbox3dMin.z <= p.z && p.z <node->bbox3dMax.z) {
-    return roomAt(*node);
+    return bspLeafSector[id];
     }
 
-  return empty;
-  }
-
-const std::string& World::roomAt(const ZenLoad::zCBspNode& node) {
-  std::string* ret=nullptr;
-  size_t       count=0;
-  auto         id = &node-bsp.nodes.data();(void)id;
-
-  for(auto& i:bsp.sectors) {
-    for(auto r:i.bspNodeIndices)
-      if(r<bsp.leafIndices.size()){
-        size_t idx = bsp.leafIndices[r];
-        if(idx>=bsp.nodes.size())
-          continue;
-        if(&bsp.nodes[idx]==&node) {
-          ret = &i.name;
-          count++;
-          }
-        }
-    }
-  if(count==1) {
-    // TODO: portals
-    return *ret;
-    }
-  static std::string empty;
-  return empty;
+  return -1;
   }
 
 World::BspSector* World::portalAt(const std::string &tag) {
   if(tag.empty())
     return nullptr;
 
-  for(size_t i=0;i<bsp.sectors.size();++i)
-    if(bsp.sectors[i].name==tag)
-      return &bspSectors[i];
-  return nullptr;
+  auto it = bspSectorIndex.find(tag);
+  if(it==bspSectorIndex.end())
+    return nullptr;
+  return &bspSectors[it->second];
   }
 
 void World::tick(uint64_t dt) {
@@ -862,10 +904,11 @@ void World::assignRoomToGuild(const char* r, int32_t guildId) {
   }
 
 int32_t World::guildOfRoom(const Tempest::Vec3& pos) {
-  const std::string& tg = roomAt(pos);
-  if(auto room=portalAt(tg)) {
-    if(room->guild==GIL_PUBLIC) //FIXME: proper portal implementation
-      return room->guild;
+  auto id = sectorAt(pos);
+  if(id>=0) {
+    auto& room = bspSectors[size_t(id)];
+    if(room.guild==GIL_PUBLIC) //FIXME: proper portal implementation
+      return room.guild;
     }
   return GIL_NONE;
   }
@@ -885,14 +928,8 @@ int32_t World::guildOfRoom(const char* portalName) {
     size = std::strlen(b); else
     size = size_t(std::distance(b,e));
 
-  for(size_t i=0;i<bsp.sectors.size();++i) {
-    auto& s = bsp.sectors[i].name;
-    if(s.size()!=size)
-      continue;
-
-    if(std::memcmp(s.c_str(),b,size)==0)
-      return bspSectors[i].guild;
-    }
+  if(auto room=portalAt(std::string(b,size)))
+    return room->guild;
   return GIL_NONE;
   }
 
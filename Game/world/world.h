@@ -4,6 +4,7 @@
 #include <Tempest/IndexBuffer>
 #include <Tempest/Matrix4x4>
 #include <string>
+#include <unordered_map>
 
 #include <daedalus/DaedalusVM.h>
 #include <zenload/zTypes.h>
@@ -107,6 +108,7 @@ class World final {
     Npc*                 player() const { return npcPlayer; }
     Npc*                 findNpcByInstance(size_t instance);
     auto                 roomAt(const Tempest::Vec3& arr) -> const std::string&;
+    int32_t              sectorAt(const Tempest::Vec3& arr) const;
 
     void                 tick(uint64_t dt);
     uint64_t             tickCount() const;
@@ -180,6 +182,8 @@ class World final {
     std::unique_ptr<WayMatrix>            wmatrix;
     ZenLoad::zCBspTreeData                bsp;
     std::vector<BspSector>                bspSectors;
+    std::vector<int32_t>                  bspLeafSector;
+    std::unordered_map<std::string,size_t> bspSectorIndex;
 
     Npc*                                  npcPlayer=nullptr;
 
@@ -189,7 +193,8 @@ class World final {
     WorldObjects                          wobj;
     std::unique_ptr<Npc>                  lvlInspector;
 
-    auto         roomAt(const ZenLoad::zCBspNode &node) -> const std::string &;
+    void         implLoad(const RendererStorage& storage, uint8_t isG2, bool startup, const std::function<void(int)>& loadProgress);
+    void         initBsp(ZenLoad::zCBspTreeData&& tree);
     auto         portalAt(const std::string& tag) -> BspSector*;
 
     void         initScripts(bool firstTime);
@@ -0,0 +1,212 @@
+#include "worldcache.h"
+
+#include <Tempest/Application>
+#include <Tempest/File>
+#include <Tempest/Log>
+#include <Tempest/TextCodec>
+
+#include <cctype>
+#include <cstring>
+
+#include "utils/fileutil.h"
+#include "utils/mappedfile.h"
+#include "resources.h"
+
+using namespace Tempest;
+
+static const char     magic[4] = {'O','G','W','C'};
+static const size_t   Align    = 16;
+
+static uint64_t fnv1a(uint64_t h, const void* data, size_t sz) {
+  auto d = reinterpret_cast<const uint8_t*>(data);
+  for(size_t i=0; i<sz; ++i)
+    h = (h^d[i])*1099511628211ull;
+  return h;
+  }
+
+WorldCache::WorldCache(const std::string& world, const char* kind)
+  :name(world) {
+  std::string fname = world;
+  for(auto& c:fname)
+    c = char(std::tolower(c));
+  fname += ".";
+  fname += kind;
+
+  const uint32_t ptrSz = sizeof(void*);
+  key  = Resources::vdfsKey();
+  key  = fnv1a(key,fname.data(),fname.size());
+  key  = fnv1a(key,&ptrSz,sizeof(ptrSz));
+  path = u"cache/" + TextCodec::toUtf16(fname);
+
+  file.reset(new MappedFile(path));
+  Header hdr = {};
+  if(file->isOpen() && file->size()>=sizeof(hdr)) {
+    std::memcpy(&hdr,file->data(),sizeof(hdr));
+    if(std::memcmp(hdr.magic,magic,sizeof(magic))==0 && hdr.version==Version &&
+       hdr.key==key && hdr.size==file->size()) {
+      mode = M_Read;
+      at   = sizeof(hdr);
+      return;
+      }
+    }
+  file.reset();
+  out.resize(sizeof(hdr));
+  }
+
+WorldCache::~WorldCache() {
+  }
+
+PackedMesh WorldCache::packedMesh(const ZenLoad::zCMesh& mesh, PackedMesh::PkgType type) {
+  const uint64_t t0 = Application::tickCount();
+  if(mode==M_Read) {
+    PackedMesh ret;
+    if(readMesh(ret,mesh,type)) {
+      Log::i("world cache[",name,"]: mesh loaded in ",int(Application::tickCount()-t0),"ms");
+      return ret;
+      }
+    fail();
+    }
+
+  PackedMesh ret(mesh,type);
+  Log::i("world cache[",name,"]: mesh packed in ",int(Application::tickCount()-t0),"ms");
+  if(mode==M_Write)
+    writeMesh(ret,type);
+  return ret;
+  }
+
+uint8_t* WorldCache::readBlob(size_t& size) {
+  size = 0;
+  if(mode!=M_Read)
+    return nullptr;
+  uint64_t sz = 0;
+  if(!get(sz)) {
+    fail();
+    return nullptr;
+    }
+  at = (at+Align-1)/Align*Align;
+  if(at>file->size() || file->size()-at<sz) {
+    fail();
+    return nullptr;
+    }
+  uint8_t* ret = file->data()+at;
+  at  += size_t(sz);
+  size = size_t(sz);
+  return ret;
+  }
+
+void WorldCache::writeBlob(const void* data, size_t size) {
+  if(mode!=M_Write)
+    return;
+  put(uint64_t(size));
+  align();
+  put(data,size);
+  }
+
+void WorldCache::flush() {
+  if(mode!=M_Write)
+    return;
+
+  Header hdr = {};
+  std::memcpy(hdr.magic,magic,sizeof(magic));
+  hdr.version = Version;
+  hdr.key     = key;
+  hdr.size    = out.size();
+  std::memcpy(out.data(),&hdr,sizeof(hdr));
+
+  try {
+    FileUtil::createDirectory(u"cache");
+    WFile f(path);
+    f.write(out.data(),out.size());
+    }
+  catch(...) {
+    Log::e("unable to write world cache: \"",TextCodec::toUtf8(path),"\"");
+    }
+  out.clear();
+  out.shrink_to_fit();
+  mode = M_Failed;
+  }
+
+bool WorldCache::readMesh(PackedMesh& ret, const ZenLoad::zCMesh& mesh, PackedMesh::PkgType type) {
+  uint32_t t = 0, vcount = 0, scount = 0;
+  if(!get(t) || t!=uint32_t(type))
+    return false;
+
+  if(!get(vcount))
+    return false;
+  ret.vertices.resize(vcount);
+  if(!get(ret.vertices.data(),vcount*sizeof(ret.vertices[0])))
+    return false;
+
+  auto& mat = mesh.getMaterials();
+  if(!get(scount))
+    return false;
+  ret.subMeshes.resize(scount);
+  for(auto& sm:ret.subMeshes) {
+    uint32_t nlen = 0, icount = 0;
+    uint8_t  group = 0, noColl = 0;
+    if(!get(sm.materialId) || !get(group) || !get(noColl) || !get(nlen))
+      return false;
+    if(sm.materialId!=uint32_t(-1)) {
+      if(sm.materialId>=mat.size())
+        return false;
+      sm.material = mat[sm.materialId];
+      }
+    sm.material.matName.resize(nlen);
+    if(!get(&sm.material.matName[0],nlen))
+      return false;
+    sm.material.matGroup  = group;
+    sm.material.noCollDet = (noColl!=0);
+
+    if(!get(icount))
+      return false;
+    sm.indices.resize(icount);
+    if(!get(sm.indices.data(),icount*sizeof(uint32_t)))
+      return false;
+    }
+
+  mesh.getBoundingBox(ret.bbox[0],ret.bbox[1]);
+  return true;
+  }
+
+void WorldCache::writeMesh(const PackedMesh& m, PackedMesh::PkgType type) {
+  put(uint32_t(type));
+  put(uint32_t(m.vertices.size()));
+  put(m.vertices.data(),m.vertices.size()*sizeof(m.vertices[0]));
+
+  put(uint32_t(m.subMeshes.size()));
+  for(auto& sm:m.subMeshes) {
+    put(sm.materialId);
+    put(uint8_t(sm.material.matGroup));
+    put(uint8_t(sm.material.noCollDet ? 1 : 0));
+    put(uint32_t(sm.material.matName.size()));
+    put(sm.material.matName.data(),sm.material.matName.size());
+    put(uint32_t(sm.indices.size()));
+    put(sm.indices.data(),sm.indices.size()*sizeof(uint32_t));
+    }
+  }
+
+bool WorldCache::get(void* data, size_t size) {
+  if(file->size()-at<size)
+    return false;
+  if(size>0)
+    std::memcpy(data,file->data()+at,size);
+  at += size;
+  return true;
+  }
+
+void WorldCache::put(const void* data, size_t size) {
+  if(size==0)
+    return;
+  auto d = reinterpret_cast<const uint8_t*>(data);
+  out.insert(out.end(),d,d+size);
+  }
+
+void WorldCache::align() {
+  out.resize((out.size()+Align-1)/Align*Align);
+  }
+
+void WorldCache::fail() {
+  // keep mapping alive: blobs, that are already in use, are pointing into it
+  Log::e("world cache is corrupted: \"",TextCodec::toUtf8(path),"\"");
+  mode = M_Failed;
+  }
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "graphics/submesh/packedmesh.h"
+
+class MappedFile;
+
+// Baked world data, stored on disk between runs.
+// Cache is keyed by world name and timestamps of game archives; items are read back in the same order, as written.
+class WorldCache final {
+  public:
+    WorldCache(const std::string& world, const char* kind);
+    WorldCache(const WorldCache&)=delete;
+    ~WorldCache();
+
+    enum {
+      Version = 1
+      };
+
+    bool       isLoaded() const { return mode==M_Read; }
+
+    // packed mesh from cache, or packed from scratch and stored
+    PackedMesh packedMesh(const ZenLoad::zCMesh& mesh, PackedMesh::PkgType type);
+
+    // returns 16-byte aligned, writable memory, that is valid for lifetime of cache object; nullptr on cache miss
+    uint8_t*   readBlob(size_t& size);
+    void       writeBlob(const void* data, size_t size);
+
+    // write cache file, if content was not loaded from disk
+    void       flush();
+
+  private:
+    struct Header {
+      char     magic[4];
+      uint32_t version;
+      uint64_t key;
+      uint64_t size;
+      };
+
+    enum Mode : uint8_t {
+      M_Read,
+      M_Write,
+      M_Failed
+      };
+
+    bool       readMesh (PackedMesh& out, const ZenLoad::zCMesh& mesh, PackedMesh::PkgType type);
+    void       writeMesh(const PackedMesh& m, PackedMesh::PkgType type);
+
+    bool       get(void* data, size_t size);
+    template<class T>
+    bool       get(T& t) { return get(&t,sizeof(t)); }
+    void       put(const void* data, size_t size);
+    template<class T>
+    void       put(const T& t) { put(&t,sizeof(t)); }
+    void       align();
+    void       fail();
+
+    std::string                 name;
+    std::u16string              path;
+    uint64_t                    key  = 0;
+    Mode                        mode = M_Write;
+
+    std::unique_ptr<MappedFile> file;
+    size_t                      at   = 0;
+    std::vector<uint8_t>        out;
+  };
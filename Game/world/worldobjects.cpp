@@ -13,11 +13,14 @@
 #include "world/triggers/triggerworldstart.h"
 #include "world/triggers/messagefilter.h"
 #include "world/vob.h"
+#include "graphics/dynamic/frustrum.h"
 
 #include <Tempest/Painter>
 #include <Tempest/Application>
 #include <Tempest/Log>
 
+#include <cmath>
+
 using namespace Tempest;
 using namespace Daedalus::GameState;
 
@@ -130,8 +133,17 @@ void WorldObjects::tick(uint64_t dt) {
   auto passive=std::move(sndPerc);
   sndPerc.clear();
 
-  std::sort(npcArr.begin(),npcArr.end(),[](std::unique_ptr<Npc>& a, std::unique_ptr<Npc>& b){
+  auto byId = [](const std::unique_ptr<Npc>& a, const std::unique_ptr<Npc>& b){
     return a->handle()->id<b->handle()->id;
+    };
+  if(!std::is_sorted(npcArr.begin(),npcArr.end(),byId))
+    std::sort(npcArr.begin(),npcArr.end(),byId);
+
+  // animation events and movement probes are independent per npc;
+  // script/ai part runs serially, in order of instance id, to keep behavior reproducible
+  owner.physic()->updateAabbs();
+  Workers::parallelFor(npcArr,[dt](std::unique_ptr<Npc>& i){
+    i->preTick(dt);
     });
   for(size_t i=0; i<npcArr.size(); ++i)
     npcArr[i]->tick(dt);
@@ -178,30 +190,20 @@ void WorldObjects::tick(uint64_t dt) {
     }
   tickNear(dt);
   tickTriggers(dt);
+  collectPassivePerc(passive);
 
-  for(auto& ptr:npcArr) {
-    Npc& i = *ptr;
+  for(size_t id=0; id<npcArr.size(); ++id) {
+    Npc& i = *npcArr[id];
     if(i.isPlayer())
       continue;
 
-    if(i.processPolicy()==Npc::AiNormal) {
-      for(auto& r:passive) {
-        if(r.self==&i)
-          continue;
-        float l = i.qDistTo(r.pos.x,r.pos.y,r.pos.z);
-        if(r.item!=size_t(-1) && r.other!=nullptr)
-          owner.script().setInstanceItem(*r.other,r.item);
-        const float range = float(i.handle()->senses_range);
-        if(l<range*range) {
-          // aproximation of behavior of original G2
-          if(!i.isDown() && !i.isPlayer() &&
-             i.canSenseNpc(*r.other, true)!=SensesBit::SENSE_NONE &&
-             i.canSenseNpc(*r.victum,true,float(r.other->handle()->senses_range))!=SensesBit::SENSE_NONE
-            ) {
-            i.perceptionProcess(*r.other,r.victum,l,Npc::PercType(r.what));
-            }
-          }
-        }
+    // npcArr may grow, while scripts are running
+    for(size_t n=0; id<percHits.size() && n<percHits[id].size(); ++n) {
+      auto& h = percHits[id][n];
+      auto& r = passive[h.msg];
+      if(r.item!=size_t(-1) && r.other!=nullptr)
+        owner.script().setInstanceItem(*r.other,r.item);
+      i.perceptionProcess(*r.other,r.victum,h.dist,Npc::PercType(r.what));
       }
 
     if(i.percNextTime()>owner.tickCount())
@@ -210,6 +212,87 @@ void WorldObjects::tick(uint64_t dt) {
     }
   }
 
+void WorldObjects::collectPassivePerc(const std::vector<PerceptionMsg>& passive) {
+  // messages are bucketed, so npc only visits messages in it's senses_range;
+  // sense tests(raycasts) don't touch script and run on workers
+  static const float cellSize = 1000.f;
+  auto coord = [](float v) {
+    return int32_t(std::floor(v/cellSize));
+    };
+  auto key = [](int32_t x, int32_t z) {
+    return (uint64_t(uint32_t(x))<<32) | uint64_t(uint32_t(z));
+    };
+
+  percHits.resize(npcArr.size());
+  for(auto& i:percHits)
+    i.clear();
+  percGrid.clear();
+
+  percStats            = PerceptionStats();
+  percStats.messages   = uint32_t(passive.size());
+  if(passive.size()==0)
+    return;
+
+  for(size_t i=0; i<passive.size(); ++i)
+    percGrid[key(coord(passive[i].pos.x),coord(passive[i].pos.z))].push_back(uint32_t(i));
+
+  std::atomic<uint32_t> candidates{0}, raycasts{0};
+  owner.physic()->updateAabbs();
+  Workers::parallelFor(npcArr,[&](std::unique_ptr<Npc>& ptr){
+    Npc& i = *ptr;
+    if(i.isPlayer() || i.processPolicy()!=Npc::AiNormal || i.isDown())
+      return;
+
+    static thread_local std::vector<uint32_t> cand;
+    cand.clear();
+
+    const auto    pos   = i.position();
+    const float   range = float(i.handle()->senses_range);
+    const int32_t x0    = coord(pos.x-range), x1 = coord(pos.x+range);
+    const int32_t z0    = coord(pos.z-range), z1 = coord(pos.z+range);
+    if(uint64_t(x1-x0+1)*uint64_t(z1-z0+1)>percGrid.size()) {
+      for(uint32_t r=0; r<passive.size(); ++r)
+        cand.push_back(r);
+      } else {
+      for(int32_t x=x0; x<=x1; ++x)
+        for(int32_t z=z0; z<=z1; ++z) {
+          auto c = percGrid.find(key(x,z));
+          if(c!=percGrid.end())
+            cand.insert(cand.end(),c->second.begin(),c->second.end());
+          }
+      // keep order of messages
+      std::sort(cand.begin(),cand.end());
+      }
+
+    auto&    hits = percHits[size_t(&ptr-npcArr.data())];
+    uint32_t rays = 0;
+    for(auto id:cand) {
+      auto& r = passive[id];
+      if(r.self==&i)
+        continue;
+      float l = i.qDistTo(r.pos.x,r.pos.y,r.pos.z);
+      if(l>=range*range)
+        continue;
+      // aproximation of behavior of original G2
+      rays++;
+      if(i.canSenseNpc(*r.other, true)==SensesBit::SENSE_NONE)
+        continue;
+      rays++;
+      if(i.canSenseNpc(*r.victum,true,float(r.other->handle()->senses_range))==SensesBit::SENSE_NONE)
+        continue;
+      PercHit h;
+      h.msg  = id;
+      h.dist = l;
+      hits.push_back(h);
+      }
+    candidates.fetch_add(uint32_t(cand.size()));
+    raycasts  .fetch_add(rays);
+    });
+
+  percStats.candidates = candidates.load();
+  percStats.raycasts   = raycasts.load();
+  }
+
 uint32_t WorldObjects::npcId(const Npc *ptr) const {
   if(ptr==nullptr)
     return uint32_t(-1);
@@ -334,13 +417,59 @@ void WorldObjects::execTriggerEvent(const TriggerEvent& e) {
     Log::d("unable to process trigger: \"",e.target,"\"");
   }
 
+static uint32_t animationRate(Npc::ProcessPolicy p, bool visible) {
+  // frames between skeleton updates
+  switch(p) {
+    case Npc::Player:   return 1;
+    case Npc::AiNormal: return visible ? 1 : 4;
+    case Npc::AiFar:    return visible ? 2 : 8;
+    case Npc::AiFar2:   return visible ? 4 : 16;
+    }
+  return 1;
+  }
+
+static uint32_t animationPhase(const void* obj) {
+  // objects are heap-allocated and 16-byte aligned: drop alignment bits and mix, so phases are spread evenly
+  const uint64_t v = uint64_t(reinterpret_cast<uintptr_t>(obj)>>4)*0x9E3779B97F4A7C15ull;
+  return uint32_t(v>>32);
+  }
+
 void WorldObjects::updateAnimation() {
-  Workers::parallelFor(npcArr,[](std::unique_ptr<Npc>& i){
-    i->updateAnimation();
+  // skeletons of far and offscreen objects are updated at reduced rate; frustum is from previous frame
+  Frustrum fr;
+  if(auto v = owner.view())
+    fr.make(v->viewProject()); else
+    fr.clear();
+  const uint32_t frame = animFrame++;
+
+  Tempest::Vec3 plPos;
+  const bool    hasPl = owner.player()!=nullptr;
+  if(hasPl)
+    plPos = owner.player()->position();
+
+  // npc and mob sets are independent: run them at once, so small set doesn't leave cores idle
+  Workers::TaskGraph g;
+  g.add([this,&fr,frame](){
+    Workers::parallelFor(npcArr,1,[this,&fr,frame](std::unique_ptr<Npc>& i){
+      auto     pos  = i->position();
+      bool     vis  = fr.testPoint(pos.x,pos.y+100.f,pos.z,150.f);
+      uint32_t rate = animationRate(i->processPolicy(),vis);
+      uint32_t id   = uint32_t(&i-npcArr.data());
+      i->updateAnimation((frame+id)%rate==0);
+      });
     });
-  interactiveObj.parallelFor([](Interactive& i){
-    i.updateAnimation();
+  g.add([this,&fr,&plPos,hasPl,frame](){
+    interactiveObj.parallelFor([&fr,&plPos,hasPl,frame](Interactive& i){
+      auto  pos  = i.position();
+      bool  vis  = fr.testPoint(pos.x,pos.y,pos.z,300.f);
+      float dist = hasPl ? (pos-plPos).quadLength() : 0.f;
+      auto  pol  = dist<3000.f*3000.f ? Npc::AiNormal : (dist<6000.f*6000.f ? Npc::AiFar : Npc::AiFar2);
+      uint32_t rate = animationRate(pol,vis);
+      uint32_t id   = animationPhase(&i);
+      i.updateAnimation((frame+id)%rate==0);
+      });
     });
+  g.run();
   }
 
 bool WorldObjects::isTargeted(Npc& dst) {
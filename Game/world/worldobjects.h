@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <memory>
+#include <unordered_map>
 
 #include <daedalus/DaedalusGameState.h>
 
@@ -33,6 +34,12 @@ class WorldObjects final {
       FcOverride=8,
       };
 
+    struct PerceptionStats final {
+      uint32_t messages   = 0;
+      uint32_t candidates = 0;
+      uint32_t raycasts   = 0;
+      };
+
     struct SearchOpt final {
       SearchOpt()=default;
       SearchOpt(float rangeMin, float rangeMax, float azi, TargetCollect collectAlgo=TARGET_COLLECT_CASTER, SearchFlg flags=NoFlg);
@@ -105,6 +112,7 @@ class WorldObjects final {
     void           sendPassivePerc(Npc& self,Npc& other,Npc& victum,int32_t perc);
     void           sendPassivePerc(Npc& self,Npc& other,Npc& victum,Item& itm,int32_t perc);
     void           resetPositionToTA();
+    auto           perceptionStats() const -> const PerceptionStats& { return percStats; }
 
   private:
     struct MobRoutine {
@@ -141,8 +149,17 @@ class WorldObjects final {
     std::vector<AbstractTrigger*>      triggersZn;
     std::vector<AbstractTrigger*>      triggersTk;
 
+    struct PercHit {
+      uint32_t msg  = 0;
+      float    dist = 0;
+      };
+
     std::vector<PerceptionMsg>         sndPerc;
+    std::vector<std::vector<PercHit>>  percHits;
+    std::unordered_map<uint64_t,std::vector<uint32_t>> percGrid;
+    PerceptionStats                    percStats;
     std::vector<TriggerEvent>          triggerEvents;
+    uint32_t                           animFrame = 0;
 
     template<class T>
     auto findObj(T &src, const Npc &pl, const SearchOpt& opt) -> typename std::remove_reference<decltype(src[0])>::type*;
@@ -156,5 +173,6 @@ class WorldObjects final {
 
     void             tickNear(uint64_t dt);
     void             tickTriggers(uint64_t dt);
+    void             collectPassivePerc(const std::vector<PerceptionMsg>& passive);
     static bool      isTargetedBy(Npc& npc,Npc& by);
   };
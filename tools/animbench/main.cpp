@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "graphics/animmath.h"
+
+// Keyframe blending benchmark and conformance check.
+//
+//   animbench [--bones N] [--loops N] [--seed N]
+//
+// mixSamples is compared bit-exact against scalar mkMatrix(mix(a,b,t)) for every bone:
+// over bone counts, that leave padded tail lanes, and over slerp lanes mixed into vector groups.
+
+using namespace Tempest;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// kind of quaternion pair, that selects branch of slerp
+enum Pair {
+  P_Near,    // dot>=0.95: nlerp, vector path
+  P_Far,     // dot<0.95: real slerp, scalar fallback
+  P_Flipped, // near, but b is negated: dot<0
+  P_Count
+  };
+
+struct Keyframes {
+  size_t             count  = 0;
+  size_t             stride = 0;
+  std::vector<float> a, b;
+  std::vector<ZenLoad::zCModelAniSample> sa, sb;
+  };
+
+static const char* arg(int argc, const char** argv, const char* name, const char* def) {
+  for(int i=0; i+1<argc; ++i)
+    if(std::strcmp(argv[i],name)==0)
+      return argv[i+1];
+  return def;
+  }
+
+static ZMath::float4 normalize(ZMath::float4 q) {
+  const float l = std::sqrt(q.x*q.x+q.y*q.y+q.z*q.z+q.w*q.w);
+  q.x/=l; q.y/=l; q.z/=l; q.w/=l;
+  return q;
+  }
+
+static void store(std::vector<float>& soa, size_t stride, size_t i, const ZenLoad::zCModelAniSample& s) {
+  soa[stride*0+i] = s.rotation.x;
+  soa[stride*1+i] = s.rotation.y;
+  soa[stride*2+i] = s.rotation.z;
+  soa[stride*3+i] = s.rotation.w;
+  soa[stride*4+i] = s.position.x;
+  soa[stride*5+i] = s.position.y;
+  soa[stride*6+i] = s.position.z;
+  }
+
+// same layout as Animation::AnimData::setupSoA; 'pad' is stored in tail lanes
+static Keyframes mkKeyframes(std::mt19937& rnd, size_t count, const std::vector<Pair>& kind, float pad) {
+  std::uniform_real_distribution<float> u(-1.f,1.f);
+  std::uniform_real_distribution<float> small(-0.05f,0.05f);
+
+  Keyframes k;
+  k.count  = count;
+  k.stride = (count+3)&~size_t(3);
+  k.a.assign(k.stride*7,pad);
+  k.b.assign(k.stride*7,pad);
+  for(size_t i=0; i<count; ++i) {
+    ZenLoad::zCModelAniSample a, b;
+    a.rotation = normalize({u(rnd),u(rnd),u(rnd),u(rnd)});
+    switch(kind[i]) {
+      case P_Near:
+      case P_Flipped:
+        b.rotation = normalize({a.rotation.x+small(rnd),a.rotation.y+small(rnd),a.rotation.z+small(rnd),a.rotation.w+small(rnd)});
+        break;
+      case P_Far:
+      case P_Count:
+        // rotate away from a, keeping the pair on same hemisphere
+        b.rotation = normalize({a.rotation.x+u(rnd),a.rotation.y+u(rnd),a.rotation.z+u(rnd),a.rotation.w+u(rnd)});
+        break;
+      }
+    if(kind[i]==P_Flipped)
+      b.rotation = {-b.rotation.x,-b.rotation.y,-b.rotation.z,-b.rotation.w};
+    a.position = {u(rnd)*100.f,u(rnd)*100.f,u(rnd)*100.f};
+    b.position = {u(rnd)*100.f,u(rnd)*100.f,u(rnd)*100.f};
+    store(k.a,k.stride,i,a);
+    store(k.b,k.stride,i,b);
+    k.sa.push_back(a);
+    k.sb.push_back(b);
+    }
+  return k;
+  }
+
+static bool equal(const Matrix4x4& a, const Matrix4x4& b, float& maxDiff) {
+  bool ok = true;
+  for(int x=0; x<4; ++x)
+    for(int y=0; y<4; ++y) {
+      const float va = a.at(x,y), vb = b.at(x,y);
+      if(std::memcmp(&va,&vb,sizeof(float))!=0)
+        ok = false;
+      maxDiff = std::max(maxDiff,std::abs(va-vb));
+      }
+  return ok;
+  }
+
+static int check(std::mt19937& rnd, size_t& cases) {
+  static const float sentinel[16] = {7,7,7,7, 7,7,7,7, 7,7,7,7, 7,7,7,7};
+  const float pads[] = {0.f,std::numeric_limits<float>::quiet_NaN(),1e30f};
+
+  std::uniform_real_distribution<float> ut(0.f,1.f);
+  size_t failed = 0;
+  float  maxDiff = 0;
+  for(size_t count=1; count<=67; ++count) {
+    for(int pattern=0; pattern<5; ++pattern) {
+      // all fast, all slerp, one slerp lane per group, alternating, random
+      std::vector<Pair> kind(count);
+      for(size_t i=0; i<count; ++i) {
+        switch(pattern) {
+          case 0: kind[i] = (i%5==4 ? P_Flipped : P_Near); break;
+          case 1: kind[i] = P_Far; break;
+          case 2: kind[i] = (i%4==size_t(rnd()%4) ? P_Far : P_Near); break;
+          case 3: kind[i] = (i%2==0 ? P_Far : P_Flipped); break;
+          default:kind[i] = Pair(rnd()%P_Count); break;
+          }
+        }
+
+      for(float pad:pads) {
+        Keyframes k = mkKeyframes(rnd,count,kind,pad);
+        const float t = (pattern==0 && pad==0.f) ? 0.f : ut(rnd);
+
+        // shuffled node indices and guard entries after them: padding lanes must not be written
+        std::vector<uint32_t> nodeIndex(count);
+        for(size_t i=0; i<count; ++i)
+          nodeIndex[i] = uint32_t(i);
+        std::shuffle(nodeIndex.begin(),nodeIndex.end(),rnd);
+        std::vector<Matrix4x4> out(count+4,Matrix4x4(sentinel));
+
+        mixSamples(k.a.data(),k.b.data(),k.stride,count,t,nodeIndex.data(),out.data());
+
+        bool  ok   = true;
+        float diff = 0;
+        for(size_t i=0; i<count; ++i) {
+          const Matrix4x4 ref = mkMatrix(mix(k.sa[i],k.sb[i],t));
+          if(!equal(out[nodeIndex[i]],ref,diff))
+            ok = false;
+          }
+        for(size_t i=count; i<out.size(); ++i) {
+          float dummy = 0;
+          if(!equal(out[i],Matrix4x4(sentinel),dummy))
+            ok = false;
+          }
+        maxDiff = std::max(maxDiff,diff);
+        if(!ok) {
+          if(failed==0)
+            std::printf("mismatch: %zu bones, pattern %d, pad %g, t=%g, max diff %g\n",count,pattern,double(pad),double(t),double(diff));
+          ++failed;
+          }
+        ++cases;
+        }
+      }
+    }
+  std::printf("mixSamples: %zu cases checked, max difference %g, %zu failed\n",cases,double(maxDiff),failed);
+  return failed==0 ? 0 : 2;
+  }
+
+static void bench(std::mt19937& rnd, size_t bones, int loops) {
+  std::printf("%zu bones, %d loops:\n",bones,loops);
+  for(int farPercent:{0,10,100}) {
+    std::vector<Pair> kind(bones);
+    for(auto& i:kind)
+      i = (int(rnd()%100)<farPercent) ? P_Far : P_Near;
+    Keyframes k = mkKeyframes(rnd,bones,kind,0.f);
+
+    std::vector<uint32_t>  nodeIndex(bones);
+    for(size_t i=0; i<bones; ++i)
+      nodeIndex[i] = uint32_t(i);
+    std::vector<Matrix4x4> out(bones);
+
+    float sink = 0;
+    auto  t0   = Clock::now();
+    for(int l=0; l<loops; ++l) {
+      const float t = float(l%16)/16.f;
+      for(size_t i=0; i<bones; ++i)
+        out[nodeIndex[i]] = mkMatrix(mix(k.sa[i],k.sb[i],t));
+      sink += out[0].at(3,0);
+      }
+    const double tScalar = std::chrono::duration<double,std::nano>(Clock::now()-t0).count();
+
+    t0 = Clock::now();
+    for(int l=0; l<loops; ++l) {
+      const float t = float(l%16)/16.f;
+      mixSamples(k.a.data(),k.b.data(),k.stride,bones,t,nodeIndex.data(),out.data());
+      sink += out[0].at(3,0);
+      }
+    const double tSoa = std::chrono::duration<double,std::nano>(Clock::now()-t0).count();
+
+    const double n = double(bones)*loops;
+    std::printf("  slerp lanes %3d%%: scalar %7.2f ns/bone, mixSamples %7.2f ns/bone, x%.2f%s\n",
+                farPercent,tScalar/n,tSoa/n,tSoa>0 ? tScalar/tSoa : 0.0,sink==1.2345f ? " " : "");
+    }
+  }
+
+}
+
+int main(int argc, const char** argv) {
+  try {
+    const size_t   bones = size_t  (std::stoul(arg(argc,argv,"--bones","64")));
+    const int      loops = std::max(1,std::stoi(arg(argc,argv,"--loops","200000")));
+    const uint32_t seed  = uint32_t(std::stoul(arg(argc,argv,"--seed", "1")));
+
+    std::mt19937 rnd(seed);
+    size_t       cases = 0;
+    const int    ret   = check(rnd,cases);
+    bench(rnd,bones,loops);
+    return ret;
+    }
+  catch(const std::exception& e) {
+    std::fprintf(stderr,"error: %s\n",e.what());
+    return 1;
+    }
+  }
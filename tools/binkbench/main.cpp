@@ -0,0 +1,372 @@
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bink/video.h"
+#include "bink/yuv.h"
+#include "synthstream.h"
+
+// Headless Bink decoder benchmark and conformance check.
+//
+//   binkbench synth <out.bik> [--size WxH] [--frames N] [--audio N] [--seed N] [--alpha]
+//   binkbench run   <in.bik>  [--loops N] [--golden file] [--write-golden file]
+//   binkbench yuv   [--size WxH] [--loops N]
+//
+// Golden file has one line per frame: frame index, hash of each video plane, checksum of each audio track.
+// 'yuv' checks Bink::yuvToRgba against float reference over synthetic frames and measures both.
+
+namespace {
+
+struct MemInput : Bink::Video::Input {
+  explicit MemInput(const std::vector<uint8_t>& data):data(data) {}
+
+  void read(void* dest, size_t count) override {
+    if(at+count>data.size())
+      throw std::runtime_error("i/o error");
+    std::memcpy(dest,data.data()+at,count);
+    at+=count;
+    }
+  void skip(size_t count) override {
+    at+=count;
+    }
+  void seek(size_t pos) override {
+    at = pos;
+    }
+
+  const std::vector<uint8_t>& data;
+  size_t                      at = 0;
+  };
+
+struct Hash {
+  uint64_t h = 14695981039346656037ull;
+  void put(const void* d, size_t sz) {
+    auto p = reinterpret_cast<const uint8_t*>(d);
+    for(size_t i=0; i<sz; ++i) {
+      h ^= p[i];
+      h *= 1099511628211ull;
+      }
+    }
+  };
+
+static uint64_t planeHash(const Bink::Frame::Plane& p) {
+  Hash h;
+  for(uint32_t y=0; y<p.height(); ++y)
+    h.put(p.data()+y*p.bytesPerLine(),p.width());
+  return h.h;
+  }
+
+static uint64_t audioHash(const std::vector<float>& s) {
+  // quantized same way as playback, so tiny float differences between compilers don't matter
+  Hash h;
+  for(auto v:s) {
+    int16_t i = (v < -1.f ? int16_t(-32768) : (v > 1.f ? int16_t(32767) : int16_t(v * 32767.f)));
+    h.put(&i,sizeof(i));
+    }
+  return h.h;
+  }
+
+static bool readFile(const char* name, std::vector<uint8_t>& out) {
+  FILE* f = std::fopen(name,"rb");
+  if(f==nullptr)
+    return false;
+  std::fseek(f,0,SEEK_END);
+  out.resize(size_t(std::ftell(f)));
+  std::fseek(f,0,SEEK_SET);
+  const bool ok = std::fread(out.data(),1,out.size(),f)==out.size();
+  std::fclose(f);
+  return ok;
+  }
+
+static bool writeFile(const char* name, const void* data, size_t size) {
+  FILE* f = std::fopen(name,"wb");
+  if(f==nullptr)
+    return false;
+  const bool ok = std::fwrite(data,1,size,f)==size;
+  std::fclose(f);
+  return ok;
+  }
+
+static const char* arg(int argc, const char** argv, const char* name, const char* def) {
+  for(int i=0; i+1<argc; ++i)
+    if(std::strcmp(argv[i],name)==0)
+      return argv[i+1];
+  return def;
+  }
+
+static bool flag(int argc, const char** argv, const char* name) {
+  for(int i=0; i<argc; ++i)
+    if(std::strcmp(argv[i],name)==0)
+      return true;
+  return false;
+  }
+
+static int synth(int argc, const char** argv) {
+  SynthStream::Desc d;
+  if(std::sscanf(arg(argc,argv,"--size","320x240"),"%ux%u",&d.width,&d.height)!=2) {
+    std::fprintf(stderr,"invalid --size\n");
+    return 1;
+    }
+  d.frames = uint32_t(std::stoul(arg(argc,argv,"--frames","60")));
+  d.audio  = uint8_t (std::stoul(arg(argc,argv,"--audio", "2")));
+  d.seed   = uint32_t(std::stoul(arg(argc,argv,"--seed",  "1")));
+  d.alpha  = flag(argc,argv,"--alpha");
+
+  auto data = SynthStream::generate(d);
+  if(!writeFile(argv[2],data.data(),data.size())) {
+    std::fprintf(stderr,"unable to write \"%s\"\n",argv[2]);
+    return 1;
+    }
+  std::printf("%s: %ux%u%s, %u frames, %u audio tracks, %zu bytes\n",argv[2],d.width,d.height,d.alpha ? " alpha" : "",d.frames,d.audio,data.size());
+  return 0;
+  }
+
+static int run(int argc, const char** argv) {
+  std::vector<uint8_t> data;
+  if(!readFile(argv[2],data)) {
+    std::fprintf(stderr,"unable to read \"%s\"\n",argv[2]);
+    return 1;
+    }
+  const int   loops       = std::stoi(arg(argc,argv,"--loops","1"));
+  const char* goldenName  = arg(argc,argv,"--golden",nullptr);
+  const char* writeGolden = arg(argc,argv,"--write-golden",nullptr);
+
+  std::string golden, hashes;
+  if(goldenName!=nullptr) {
+    std::vector<uint8_t> g;
+    if(!readFile(goldenName,g)) {
+      std::fprintf(stderr,"unable to read \"%s\"\n",goldenName);
+      return 1;
+      }
+    golden.assign(g.begin(),g.end());
+    }
+
+  Bink::Video::Profile prof;
+  size_t               frames = 0;
+  double               wall   = 0;
+  for(int l=0; l<loops; ++l) {
+    MemInput    fin(data);
+    Bink::Video vid(&fin);
+    auto        t0 = std::chrono::steady_clock::now();
+    for(size_t i=0; i<vid.frameCount(); ++i) {
+      auto& f = vid.nextFrame();
+      if(l!=0)
+        continue;
+      char buf[64] = {};
+      std::snprintf(buf,sizeof(buf),"%zu",i);
+      hashes += buf;
+      const uint8_t planes = vid.hasAlpha() ? 4 : 3;
+      for(uint8_t p=0; p<planes; ++p) {
+        std::snprintf(buf,sizeof(buf)," %016" PRIx64,planeHash(f.plane(p)));
+        hashes += buf;
+        }
+      for(uint8_t a=0; a<f.audioCount(); ++a) {
+        std::snprintf(buf,sizeof(buf)," %016" PRIx64,audioHash(f.audio(a).samples));
+        hashes += buf;
+        }
+      hashes += "\n";
+      }
+    wall += std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+
+    auto& p = vid.profile();
+    prof.packet  += p.packet;
+    prof.bundles += p.bundles;
+    prof.idct    += p.idct;
+    prof.motion  += p.motion;
+    prof.audio   += p.audio;
+    prof.total   += p.total;
+    frames       += vid.frameCount();
+    }
+
+  const uint64_t known = prof.packet+prof.bundles+prof.idct+prof.motion+prof.audio;
+  const uint64_t other = prof.total>known ? prof.total-known : 0;
+  auto stage = [&](const char* name, uint64_t ns) {
+    std::printf("  %-10s %10.3f ms %6.1f%%\n",name,double(ns)/1e6,prof.total>0 ? 100.0*double(ns)/double(prof.total) : 0.0);
+    };
+  std::printf("%s: %zu frames in %.3f s, %.1f fps\n",argv[2],frames,wall,wall>0 ? double(frames)/wall : 0.0);
+  stage("packet",  prof.packet);
+  stage("bundles", prof.bundles);
+  stage("idct",    prof.idct);
+  stage("motion",  prof.motion);
+  stage("audio",   prof.audio);
+  stage("blocks",  other);
+
+  if(writeGolden!=nullptr && !writeFile(writeGolden,hashes.data(),hashes.size())) {
+    std::fprintf(stderr,"unable to write \"%s\"\n",writeGolden);
+    return 1;
+    }
+  if(goldenName!=nullptr) {
+    if(golden!=hashes) {
+      size_t line = 0;
+      for(size_t i=0; i<std::min(golden.size(),hashes.size()) && golden[i]==hashes[i]; ++i)
+        if(golden[i]=='\n')
+          ++line;
+      std::printf("golden mismatch, first at frame %zu\n",line);
+      return 2;
+      }
+    std::printf("golden match\n");
+    }
+  return 0;
+  }
+
+
+// float conversion, that was used by VideoWidget before fixed-point one
+static void yuvReference(const Bink::Frame& f, bool alpha, uint8_t* dst, size_t dstStride) {
+  auto& planeY = f.plane(0);
+  auto& planeU = f.plane(1);
+  auto& planeV = f.plane(2);
+  auto& planeA = f.plane(3);
+
+  for(uint32_t y=0; y<f.height(); ++y)
+    for(uint32_t x=0; x<f.width(); ++x) {
+      uint8_t* rgb = &dst[x*4+y*dstStride];
+      float Y = planeY.at(x,  y  );
+      float U = planeU.at(x/2,y/2);
+      float V = planeV.at(x/2,y/2);
+
+      float r = 1.164f * (Y - 16.f) + 1.596f * (V - 128.f);
+      float g = 1.164f * (Y - 16.f) - 0.813f * (V - 128.f) - 0.391f * (U - 128.f);
+      float b = 1.164f * (Y - 16.f) + 2.018f * (U - 128.f);
+
+      r = std::max(0.f,std::min(r,255.f));
+      g = std::max(0.f,std::min(g,255.f));
+      b = std::max(0.f,std::min(b,255.f));
+
+      rgb[0] = uint8_t(r);
+      rgb[1] = uint8_t(g);
+      rgb[2] = uint8_t(b);
+      rgb[3] = alpha ? planeA.at(x,y) : 255;
+      }
+  }
+
+static void yuvBanded(const Bink::Frame& f, bool alpha, uint8_t* dst, size_t dstStride, uint32_t band) {
+  for(uint32_t y=0; y<f.height(); y+=band)
+    Bink::yuvToRgba(f,alpha,dst,dstStride,y,y+band);
+  }
+
+// frames of synthetic stream, with content of every block type
+static std::vector<uint8_t> synthVideo(uint32_t w, uint32_t h, uint32_t frames, uint32_t seed) {
+  SynthStream::Desc d;
+  d.width  = w;
+  d.height = h;
+  d.frames = frames;
+  d.audio  = 0;
+  d.alpha  = true;
+  d.seed   = seed;
+  return SynthStream::generate(d);
+  }
+
+static int yuv(int argc, const char** argv) {
+  // odd sizes, where half-size chroma plane still holds all of it's 8x8 blocks
+  static const uint32_t sizes[][2] = {{320,240},{35,19},{19,35},{15,9},{9,3},{3,3},{639,359}};
+  static const uint32_t bands[]    = {2,6,32};
+
+  size_t checked = 0, failed = 0;
+  int    maxDiff = 0;
+  for(auto& sz:sizes) {
+    auto        data = synthVideo(sz[0],sz[1],4,sz[0]*7+sz[1]);
+    MemInput    fin(data);
+    Bink::Video vid(&fin);
+
+    // stride with padding, so writes past row end are detected
+    const size_t         stride = size_t(sz[0])*4+12;
+    const size_t         bytes  = stride*sz[1];
+    std::vector<uint8_t> ref(bytes), single(bytes), banded(bytes);
+    for(size_t i=0; i<vid.frameCount(); ++i) {
+      auto& f = vid.nextFrame();
+      for(bool alpha:{false,true}) {
+        std::fill(ref.begin(),   ref.end(),   uint8_t(0xCD));
+        std::fill(single.begin(),single.end(),uint8_t(0xCD));
+        yuvReference(f,alpha,ref.data(),stride);
+        Bink::yuvToRgba(f,alpha,single.data(),stride,0,f.height());
+
+        bool ok = true;
+        for(size_t p=0; p<bytes; ++p) {
+          const int d = std::abs(int(ref[p])-int(single[p]));
+          // alpha and padding must be exact, color within 1
+          const bool color = (p%stride)<size_t(sz[0])*4 && p%4!=3;
+          if(!color && d!=0)
+            ok = false;
+          maxDiff = std::max(maxDiff,color ? d : 0);
+          if(d>1)
+            ok = false;
+          }
+        for(auto b:bands) {
+          std::fill(banded.begin(),banded.end(),uint8_t(0xCD));
+          yuvBanded(f,alpha,banded.data(),stride,b);
+          if(banded!=single)
+            ok = false;
+          }
+        if(!ok) {
+          if(failed==0)
+            std::printf("mismatch: %ux%u frame %zu, alpha %d\n",sz[0],sz[1],i,int(alpha));
+          ++failed;
+          }
+        ++checked;
+        }
+      }
+    }
+  std::printf("yuv: %zu frames checked, max color difference %d, %zu failed\n",checked,maxDiff,failed);
+
+  uint32_t w = 640, h = 480;
+  if(std::sscanf(arg(argc,argv,"--size","640x480"),"%ux%u",&w,&h)!=2) {
+    std::fprintf(stderr,"invalid --size\n");
+    return 1;
+    }
+  const int   loops = std::max(1,std::stoi(arg(argc,argv,"--loops","100")));
+  auto        data  = synthVideo(w,h,1,1);
+  MemInput    fin(data);
+  Bink::Video vid(&fin);
+  auto&       f     = vid.nextFrame();
+
+  std::vector<uint8_t> dst(size_t(w)*h*4);
+  auto bench = [&](const char* name, bool alpha, void(*fn)(const Bink::Frame&,bool,uint8_t*,size_t)) {
+    auto t0 = std::chrono::steady_clock::now();
+    for(int l=0; l<loops; ++l)
+      fn(f,alpha,dst.data(),size_t(w)*4);
+    const double ms = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-t0).count()/loops;
+    std::printf("  %-18s %8.3f ms/frame\n",name,ms);
+    };
+  std::printf("%ux%u, %d loops:\n",w,h,loops);
+  bench("float",          false,yuvReference);
+  bench("fixed-point",    false,[](const Bink::Frame& f, bool alpha, uint8_t* dst, size_t stride){
+    Bink::yuvToRgba(f,alpha,dst,stride,0,f.height());
+    });
+  bench("fixed-point alpha",true,[](const Bink::Frame& f, bool alpha, uint8_t* dst, size_t stride){
+    Bink::yuvToRgba(f,alpha,dst,stride,0,f.height());
+    });
+  bench("fixed-point bands",false,[](const Bink::Frame& f, bool alpha, uint8_t* dst, size_t stride){
+    yuvBanded(f,alpha,dst,stride,32);
+    });
+  return failed==0 ? 0 : 2;
+  }
+
+}
+
+int main(int argc, const char** argv) {
+  if(argc<2 || (argc<3 && std::strcmp(argv[1],"yuv")!=0)) {
+    std::fprintf(stderr,"usage:\n"
+                        "  binkbench synth <out.bik> [--size WxH] [--frames N] [--audio N] [--seed N] [--alpha]\n"
+                        "  binkbench run   <in.bik>  [--loops N] [--golden file] [--write-golden file]\n"
+                        "  binkbench yuv   [--size WxH] [--loops N]\n");
+    return 1;
+    }
+  try {
+    if(std::strcmp(argv[1],"synth")==0)
+      return synth(argc,argv);
+    if(std::strcmp(argv[1],"run")==0)
+      return run(argc,argv);
+    if(std::strcmp(argv[1],"yuv")==0)
+      return yuv(argc,argv);
+    }
+  catch(const std::exception& e) {
+    std::fprintf(stderr,"error: %s\n",e.what());
+    return 1;
+    }
+  std::fprintf(stderr,"unknown command \"%s\"\n",argv[1]);
+  return 1;
+  }
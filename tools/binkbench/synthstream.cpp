@@ -0,0 +1,457 @@
+#include "synthstream.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+enum BlockTypes : uint8_t {
+  SKIP_BLOCK    = 0,
+  MOTION_BLOCK  = 2,
+  RUN_BLOCK     = 3,
+  INTRA_BLOCK   = 5,
+  FILL_BLOCK    = 6,
+  INTER_BLOCK   = 7,
+  PATTERN_BLOCK = 8,
+  RAW_BLOCK     = 9,
+  };
+
+enum Sources : uint8_t {
+  SRC_BLOCK_TYPES = 0,
+  SRC_SUB_BLOCK_TYPES,
+  SRC_COLORS,
+  SRC_PATTERN,
+  SRC_X_OFF,
+  SRC_Y_OFF,
+  SRC_INTRA_DC,
+  SRC_INTER_DC,
+  SRC_RUN,
+  SRC_COUNT
+  };
+
+enum {
+  AUD_STEREO  = 0x2000,
+  AUD_USEDCT  = 0x1000,
+  };
+
+static const uint16_t criticalFreqs[25] = {
+  100,   200,  300,  400,  510,  630,   770,   920,
+  1080,  1270, 1480, 1720, 2000, 2320,  2700,  3150,
+  3700,  4400, 5300, 6400, 7700, 9500, 12000, 15500,
+  24500,
+  };
+
+struct Rng {
+  uint32_t s;
+  uint32_t next() {
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    return s;
+    }
+  // inclusive range
+  int range(int a, int b) { return a + int(next()%uint32_t(b-a+1)); }
+  };
+
+// LSB-first bit writer, mirrors Video::BitStream
+struct BitWriter {
+  std::vector<uint8_t> data;
+  size_t               at = 0;
+
+  void put(uint32_t v, int n) {
+    for(int i=0; i<n; ++i, ++at) {
+      if((at>>3)>=data.size())
+        data.push_back(0);
+      // wide zero runs (n>32) are used as padding
+      if(i<32 && ((v>>i)&1))
+        data[at>>3] |= uint8_t(1u << (at&7));
+      }
+    }
+  void putSigned(int v, int n) {
+    // magnitude, followed by sign bit for non-zero values
+    put(uint32_t(std::abs(v)),n);
+    if(v!=0)
+      put(v<0 ? 1 : 0,1);
+    }
+  void append(const BitWriter& o) {
+    for(size_t i=0; i<o.at; ++i)
+      put((o.data[i>>3]>>(i&7))&1,1);
+    }
+  void align32() {
+    while(at%32!=0)
+      put(0,1);
+    }
+  };
+
+static int log2i(uint32_t v) {
+  int n = 0;
+  while(v>>=1)
+    n++;
+  return n;
+  }
+
+static int bitsFor(uint32_t v) {
+  int n = 0;
+  while(v>>n)
+    n++;
+  return n;
+  }
+
+static void writeU32(std::vector<uint8_t>& out, uint32_t v) {
+  for(int i=0; i<4; ++i)
+    out.push_back(uint8_t(v>>(i*8)));
+  }
+
+static void writeU16(std::vector<uint8_t>& out, uint16_t v) {
+  out.push_back(uint8_t(v));
+  out.push_back(uint8_t(v>>8));
+  }
+
+class PlaneWriter {
+  public:
+    PlaneWriter(Rng& rng, uint32_t width, uint32_t height, bool chroma, bool key)
+      :rng(rng), chroma(chroma), key(key) {
+      bw = chroma ? (width  + 15) >> 4 : (width  + 7) >> 3;
+      bh = chroma ? (height + 15) >> 4 : (height + 7) >> 3;
+
+      // plane memory layout, see Frame::Plane::setSize
+      const uint32_t pw = chroma ? width/2  : width;
+      const uint32_t ph = chroma ? height/2 : height;
+      stride = ((pw+15)/16)*16;
+      rows   = ((ph+15)/16)*16;
+
+      const uint32_t w8 = ((std::max<uint32_t>(pw,8)+7)/8)*8;
+      len[SRC_BLOCK_TYPES]     = log2i((w8 >> 3) + 511) + 1;
+      len[SRC_SUB_BLOCK_TYPES] = log2i((w8 >> 4) + 511) + 1;
+      len[SRC_COLORS]          = log2i(bw*64 + 511) + 1;
+      len[SRC_INTRA_DC]        = log2i((w8 >> 3) + 511) + 1;
+      len[SRC_INTER_DC]        = len[SRC_INTRA_DC];
+      len[SRC_X_OFF]           = len[SRC_INTRA_DC];
+      len[SRC_Y_OFF]           = len[SRC_INTRA_DC];
+      len[SRC_PATTERN]         = log2i((bw << 3) + 511) + 1;
+      len[SRC_RUN]             = log2i(bw*48 + 511) + 1;
+      }
+
+    void write(BitWriter& gb) {
+      for(auto& i:vals)
+        i.resize(bh);
+      inl.resize(bh);
+      for(uint32_t by=0; by<bh; ++by)
+        for(uint32_t bx=0; bx<bw; ++bx)
+          genBlock(bx,by);
+
+      // all trees: vlc 0, identity mapping
+      for(int i=0; i<SRC_COUNT; ++i) {
+        if(i==SRC_COLORS)
+          gb.put(0,4*16);
+        if(i!=SRC_INTRA_DC && i!=SRC_INTER_DC)
+          gb.put(0,4);
+        }
+
+      int  decoded [SRC_COUNT] = {};
+      int  consumed[SRC_COUNT] = {};
+      bool ended   [SRC_COUNT] = {};
+      for(uint32_t by=0; by<bh; ++by) {
+        for(int i=0; i<SRC_COUNT; ++i) {
+          if(ended[i] || decoded[i]>consumed[i])
+            continue;
+          // decoder is refilling bundle: emit values of next row, that uses it
+          uint32_t row = by;
+          while(row<bh && vals[i][row].empty())
+            ++row;
+          if(row==bh) {
+            gb.put(0,len[i]);
+            ended[i] = true;
+            continue;
+            }
+          writeBundle(gb,Sources(i),vals[i][row]);
+          decoded[i] += int(vals[i][row].size());
+          }
+        for(int i=0; i<SRC_COUNT; ++i)
+          consumed[i] += int(vals[i][by].size());
+        gb.append(inl[by]);
+        }
+      gb.align32();
+      }
+
+  private:
+    void genBlock(uint32_t bx, uint32_t by) {
+      static const BlockTypes keyTypes[] = {FILL_BLOCK, RAW_BLOCK, PATTERN_BLOCK, INTRA_BLOCK, RUN_BLOCK};
+      static const BlockTypes allTypes[] = {SKIP_BLOCK, MOTION_BLOCK, RUN_BLOCK, INTRA_BLOCK, FILL_BLOCK,
+                                            INTER_BLOCK, PATTERN_BLOCK, RAW_BLOCK};
+      const BlockTypes t = key ? keyTypes[rng.next()%5] : allTypes[rng.next()%8];
+      auto&            b = inl[by];
+
+      vals[SRC_BLOCK_TYPES][by].push_back(t);
+      switch(t) {
+        case SKIP_BLOCK:
+          break;
+        case MOTION_BLOCK:
+          motion(bx,by);
+          break;
+        case RUN_BLOCK: {
+          b.put(rng.next()%16,4);
+          int i = 0;
+          while(i<63) {
+            const int rem = 64-i;
+            const int run = rem<=4 ? rem : rng.range(4,std::min(16,rem));
+            vals[SRC_RUN][by].push_back(run-1);
+            const bool single = (rng.next()%2)==0;
+            b.put(single ? 1 : 0,1);
+            color(by,single ? 1 : run);
+            i += run;
+            }
+          if(i==63)
+            color(by,1);
+          break;
+          }
+        case INTRA_BLOCK:
+          vals[SRC_INTRA_DC][by].push_back(rng.range(0,1023));
+          coeffs(b);
+          break;
+        case FILL_BLOCK:
+          color(by,1);
+          break;
+        case INTER_BLOCK:
+          motion(bx,by);
+          vals[SRC_INTER_DC][by].push_back(rng.range(-255,255));
+          coeffs(b);
+          break;
+        case PATTERN_BLOCK:
+          color(by,2);
+          for(int i=0; i<8; ++i)
+            vals[SRC_PATTERN][by].push_back(int(rng.next()&0xFF));
+          break;
+        case RAW_BLOCK:
+          color(by,64);
+          break;
+        }
+      }
+
+    void color(uint32_t by, int count) {
+      for(int i=0; i<count; ++i)
+        vals[SRC_COLORS][by].push_back(int(rng.next()&0xFF));
+      }
+
+    void motion(uint32_t bx, uint32_t by) {
+      // keep source block inside of plane memory
+      const int x = std::max(0,std::min(int(bx*8)+rng.range(-8,8),int(stride)-8));
+      const int y = std::max(0,std::min(int(by*8)+rng.range(-8,8),int(rows)-8));
+      vals[SRC_X_OFF][by].push_back(x-int(bx*8));
+      vals[SRC_Y_OFF][by].push_back(y-int(by*8));
+      }
+
+    void coeffs(BitWriter& b) {
+      // three low-frequency coefficients, emitted on first bit-plane
+      const int nbits = rng.range(1,5);
+      b.put(uint32_t(nbits),4);
+      for(int bits=nbits-1; bits>=0; --bits) {
+        b.put(0,3);
+        if(bits!=nbits-1)
+          continue;
+        for(int i=0; i<3; ++i) {
+          b.put(1,1);
+          if(bits==0) {
+            b.put(rng.next()%2,1);
+            } else {
+            b.put(rng.next()&((1u<<bits)-1),bits);
+            b.put(rng.next()%2,1);
+            }
+          }
+        }
+      b.put(rng.next()%16,4);
+      }
+
+    void writeBundle(BitWriter& gb, Sources src, const std::vector<int>& v) {
+      gb.put(uint32_t(v.size()),len[src]);
+      switch(src) {
+        case SRC_BLOCK_TYPES:
+        case SRC_SUB_BLOCK_TYPES:
+        case SRC_RUN:
+          gb.put(0,1);
+          for(auto i:v)
+            gb.put(uint32_t(i),4);
+          break;
+        case SRC_COLORS:
+          gb.put(0,1);
+          for(auto i:v) {
+            gb.put(uint32_t(i>>4),4);
+            gb.put(uint32_t(i&0xF),4);
+            }
+          break;
+        case SRC_PATTERN:
+          for(auto i:v) {
+            gb.put(uint32_t(i&0xF),4);
+            gb.put(uint32_t(i>>4),4);
+            }
+          break;
+        case SRC_X_OFF:
+        case SRC_Y_OFF:
+          gb.put(0,1);
+          for(auto i:v)
+            gb.putSigned(i,4);
+          break;
+        case SRC_INTRA_DC:
+        case SRC_INTER_DC: {
+          const bool hasSign = (src==SRC_INTER_DC);
+          if(hasSign)
+            gb.putSigned(v[0],10); else
+            gb.put(uint32_t(v[0]),11);
+          for(size_t i=1; i<v.size(); i+=8) {
+            const size_t e = std::min(v.size(),i+8);
+            int bsize = 0;
+            for(size_t r=i; r<e; ++r)
+              bsize = std::max(bsize,bitsFor(uint32_t(std::abs(v[r]-v[r-1]))));
+            gb.put(uint32_t(bsize),4);
+            if(bsize>0)
+              for(size_t r=i; r<e; ++r)
+                gb.putSigned(v[r]-v[r-1],bsize);
+            }
+          break;
+          }
+        case SRC_COUNT:
+          break;
+        }
+      }
+
+    Rng&                   rng;
+    bool                   chroma = false;
+    bool                   key    = false;
+    uint32_t               bw = 0, bh = 0;
+    uint32_t               stride = 0, rows = 0;
+    int                    len[SRC_COUNT] = {};
+    std::vector<std::vector<int>> vals[SRC_COUNT];
+    std::vector<BitWriter> inl;
+  };
+
+struct AudioTrack {
+  uint16_t sampleRate = 0;
+  uint16_t flags      = 0;
+  uint32_t frameLen   = 0;
+  uint32_t numBands   = 0;
+  uint8_t  channels   = 1;
+  bool     isDct      = false;
+
+  AudioTrack(uint16_t rate, uint16_t fl):sampleRate(rate), flags(fl) {
+    // same setup, as Video::decodeAudioInit
+    int      frameLenBits = rate<22050 ? 9 : (rate<44100 ? 10 : 11);
+    uint32_t effRate      = rate;
+    channels = (fl & AUD_STEREO) ? 2 : 1;
+    isDct    = (fl & AUD_USEDCT)!=0;
+    if(!isDct) {
+      effRate      *= channels;
+      frameLenBits += log2i(channels);
+      channels      = 1;
+      }
+    frameLen = 1u << frameLenBits;
+    const uint32_t half = (effRate+1)/2;
+    for(numBands=1; numBands<25; numBands++)
+      if(half<=criticalFreqs[numBands-1])
+        break;
+    }
+
+  void writeBlock(Rng& rng, BitWriter& gb) const {
+    if(isDct)
+      gb.put(0,2);
+    for(uint8_t ch=0; ch<channels; ++ch) {
+      for(int i=0; i<2; ++i) {
+        gb.put(uint32_t(rng.range(10,16)),5);  // power
+        gb.put(rng.next()&0x7FFFFF,23);        // mantissa
+        gb.put(rng.next()%2,1);                // sign
+        }
+      for(uint32_t i=0; i<numBands; ++i)
+        gb.put(uint32_t(rng.range(10,40)),8);
+      for(uint32_t i=2; i<frameLen; i+=8) {
+        gb.put(0,1); // run of 8 coefficients
+        const uint32_t width = uint32_t(rng.range(0,6));
+        gb.put(width,4);
+        if(width==0)
+          continue;
+        for(uint32_t r=i; r<std::min(i+8,frameLen); ++r) {
+          const uint32_t c = rng.next()&((1u<<width)-1);
+          gb.put(c,int(width));
+          if(c!=0)
+            gb.put(rng.next()%2,1);
+          }
+        }
+      }
+    gb.align32();
+    }
+  };
+
+}
+
+std::vector<uint8_t> SynthStream::generate(const Desc& d) {
+  Rng rng{d.seed*2654435761u + 1u};
+
+  std::vector<AudioTrack> tracks;
+  for(uint8_t i=0; i<d.audio; ++i) {
+    if(i%2==0)
+      tracks.emplace_back(uint16_t(22050),uint16_t(AUD_STEREO)); else
+      tracks.emplace_back(uint16_t(44100),uint16_t(AUD_USEDCT));
+    }
+
+  std::vector<std::vector<uint8_t>> frames(d.frames);
+  uint32_t largest = 0;
+  for(uint32_t f=0; f<d.frames; ++f) {
+    auto& out = frames[f];
+    for(auto& t:tracks) {
+      BitWriter gb;
+      gb.put(t.frameLen*2,32); // reported size, skipped by decoder
+      t.writeBlock(rng,gb);
+      writeU32(out,uint32_t(gb.data.size()));
+      out.insert(out.end(),gb.data.begin(),gb.data.end());
+      }
+
+    BitWriter  gb;
+    const bool key = (f==0);
+    if(d.alpha) {
+      // alpha plane goes first and has luma layout
+      gb.put(0,32);
+      PlaneWriter(rng,d.width,d.height,false,key).write(gb);
+      }
+    gb.put(0,32);
+    PlaneWriter(rng,d.width,d.height,false,key).write(gb);
+    PlaneWriter(rng,d.width,d.height,true, key).write(gb);
+    PlaneWriter(rng,d.width,d.height,true, key).write(gb);
+    out.insert(out.end(),gb.data.begin(),gb.data.end());
+    largest = std::max(largest,uint32_t(out.size()));
+    }
+
+  const uint32_t headerSize = 11*4 + uint32_t(tracks.size())*12 + d.frames*4;
+  uint32_t       fileSize   = headerSize;
+  for(auto& i:frames)
+    fileSize += uint32_t(i.size());
+
+  std::vector<uint8_t> ret;
+  ret.reserve(fileSize);
+  writeU32(ret,uint32_t('B') | uint32_t('I')<<8 | uint32_t('K')<<16 | uint32_t('i')<<24);
+  writeU32(ret,fileSize-8);
+  writeU32(ret,d.frames);
+  writeU32(ret,largest);
+  writeU32(ret,0);
+  writeU32(ret,d.width);
+  writeU32(ret,d.height);
+  writeU32(ret,d.fps);
+  writeU32(ret,1);
+  writeU32(ret,d.alpha ? 0x00100000 : 0); // video flags
+  writeU32(ret,uint32_t(tracks.size()));
+  for(auto& t:tracks)
+    writeU32(ret,t.frameLen*2);
+  for(auto& t:tracks) {
+    writeU16(ret,t.sampleRate);
+    writeU16(ret,t.flags);
+    }
+  for(size_t i=0; i<tracks.size(); ++i)
+    writeU32(ret,uint32_t(i));
+
+  uint32_t pos = headerSize;
+  for(uint32_t f=0; f<d.frames; ++f) {
+    writeU32(ret,pos | (f==0 ? 1 : 0));
+    pos += uint32_t(frames[f].size());
+    }
+  for(auto& i:frames)
+    ret.insert(ret.end(),i.begin(),i.end());
+  return ret;
+  }
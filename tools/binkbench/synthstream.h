@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Generator of small, valid Bink ('BIKi') streams, so decoder can be tested without game assets.
+// Covers skip, motion, run, intra, fill, inter, pattern and raw blocks, RDFT and DCT audio.
+class SynthStream final {
+  public:
+    struct Desc {
+      uint32_t width  = 320;
+      uint32_t height = 240;
+      uint32_t frames = 60;
+      uint32_t fps    = 25;
+      uint8_t  audio  = 2;  // track 0: rdft stereo, track 1: dct mono
+      bool     alpha  = false;
+      uint32_t seed   = 1;
+      };
+
+    static std::vector<uint8_t> generate(const Desc& d);
+  };
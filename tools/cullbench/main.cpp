@@ -0,0 +1,494 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "graphics/dynamic/frustrum.h"
+
+// Culling benchmark: replay of ObjectsBucket visibility passes over camera paths.
+//
+//   cullbench [--buckets N] [--fill N] [--frames N] [--moving N] [--seed N]
+//
+// Buckets are grouped by material, so objects of one bucket are spread over whole world. Every frame part of
+// movable objects moves, then camera pass (visibilityPass) and shadow pass (visibilityPassAnd) are run:
+// over packed spheres with Frustrum::testSpheres, as ObjectsBucket does, and per object over wide records,
+// as it was done before. Both must keep same objects, except of few, that former aabb group bound culled.
+
+using namespace Tempest;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum { CAPACITY = 128 };
+
+enum Type : uint8_t {
+  Static,
+  Movable,
+  Animated,
+  };
+
+static double msSince(Clock::time_point t0) {
+  return std::chrono::duration<double,std::milli>(Clock::now()-t0).count();
+  }
+
+static const char* arg(int argc, const char** argv, const char* name, const char* def) {
+  for(int i=0; i+1<argc; ++i)
+    if(std::strcmp(argv[i],name)==0)
+      return argv[i+1];
+  return def;
+  }
+
+struct Vec {
+  float x=0, y=0, z=0;
+  };
+
+// same as Bounds: aabb and sphere around it
+struct Box {
+  Vec   bbox[2], bboxTr[2], at, midTr;
+  float r = 0;
+
+  void assign(const Vec& b0, const Vec& b1) {
+    bbox[0]   = b0;
+    bbox[1]   = b1;
+    bboxTr[0] = b0;
+    bboxTr[1] = b1;
+    midTr     = {(b0.x+b1.x)/2,(b0.y+b1.y)/2,(b0.z+b1.z)/2};
+    // Bounds::calcR
+    float x = std::max(std::fabs(b1.x-midTr.x),std::fabs(b0.x-midTr.x));
+    float y = std::max(std::fabs(b1.y-midTr.y),std::fabs(b0.y-midTr.y));
+    float z = std::max(std::fabs(b1.z-midTr.z),std::fabs(b0.z-midTr.z));
+    r = std::sqrt(x*x+y*y+z*z);
+    }
+  };
+
+// same field layout as ObjectsBucket::Object, that former passes walked over
+struct Object {
+  uint8_t     vboType = 0;
+  const void* vbo     = nullptr;
+  const void* vboM[2] = {};
+  const void* vboA    = nullptr;
+  const void* ibo     = nullptr;
+  float       pos[16] = {};
+  size_t      storageAni = size_t(-1);
+  uint32_t    lightId  = 0;
+  uint32_t    lightCnt = 0;
+  uint64_t    timeShift=0;
+  Box         bounds;
+  bool        morph = false;
+
+  bool        isValid() const { return vboType!=0; }
+  };
+
+struct Spheres {
+  float x[CAPACITY] = {};
+  float y[CAPACITY] = {};
+  float z[CAPACITY] = {};
+  float r[CAPACITY] = {};
+  };
+
+static bool testBit(const uint32_t* mask, size_t i) {
+  return (mask[i/32] & (1u<<(i%32)))!=0;
+  }
+
+static void setBit(uint32_t* mask, size_t i, bool v) {
+  if(v)
+    mask[i/32] |=  (1u<<(i%32)); else
+    mask[i/32] &= ~(1u<<(i%32));
+  }
+
+struct Bucket {
+  Type     shaderType = Static;
+  Object   val[CAPACITY];
+  size_t   valLast = 0;
+
+  // state of former implementation
+  Object*  indexOld[CAPACITY] = {};
+  size_t   indexOldSz = 0;
+  Box      allBoundsOld;
+
+  // state of current implementation
+  Spheres  sphere;
+  uint32_t validMask[CAPACITY/32] = {};
+  uint32_t morphMask[CAPACITY/32] = {};
+  Object*  index[CAPACITY] = {};
+  size_t   indexSz = 0;
+  Box      allBounds;
+
+  void updateSphere(size_t i) {
+    auto& b = val[i].bounds;
+    sphere.x[i] = b.midTr.x;
+    sphere.y[i] = b.midTr.y;
+    sphere.z[i] = b.midTr.z;
+    sphere.r[i] = b.r;
+    allBounds.r = 0;
+    }
+
+  // ObjectsBucket::setObjMatrix, for both implementations
+  void move(size_t i, const Vec& d) {
+    auto& b  = val[i].bounds;
+    Vec   b0 = {b.bboxTr[0].x+d.x,b.bboxTr[0].y+d.y,b.bboxTr[0].z+d.z};
+    Vec   b1 = {b.bboxTr[1].x+d.x,b.bboxTr[1].y+d.y,b.bboxTr[1].z+d.z};
+    b.assign(b0,b1);
+    if(shaderType==Static)
+      allBoundsOld.r = 0;
+    updateSphere(i);
+    }
+
+  bool groupVisibilityOld(const Frustrum& f) {
+    if(shaderType!=Static)
+      return true;
+    if(allBoundsOld.r<=0) {
+      Vec  bbox[2] = {};
+      bool fisrt=true;
+      for(size_t i=0;i<CAPACITY;++i) {
+        if(!val[i].isValid())
+          continue;
+        auto& b = val[i].bounds;
+        if(fisrt) {
+          bbox[0] = b.bboxTr[0];
+          bbox[1] = b.bboxTr[1];
+          fisrt = false;
+          }
+        bbox[0] = {std::min(bbox[0].x,b.bboxTr[0].x),std::min(bbox[0].y,b.bboxTr[0].y),std::min(bbox[0].z,b.bboxTr[0].z)};
+        bbox[1] = {std::max(bbox[1].x,b.bboxTr[1].x),std::max(bbox[1].y,b.bboxTr[1].y),std::max(bbox[1].z,b.bboxTr[1].z)};
+        }
+      allBoundsOld.assign(bbox[0],bbox[1]);
+      }
+    return f.testPoint(allBoundsOld.midTr.x,allBoundsOld.midTr.y,allBoundsOld.midTr.z,allBoundsOld.r);
+    }
+
+  void visibilityPassOld(const Frustrum& f) {
+    indexOldSz = 0;
+    if(!groupVisibilityOld(f))
+      return;
+    for(size_t i=0; i<valLast; ++i) {
+      auto& v = val[i];
+      if(!v.isValid())
+        continue;
+      if(!f.testPoint(v.bounds.midTr.x,v.bounds.midTr.y,v.bounds.midTr.z,v.bounds.r) && !v.morph)
+        continue;
+      indexOld[indexOldSz] = &v;
+      ++indexOldSz;
+      }
+    }
+
+  void visibilityPassAndOld(const Frustrum& f) {
+    size_t nextSz = 0;
+    for(size_t i=0; i<indexOldSz; ++i) {
+      auto& v = *indexOld[i];
+      if(!f.testPoint(v.bounds.midTr.x,v.bounds.midTr.y,v.bounds.midTr.z,v.bounds.r))
+        continue;
+      indexOld[nextSz] = &v;
+      ++nextSz;
+      }
+    indexOldSz = nextSz;
+    }
+
+  // ObjectsBucket::groupVisibility
+  bool groupVisibility(const Frustrum& f) {
+    for(auto m:morphMask)
+      if(m!=0)
+        return true;
+
+    if(allBounds.r<=0) {
+      Vec  bbox[2] = {};
+      bool fisrt=true;
+      for(size_t i=0;i<valLast;++i) {
+        if(!testBit(validMask,i))
+          continue;
+        const float r  = sphere.r[i];
+        const Vec   b0 = {sphere.x[i]-r, sphere.y[i]-r, sphere.z[i]-r};
+        const Vec   b1 = {sphere.x[i]+r, sphere.y[i]+r, sphere.z[i]+r};
+        if(fisrt) {
+          bbox[0] = b0;
+          bbox[1] = b1;
+          fisrt = false;
+          }
+        bbox[0] = {std::min(bbox[0].x,b0.x),std::min(bbox[0].y,b0.y),std::min(bbox[0].z,b0.z)};
+        bbox[1] = {std::max(bbox[1].x,b1.x),std::max(bbox[1].y,b1.y),std::max(bbox[1].z,b1.z)};
+        }
+      allBounds.assign(bbox[0],bbox[1]);
+      }
+    return f.testPoint(allBounds.midTr.x,allBounds.midTr.y,allBounds.midTr.z,allBounds.r);
+    }
+
+  // ObjectsBucket::visibilityPass
+  void visibilityPass(const Frustrum& f) {
+    indexSz = 0;
+    if(!groupVisibility(f))
+      return;
+
+    uint32_t vis[CAPACITY/32] = {};
+    f.testSpheres(sphere.x,sphere.y,sphere.z,sphere.r,valLast,vis);
+
+    for(size_t i=0; i<valLast; ++i) {
+      if(!testBit(validMask,i))
+        continue;
+      if(!testBit(vis,i) && !testBit(morphMask,i))
+        continue;
+      index[indexSz] = &val[i];
+      ++indexSz;
+      }
+    }
+
+  // ObjectsBucket::visibilityPassAnd
+  void visibilityPassAnd(const Frustrum& f) {
+    uint32_t vis[CAPACITY/32] = {};
+    f.testSpheres(sphere.x,sphere.y,sphere.z,sphere.r,valLast,vis);
+
+    size_t nextSz = 0;
+    for(size_t i=0; i<indexSz; ++i) {
+      auto& v = *index[i];
+      if(!testBit(vis,size_t(std::distance(val,&v))))
+        continue;
+      index[nextSz] = &v;
+      ++nextSz;
+      }
+    indexSz = nextSz;
+    }
+
+  // old index must be part of new one; objects, that only new index has, are not culled by per-object test.
+  // old group bound was aabb of objects, it can cull bucket, while sphere of some object is still in frustum
+  bool checkIndex(const Frustrum& view, const Frustrum& shadow, size_t& extra) const {
+    if(!std::includes(index,index+indexSz,indexOld,indexOld+indexOldSz))
+      return false;
+    for(size_t i=0; i<indexSz; ++i) {
+      auto& v = *index[i];
+      auto& b = v.bounds;
+      if(!view.testPoint(b.midTr.x,b.midTr.y,b.midTr.z,b.r) && !v.morph)
+        return false;
+      if(!shadow.testPoint(b.midTr.x,b.midTr.y,b.midTr.z,b.r))
+        return false;
+      }
+    extra += indexSz-indexOldSz;
+    return true;
+    }
+  };
+
+struct Scene {
+  std::vector<Bucket> bucket;
+  std::vector<size_t> dynamic;
+  std::vector<Vec>    town;
+  std::mt19937        rnd;
+  };
+
+static void mkScene(Scene& sc, size_t buckets, size_t fill, uint32_t seed) {
+  sc.rnd.seed(seed);
+  std::uniform_real_distribution<float> wpos(-50000.f,50000.f);
+  std::normal_distribution<float>       local(0.f,5000.f);
+  std::uniform_real_distribution<float> ext(20.f,1500.f);
+
+  sc.town.resize(24);
+  for(auto& i:sc.town)
+    i = {wpos(sc.rnd),wpos(sc.rnd)*0.05f,wpos(sc.rnd)};
+
+  sc.bucket.resize(buckets);
+  for(size_t id=0; id<buckets; ++id) {
+    auto& b = sc.bucket[id];
+    // most of the buckets are world meshes and static vobs; few are npc and particles
+    const auto kind = sc.rnd()%10;
+    b.shaderType = kind<7 ? Static : (kind<9 ? Animated : Movable);
+    const bool morph = (kind==9 && sc.rnd()%2==0);
+
+    const size_t cnt = 1+sc.rnd()%std::min<size_t>(std::max<size_t>(fill*2,1),CAPACITY);
+    for(size_t i=0; i<cnt; ++i) {
+      // freed slots stay as holes
+      if(i+1<cnt && sc.rnd()%8==0)
+        continue;
+      auto&     v = b.val[i];
+      const Vec t = sc.town[sc.rnd()%sc.town.size()];
+      const Vec c = {t.x+local(sc.rnd),t.y+local(sc.rnd)*0.05f,t.z+local(sc.rnd)};
+      const Vec e = {ext(sc.rnd),ext(sc.rnd),ext(sc.rnd)};
+      v.vboType = morph ? 3 : 1;
+      v.morph   = morph;
+      v.bounds.assign({c.x-e.x,c.y-e.y,c.z-e.z},{c.x+e.x,c.y+e.y,c.z+e.z});
+      setBit(b.validMask,i,true);
+      setBit(b.morphMask,i,morph);
+      b.updateSphere(i);
+      b.valLast = i+1;
+      if(b.shaderType!=Static)
+        sc.dynamic.push_back(id*CAPACITY+i);
+      }
+    }
+  }
+
+// column-major view-projection, same layout as Tempest::Matrix4x4
+static Matrix4x4 mkViewProj(const Vec& eye, float yaw, float pitch, float fov, float zNear, float zFar) {
+  const Vec fw = {std::cos(pitch)*std::sin(yaw),std::sin(pitch),std::cos(pitch)*std::cos(yaw)};
+  Vec       rt = {fw.z,0,-fw.x};
+  const float l = std::sqrt(rt.x*rt.x+rt.z*rt.z);
+  rt = {rt.x/l,0,rt.z/l};
+  const Vec up = {rt.y*fw.z-rt.z*fw.y, rt.z*fw.x-rt.x*fw.z, rt.x*fw.y-rt.y*fw.x};
+
+  const float view[4][4] = {
+    { rt.x, rt.y, rt.z,-(rt.x*eye.x+rt.y*eye.y+rt.z*eye.z)},
+    { up.x, up.y, up.z,-(up.x*eye.x+up.y*eye.y+up.z*eye.z)},
+    {-fw.x,-fw.y,-fw.z, (fw.x*eye.x+fw.y*eye.y+fw.z*eye.z)},
+    {    0,    0,    0, 1},
+    };
+  const float aspect = 16.f/9.f;
+  const float ft     = 1.f/std::tan(fov*0.5f);
+  const float proj[4][4] = {
+    {ft/aspect, 0, 0,                             0},
+    {0,        ft, 0,                             0},
+    {0,         0, (zNear+zFar)/(zNear-zFar),     2*zNear*zFar/(zNear-zFar)},
+    {0,         0,-1,                             0},
+    };
+
+  float m[16] = {};
+  for(int r=0; r<4; ++r)
+    for(int c=0; c<4; ++c) {
+      float v = 0;
+      for(int k=0; k<4; ++k)
+        v += proj[r][k]*view[k][c];
+      m[c*4+r] = v;
+      }
+  return Matrix4x4(m);
+  }
+
+enum Path {
+  P_Walk,  // walking between towns, looking ahead
+  P_Turn,  // standing in town and looking around
+  P_Fly,   // flying high over the world, looking down
+  P_Count
+  };
+
+static const char* pathName(Path p) {
+  switch(p) {
+    case P_Walk:  return "walk";
+    case P_Turn:  return "turn";
+    case P_Fly:   return "fly";
+    case P_Count: break;
+    }
+  return "";
+  }
+
+static void camera(const Scene& sc, Path path, size_t f, size_t frames, Frustrum& view, Frustrum& shadow) {
+  const float pi = float(M_PI);
+  const float t  = float(f)/float(std::max<size_t>(frames,1));
+  Vec         eye;
+  float       yaw = 0, pitch = 0;
+  switch(path) {
+    case P_Walk:
+    case P_Count: {
+      const float  seg = t*float(sc.town.size());
+      const size_t i   = size_t(seg)%sc.town.size();
+      const Vec&   a   = sc.town[i];
+      const Vec&   b   = sc.town[(i+1)%sc.town.size()];
+      const float  k   = seg-std::floor(seg);
+      eye   = {a.x+(b.x-a.x)*k,a.y+(b.y-a.y)*k+180.f,a.z+(b.z-a.z)*k};
+      yaw   = std::atan2(b.x-a.x,b.z-a.z)+0.3f*std::sin(float(f)*0.05f);
+      pitch = -0.1f;
+      break;
+      }
+    case P_Turn: {
+      const Vec& a = sc.town[0];
+      eye   = {a.x,a.y+180.f,a.z};
+      yaw   = t*4.f*pi;
+      pitch = 0.2f*std::sin(t*8.f*pi);
+      break;
+      }
+    case P_Fly: {
+      eye   = {std::sin(t*2.f*pi)*30000.f,8000.f,std::cos(t*2.f*pi)*30000.f};
+      yaw   = t*2.f*pi+pi*0.5f;
+      pitch = -0.5f;
+      break;
+      }
+    }
+  view.make(mkViewProj(eye,yaw,pitch,float(M_PI)/4.f,10.f,40000.f));
+  // shadow pass culls again with wider frustum of the light, that follows the camera
+  shadow.make(mkViewProj({eye.x,eye.y+20000.f,eye.z},yaw,-pi*0.45f,float(M_PI)/2.f,10.f,60000.f));
+  }
+
+struct Stat {
+  double old = 0, cur = 0;
+  size_t visible = 0, shadow = 0, extra = 0, mismatch = 0;
+  };
+
+static Stat replay(Scene& sc, Path path, size_t frames, size_t moving) {
+  Stat st;
+  std::uniform_real_distribution<float> step(-50.f,50.f);
+  for(size_t f=0; f<frames; ++f) {
+    for(size_t i=0; i<moving && !sc.dynamic.empty(); ++i) {
+      const size_t id = sc.dynamic[sc.rnd()%sc.dynamic.size()];
+      sc.bucket[id/CAPACITY].move(id%CAPACITY,{step(sc.rnd),0,step(sc.rnd)});
+      }
+
+    Frustrum view, shadow;
+    camera(sc,path,f,frames,view,shadow);
+
+    auto t0 = Clock::now();
+    for(auto& b:sc.bucket)
+      b.visibilityPassOld(view);
+    for(auto& b:sc.bucket)
+      b.visibilityPassAndOld(shadow);
+    st.old += msSince(t0);
+
+    t0 = Clock::now();
+    for(auto& b:sc.bucket)
+      b.visibilityPass(view);
+    for(auto& b:sc.bucket)
+      b.visibilityPassAnd(shadow);
+    st.cur += msSince(t0);
+
+    for(auto& b:sc.bucket) {
+      if(!b.checkIndex(view,shadow,st.extra))
+        ++st.mismatch;
+      st.shadow += b.indexSz;
+      }
+    // visible count of camera pass alone
+    for(auto& b:sc.bucket) {
+      b.visibilityPass(view);
+      st.visible += b.indexSz;
+      }
+    }
+  return st;
+  }
+
+}
+
+int main(int argc, const char** argv) {
+  try {
+    const size_t   buckets = size_t  (std::stoul(arg(argc,argv,"--buckets","400")));
+    const size_t   fill    = size_t  (std::stoul(arg(argc,argv,"--fill",   "48")));
+    const size_t   frames  = size_t  (std::stoul(arg(argc,argv,"--frames", "2000")));
+    const size_t   moving  = size_t  (std::stoul(arg(argc,argv,"--moving", "20")));
+    const uint32_t seed    = uint32_t(std::stoul(arg(argc,argv,"--seed",   "1")));
+
+    Scene sc;
+    mkScene(sc,buckets,fill,seed);
+    size_t objects = 0;
+    for(auto& b:sc.bucket)
+      for(size_t i=0; i<b.valLast; ++i)
+        objects += b.val[i].isValid() ? 1 : 0;
+    std::printf("%zu buckets, %zu objects (%zu dynamic), %zu moving per frame, %zu frames\n",
+                buckets,objects,sc.dynamic.size(),moving,frames);
+
+    size_t mismatch = 0;
+    for(int p=0; p<P_Count; ++p) {
+      const Stat   st = replay(sc,Path(p),frames,moving);
+      const double n  = double(std::max<size_t>(frames,1));
+      std::printf("  %-5s old %8.4f ms, packed %8.4f ms per frame, x%.2f; %.0f visible, %.0f after shadow pass, %zu not group-culled\n",
+                  pathName(Path(p)),st.old/n,st.cur/n,st.cur>0 ? st.old/st.cur : 0.0,
+                  double(st.visible)/n,double(st.shadow)/n,st.extra);
+      mismatch += st.mismatch;
+      }
+
+    if(mismatch>0) {
+      std::printf("%zu mismatched bucket passes\n",mismatch);
+      return 2;
+      }
+    std::printf("visible sets match\n");
+    return 0;
+    }
+  catch(const std::exception& e) {
+    std::fprintf(stderr,"error: %s\n",e.what());
+    return 1;
+    }
+  }
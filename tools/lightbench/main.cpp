@@ -0,0 +1,370 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <zenload/zenParser.h>
+
+#include "graphics/light.h"
+#include "graphics/lightgrid.h"
+
+// Light selection benchmark and conformance check.
+//
+//   lightbench zen   <world.zen> [--g2] [--loops N] [--max N]
+//   lightbench synth [--lights N] [--queries N] [--seed N] [--loops N] [--max N]
+//
+// 'zen' uses lights of recorded world and bounding boxes of it's vobs as queries.
+// Result of every grid query is compared against brute-force selection over all lights.
+// Timings of kd-tree, that LightGroup used before grid, are reported for comparison.
+
+using namespace Tempest;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Box {
+  Vec3 b0, b1;
+  };
+
+struct Scene {
+  std::vector<Light> light;
+  std::vector<Box>   query;
+  };
+
+static double msSince(Clock::time_point t0) {
+  return std::chrono::duration<double,std::milli>(Clock::now()-t0).count();
+  }
+
+static bool readFile(const char* name, std::vector<uint8_t>& out) {
+  FILE* f = std::fopen(name,"rb");
+  if(f==nullptr)
+    return false;
+  std::fseek(f,0,SEEK_END);
+  out.resize(size_t(std::ftell(f)));
+  std::fseek(f,0,SEEK_SET);
+  const bool ok = std::fread(out.data(),1,out.size(),f)==out.size();
+  std::fclose(f);
+  return ok;
+  }
+
+static const char* arg(int argc, const char** argv, const char* name, const char* def) {
+  for(int i=0; i+1<argc; ++i)
+    if(std::strcmp(argv[i],name)==0)
+      return argv[i+1];
+  return def;
+  }
+
+static bool flag(int argc, const char** argv, const char* name) {
+  for(int i=0; i<argc; ++i)
+    if(std::strcmp(argv[i],name)==0)
+      return true;
+  return false;
+  }
+
+static void collect(const ZenLoad::zCVobData& vob, Scene& sc) {
+  if(vob.vobType==ZenLoad::zCVobData::VT_zCVobLight)
+    sc.light.emplace_back(vob);
+
+  Box b;
+  b.b0 = Vec3(vob.bbox[0].x,vob.bbox[0].y,vob.bbox[0].z);
+  b.b1 = Vec3(vob.bbox[1].x,vob.bbox[1].y,vob.bbox[1].z);
+  if(b.b0.x>b.b1.x || b.b0.y>b.b1.y || b.b0.z>b.b1.z) {
+    const Vec3 p = Vec3(vob.position.x,vob.position.y,vob.position.z);
+    b.b0 = p-Vec3(50,50,50);
+    b.b1 = p+Vec3(50,50,50);
+    }
+  sc.query.push_back(b);
+
+  for(auto& i:vob.childVobs)
+    collect(i,sc);
+  }
+
+static bool loadZen(const char* name, bool isG2, Scene& sc) {
+  std::vector<uint8_t> data;
+  if(!readFile(name,data)) {
+    std::fprintf(stderr,"unable to read \"%s\"\n",name);
+    return false;
+    }
+  ZenLoad::ZenParser   parser(data.data(),data.size());
+  parser.readHeader();
+  ZenLoad::oCWorldData world;
+  parser.readWorld(world,isG2);
+  for(auto& i:world.rootVobs)
+    collect(i,sc);
+  return true;
+  }
+
+static void mkSynth(size_t lights, size_t queries, uint32_t seed, Scene& sc) {
+  // world of gothic size: lights are clustered around 'settlements'
+  std::mt19937                          rnd(seed);
+  std::uniform_real_distribution<float> wpos(-50000.f,50000.f);
+  std::normal_distribution<float>       local(0.f,3000.f);
+  std::uniform_real_distribution<float> range(200.f,2500.f);
+  std::uniform_real_distribution<float> cl(0.f,1.f);
+
+  std::vector<Vec3> town(64);
+  for(auto& i:town)
+    i = Vec3(wpos(rnd),wpos(rnd)*0.05f,wpos(rnd));
+
+  auto point = [&]() {
+    const Vec3& t = town[rnd()%town.size()];
+    return Vec3(t.x+local(rnd),t.y+local(rnd)*0.1f,t.z+local(rnd));
+    };
+
+  for(size_t i=0; i<lights; ++i) {
+    Light l;
+    l.setPosition(point());
+    if(i%8==0) {
+      // flickering fire
+      const float base = range(rnd);
+      l.setRange(std::vector<float>{0.8f,1.f,0.9f,1.1f},base,8.f,true);
+      } else {
+      l.setRange(range(rnd));
+      }
+    l.setColor(Vec3(cl(rnd),cl(rnd),cl(rnd)));
+    sc.light.push_back(std::move(l));
+    }
+
+  std::uniform_real_distribution<float> ext(20.f,400.f);
+  for(size_t i=0; i<queries; ++i) {
+    const Vec3  p = point();
+    const float e = ext(rnd);
+    sc.query.push_back(Box{p-Vec3(e,e,e),p+Vec3(e,e,e)});
+    }
+  }
+
+static bool isIntersected(const Box& a, const Box& b) {
+  return !(a.b1.x<b.b0.x || a.b0.x>b.b1.x ||
+           a.b1.y<b.b0.y || a.b0.y>b.b1.y ||
+           a.b1.z<b.b0.z || a.b0.z>b.b1.z);
+  }
+
+// kd-tree of former LightGroup::mkIndex/implGet: first 'maxOut' lights, that overlap box, in tree order
+struct OldTree {
+  struct Node {
+    std::unique_ptr<Node> next[2];
+    Box                   bbox;
+    const Light**         b = nullptr;
+    size_t                count=0;
+    };
+  Node                      index;
+  std::vector<const Light*> indexPtr;
+
+  void build(const std::vector<Light>& light) {
+    indexPtr.resize(light.size());
+    for(size_t i=0; i<indexPtr.size(); ++i)
+      indexPtr[i] = &light[i];
+    mkIndex(index,indexPtr.data(),indexPtr.size(),0);
+    }
+
+  size_t get(const Box& area, const Light** out, size_t maxOut) const {
+    if(index.count==0)
+      return 0;
+    return implGet(index,area,out,maxOut);
+    }
+
+  void mkIndex(Node& id, const Light** b, size_t count, int depth) {
+    id.b     = b;
+    id.count = count;
+
+    if(count==1) {
+      auto& p = (**b).position();
+      float r = (**b).range();
+      id.bbox = Box{p-Vec3(r,r,r),p+Vec3(r,r,r)};
+      return;
+      }
+
+    depth%=3;
+    std::sort(b,b+count,[depth](const Light* a,const Light* b){
+      auto& pa = a->position();
+      auto& pb = b->position();
+      return depth==0 ? pa.x<pb.x : (depth==1 ? pa.y<pb.y : pa.z<pb.z);
+      });
+
+    size_t half = count/2;
+    if(half>0) {
+      if(id.next[0]==nullptr)
+        id.next[0].reset(new Node());
+      mkIndex(*id.next[0],b,half,depth+1);
+      } else {
+      id.next[0].reset();
+      }
+    if(count-half>0) {
+      if(id.next[1]==nullptr)
+        id.next[1].reset(new Node());
+      mkIndex(*id.next[1],b+half,count-half,depth+1);
+      } else {
+      id.next[1].reset();
+      }
+
+    if(id.next[0]!=nullptr && id.next[1]!=nullptr) {
+      auto& a = id.next[0]->bbox;
+      auto& c = id.next[1]->bbox;
+      id.bbox.b0 = Vec3(std::min(a.b0.x,c.b0.x),std::min(a.b0.y,c.b0.y),std::min(a.b0.z,c.b0.z));
+      id.bbox.b1 = Vec3(std::max(a.b1.x,c.b1.x),std::max(a.b1.y,c.b1.y),std::max(a.b1.z,c.b1.z));
+      }
+    else if(id.next[0]!=nullptr)
+      id.bbox = id.next[0]->bbox;
+    else if(id.next[1]!=nullptr)
+      id.bbox = id.next[1]->bbox;
+    }
+
+  size_t implGet(const Node& index, const Box& area, const Light** out, size_t maxOut) const {
+    const Node* cur = &index;
+    if(maxOut==0)
+      return 0;
+    while(true) {
+      if(cur->next[0]==nullptr && cur->next[1]==nullptr) {
+        size_t cnt = std::min(cur->count,maxOut);
+        for(size_t i=0; i<cnt; ++i)
+          out[i] = cur->b[i];
+        return cnt;
+        }
+
+      bool l = cur->next[0]!=nullptr && isIntersected(cur->next[0]->bbox,area);
+      bool r = cur->next[1]!=nullptr && isIntersected(cur->next[1]->bbox,area);
+      if(l && r) {
+        size_t cnt0 = implGet(*cur->next[0],area,out,     maxOut);
+        size_t cnt1 = implGet(*cur->next[1],area,out+cnt0,maxOut-cnt0);
+        return cnt0+cnt1;
+        }
+      else if(l) {
+        cur = cur->next[0].get();
+        }
+      else if(r) {
+        cur = cur->next[1].get();
+        }
+      else {
+        return 0;
+        }
+      }
+    }
+  };
+
+static size_t bruteForce(const std::vector<Light>& light, const Box& b, const Light** out, size_t maxOut) {
+  static std::vector<std::pair<float,uint32_t>> cand;
+  cand.clear();
+  for(size_t i=0; i<light.size(); ++i) {
+    const float k = LightGrid::weight(light[i],b.b0,b.b1);
+    if(k>0.f)
+      cand.emplace_back(k,uint32_t(i));
+    }
+  std::sort(cand.begin(),cand.end(),[](const std::pair<float,uint32_t>& a, const std::pair<float,uint32_t>& b){
+    if(a.first!=b.first)
+      return a.first>b.first;
+    return a.second<b.second;
+    });
+  const size_t cnt = std::min(cand.size(),maxOut);
+  for(size_t i=0; i<cnt; ++i)
+    out[i] = &light[cand[i].second];
+  return cnt;
+  }
+
+static int run(Scene& sc, int loops, size_t maxOut) {
+  size_t dynamic = 0;
+  for(auto& l:sc.light)
+    if(l.isDynamic())
+      ++dynamic;
+  std::printf("%zu lights (%zu dynamic), %zu queries, top %zu\n",sc.light.size(),dynamic,sc.query.size(),maxOut);
+
+  LightGrid grid;
+  auto      t0 = Clock::now();
+  for(int i=0; i<loops; ++i)
+    grid.build(sc.light);
+  const double tBuild = msSince(t0)/loops;
+
+  std::vector<const Light*> ref(maxOut), res(maxOut);
+  size_t found = 0, mismatch = 0;
+  for(size_t i=0; i<sc.query.size(); ++i) {
+    auto&  q    = sc.query[i];
+    size_t cRef = bruteForce(sc.light,q,ref.data(),maxOut);
+    size_t cRes = grid.getStrongest(sc.light,q.b0,q.b1,res.data(),maxOut);
+    found += cRes;
+    if(cRef==cRes && std::equal(ref.begin(),ref.begin()+ptrdiff_t(cRef),res.begin()))
+      continue;
+    if(mismatch==0)
+      std::printf("mismatch at query %zu: %zu lights, expected %zu\n",i,cRes,cRef);
+    ++mismatch;
+    }
+
+  size_t sink = 0;
+  t0 = Clock::now();
+  for(int l=0; l<loops; ++l)
+    for(auto& q:sc.query)
+      sink += grid.getStrongest(sc.light,q.b0,q.b1,res.data(),maxOut);
+  const double tGrid = msSince(t0)/loops;
+
+  t0 = Clock::now();
+  for(auto& q:sc.query)
+    sink += bruteForce(sc.light,q,ref.data(),maxOut);
+  const double tBrute = msSince(t0);
+
+  OldTree tree;
+  t0 = Clock::now();
+  for(int i=0; i<loops; ++i)
+    tree.build(sc.light);
+  const double tTreeBuild = msSince(t0)/loops;
+
+  size_t foundTree = 0;
+  t0 = Clock::now();
+  for(int l=0; l<loops; ++l)
+    for(auto& q:sc.query)
+      foundTree += tree.get(q,res.data(),maxOut);
+  const double tTree = msSince(t0)/loops;
+
+  const double nq = double(std::max<size_t>(sc.query.size(),1));
+  std::printf("  %-12s %10s %12s %12s\n","","build, ms","query, ms","ns/query");
+  std::printf("  %-12s %10.3f %12.3f %12.1f\n","grid",    tBuild,    tGrid, tGrid *1e6/nq);
+  std::printf("  %-12s %10.3f %12.3f %12.1f\n","old tree",tTreeBuild,tTree, tTree *1e6/nq);
+  std::printf("  %-12s %10s %12.3f %12.1f\n","brute",   "-",       tBrute,tBrute*1e6/nq);
+  std::printf("  avg lights: grid %.2f, old tree %.2f (unsorted, box overlap)\n",
+              double(found)/nq,double(foundTree)/double(loops)/nq);
+  if(sink==size_t(-1))
+    std::printf("\n");
+
+  if(mismatch>0) {
+    std::printf("%zu mismatched queries\n",mismatch);
+    return 2;
+    }
+  std::printf("brute-force match\n");
+  return 0;
+  }
+
+}
+
+int main(int argc, const char** argv) {
+  if(argc<2) {
+    std::fprintf(stderr,"usage:\n"
+                        "  lightbench zen   <world.zen> [--g2] [--loops N] [--max N]\n"
+                        "  lightbench synth [--lights N] [--queries N] [--seed N] [--loops N] [--max N]\n");
+    return 1;
+    }
+  try {
+    const int    loops  = std::max(1,std::stoi(arg(argc,argv,"--loops","10")));
+    const size_t maxOut = size_t(std::stoul(arg(argc,argv,"--max","64")));
+    Scene        sc;
+    if(std::strcmp(argv[1],"zen")==0 && argc>2) {
+      if(!loadZen(argv[2],flag(argc,argv,"--g2"),sc))
+        return 1;
+      return run(sc,loops,maxOut);
+      }
+    if(std::strcmp(argv[1],"synth")==0) {
+      mkSynth(size_t  (std::stoul(arg(argc,argv,"--lights", "4000"))),
+              size_t  (std::stoul(arg(argc,argv,"--queries","50000"))),
+              uint32_t(std::stoul(arg(argc,argv,"--seed",   "1"))),sc);
+      return run(sc,loops,maxOut);
+      }
+    }
+  catch(const std::exception& e) {
+    std::fprintf(stderr,"error: %s\n",e.what());
+    return 1;
+    }
+  std::fprintf(stderr,"unknown command \"%s\"\n",argv[1]);
+  return 1;
+  }
@@ -0,0 +1,602 @@
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <list>
+#include <memory>
+#include <random>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <zenload/zenParser.h>
+
+#include "world/waymatrix.h"
+
+// Path finding benchmark and conformance check.
+//
+//   pathbench zen   <world.zen> [--g2] [--routines <file.d>] [--npcs N] [--days N] [--seed N]
+//   pathbench synth [--npcs N] [--days N] [--seed N]
+//
+// Queries are start/end pairs of npc daily routines, replayed slot by slot, like world clock does.
+// '--routines' takes daedalus source(all of Rtn_* functions can be concatenated into one file);
+// without it, routines of few nearby waypoints are generated for '--npcs' npcs.
+// A* is timed cold(every distinct pair once, all misses of path cache) and on full replay with
+// LRU cache, warm and cold. Former wave expansion of WayMatrix::wayTo is timed on same stream.
+// Length of every A* path is compared against Dijkstra over same waynet.
+
+using namespace Tempest;
+
+World& headlessWorld();
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+static const int64_t NoPath  = -1;
+static const int64_t BadPath = -2;
+static const size_t  CacheSz = 512; // WayMatrix::PathCacheSize
+
+struct Query {
+  uint32_t a = 0, b = 0;
+  bool operator == (const Query& q) const { return a==q.a && b==q.b; }
+  };
+
+struct QueryHash {
+  size_t operator()(const Query& q) const { return std::hash<uint64_t>()((uint64_t(q.a)<<32) | q.b); }
+  };
+
+struct Scene {
+  ZenLoad::zCWayNetData                     dat;
+  std::vector<WayPoint>                     wp;     // reference graph, connected as in WayMatrix::buildIndex
+  std::unordered_map<std::string,uint32_t>  byName; // unique names only
+  std::vector<uint32_t>                     named;
+  std::vector<std::vector<uint32_t>>        routine;
+  std::vector<Query>                        stream;
+  };
+
+static double msSince(Clock::time_point t0) {
+  return std::chrono::duration<double,std::milli>(Clock::now()-t0).count();
+  }
+
+static bool readFile(const char* name, std::vector<uint8_t>& out) {
+  FILE* f = std::fopen(name,"rb");
+  if(f==nullptr)
+    return false;
+  std::fseek(f,0,SEEK_END);
+  out.resize(size_t(std::ftell(f)));
+  std::fseek(f,0,SEEK_SET);
+  const bool ok = std::fread(out.data(),1,out.size(),f)==out.size();
+  std::fclose(f);
+  return ok;
+  }
+
+static const char* arg(int argc, const char** argv, const char* name, const char* def) {
+  for(int i=0; i+1<argc; ++i)
+    if(std::strcmp(argv[i],name)==0)
+      return argv[i+1];
+  return def;
+  }
+
+static bool flag(int argc, const char** argv, const char* name) {
+  for(int i=0; i<argc; ++i)
+    if(std::strcmp(argv[i],name)==0)
+      return true;
+  return false;
+  }
+
+static std::string upcase(std::string s) {
+  for(auto& i:s)
+    i = char(std::toupper(i));
+  return s;
+  }
+
+static uint32_t idOf(const Scene& sc, const WayPoint& w) {
+  return uint32_t(std::distance<const WayPoint*>(sc.wp.data(),&w));
+  }
+
+static void mkGraph(Scene& sc) {
+  auto& dat = sc.dat;
+  sc.wp.resize(dat.waypoints.size());
+  for(size_t i=0; i<sc.wp.size(); ++i)
+    sc.wp[i] = WayPoint(dat.waypoints[i]);
+  for(auto& i:dat.edges) {
+    if(i.first<sc.wp.size() && i.second<sc.wp.size()) {
+      sc.wp[i.first ].connect(sc.wp[i.second]);
+      sc.wp[i.second].connect(sc.wp[i.first ]);
+      }
+    }
+
+  // start points have a copy in WayMatrix, that findPoint prefers; duplicated names are ambiguous
+  std::unordered_map<std::string,size_t> count;
+  for(auto& w:sc.wp)
+    count[w.name.c_str()]++;
+  for(size_t i=0; i<sc.wp.size(); ++i) {
+    std::string name = sc.wp[i].name.c_str();
+    if(count[name]!=1 || name.find("START")!=std::string::npos)
+      continue;
+    sc.byName[name] = uint32_t(i);
+    sc.named.push_back(uint32_t(i));
+    }
+  }
+
+static bool loadZen(const char* name, bool isG2, Scene& sc) {
+  std::vector<uint8_t> data;
+  if(!readFile(name,data)) {
+    std::fprintf(stderr,"unable to read \"%s\"\n",name);
+    return false;
+    }
+  ZenLoad::ZenParser   parser(data.data(),data.size());
+  parser.readHeader();
+  ZenLoad::oCWorldData world;
+  parser.readWorld(world,isG2);
+  sc.dat = std::move(world.waynet);
+  mkGraph(sc);
+  return true;
+  }
+
+// every TA_*(h,m,h,m,"WP") of Rtn_* function is one slot of routine
+static bool loadRoutines(const char* name, Scene& sc) {
+  std::ifstream fin(name);
+  if(!fin) {
+    std::fprintf(stderr,"unable to read \"%s\"\n",name);
+    return false;
+    }
+  static const std::regex rtn("func\\s+void\\s+rtn_\\w+",std::regex::icase);
+  static const std::regex ta ("ta_\\w+\\s*\\(\\s*\\d+\\s*,\\s*\\d+\\s*,\\s*\\d+\\s*,\\s*\\d+\\s*,\\s*\"([^\"]+)\"",std::regex::icase);
+
+  std::vector<uint32_t> cur;
+  auto flush = [&]() {
+    if(cur.size()>1)
+      sc.routine.push_back(std::move(cur));
+    cur.clear();
+    };
+
+  std::string line;
+  size_t      unknown = 0;
+  while(std::getline(fin,line)) {
+    if(std::regex_search(line,rtn)) {
+      flush();
+      continue;
+      }
+    std::smatch m;
+    if(!std::regex_search(line,m,ta))
+      continue;
+    auto it = sc.byName.find(upcase(m[1].str()));
+    if(it==sc.byName.end()) {
+      ++unknown; // free point, or not a part of this world
+      continue;
+      }
+    cur.push_back(it->second);
+    }
+  flush();
+  std::printf("%zu routines, %zu slots skipped(not a waypoint)\n",sc.routine.size(),unknown);
+  return true;
+  }
+
+// home and few points around it, sometimes a trip to far away place
+static void mkRoutines(size_t npcs, std::mt19937& rnd, Scene& sc) {
+  if(sc.named.size()<2)
+    return;
+  const float R = 5000.f;
+  auto any = [&]() {
+    return sc.named[rnd()%sc.named.size()];
+    };
+  for(size_t i=0; i<npcs; ++i) {
+    std::vector<uint32_t> r;
+    const WayPoint& home = sc.wp[any()];
+    r.push_back(idOf(sc,home));
+    const size_t len = 2+rnd()%4;
+    while(r.size()<len) {
+      uint32_t id = any();
+      if(rnd()%5!=0) {
+        for(int t=0; t<64 && home.qDistTo(sc.wp[id].x,sc.wp[id].y,sc.wp[id].z)>R*R; ++t)
+          id = any();
+        }
+      r.push_back(id);
+      }
+    sc.routine.push_back(std::move(r));
+    }
+  }
+
+static void mkStream(size_t days, Scene& sc) {
+  size_t slots = 0;
+  for(auto& r:sc.routine)
+    slots = std::max(slots,r.size());
+  for(size_t d=0; d<days; ++d)
+    for(size_t s=0; s<slots; ++s)
+      for(auto& r:sc.routine) {
+        Query q;
+        q.a = r[ s   %r.size()];
+        q.b = r[(s+1)%r.size()];
+        if(q.a!=q.b)
+          sc.stream.push_back(q);
+        }
+  }
+
+// towns of jittered grid of streets, connected by roads
+static void mkSynth(uint32_t seed, Scene& sc) {
+  std::mt19937                          rnd(seed);
+  std::uniform_real_distribution<float> wpos(-50000.f,50000.f);
+  std::uniform_real_distribution<float> jitter(-150.f,150.f);
+  std::uniform_real_distribution<float> cl(0.f,1.f);
+
+  auto& dat = sc.dat;
+  auto  add = [&](float x, float y, float z, const std::string& name) {
+    ZenLoad::zCWaypointData w;
+    w.wpName     = name;
+    w.position.x = x;
+    w.position.y = y;
+    w.position.z = z;
+    dat.waypoints.push_back(w);
+    return dat.waypoints.size()-1;
+    };
+
+  const size_t towns = 32, side = 12;
+  const float  step  = 600.f;
+  std::vector<size_t> center(towns);
+  std::vector<ZMath::float3> tpos(towns);
+  for(size_t t=0; t<towns; ++t) {
+    tpos[t] = {wpos(rnd),wpos(rnd)*0.02f,wpos(rnd)};
+    const size_t base = dat.waypoints.size();
+    for(size_t i=0; i<side; ++i)
+      for(size_t r=0; r<side; ++r) {
+        const float x = tpos[t].x+(float(i)-float(side)*0.5f)*step+jitter(rnd);
+        const float z = tpos[t].z+(float(r)-float(side)*0.5f)*step+jitter(rnd);
+        add(x,tpos[t].y+jitter(rnd)*0.2f,z,"T"+std::to_string(t)+"_"+std::to_string(i)+"_"+std::to_string(r));
+        // some of streets are blocked
+        if(i>0 && cl(rnd)<0.9f)
+          dat.edges.emplace_back(base+(i-1)*side+r,base+i*side+r);
+        if(r>0 && cl(rnd)<0.9f)
+          dat.edges.emplace_back(base+i*side+r-1,base+i*side+r);
+        }
+    center[t] = base+(side/2)*side+side/2;
+    }
+
+  // every town is connected to nearest of previous ones
+  for(size_t t=1; t<towns; ++t) {
+    size_t near = 0;
+    float  dist = std::numeric_limits<float>::max();
+    for(size_t i=0; i<t; ++i) {
+      const float dx = tpos[i].x-tpos[t].x, dz = tpos[i].z-tpos[t].z;
+      if(dx*dx+dz*dz<dist) {
+        dist = dx*dx+dz*dz;
+        near = i;
+        }
+      }
+    auto&        a    = dat.waypoints[center[t]].position;
+    auto&        b    = dat.waypoints[center[near]].position;
+    const size_t cnt  = size_t(std::sqrt(dist)/800.f);
+    size_t       prev = center[t];
+    for(size_t i=1; i<cnt; ++i) {
+      const float  k  = float(i)/float(cnt);
+      const size_t id = add(a.x+(b.x-a.x)*k+jitter(rnd),a.y+(b.y-a.y)*k,a.z+(b.z-a.z)*k+jitter(rnd),
+                            "ROAD_"+std::to_string(t)+"_"+std::to_string(i));
+      dat.edges.emplace_back(prev,id);
+      prev = id;
+      }
+    dat.edges.emplace_back(prev,center[near]);
+    }
+  mkGraph(sc);
+  }
+
+// reference: Dijkstra over all connections
+static int64_t shortest(const Scene& sc, uint32_t start, uint32_t end) {
+  using Open = std::pair<int64_t,uint32_t>;
+  std::vector<int64_t> len(sc.wp.size(),std::numeric_limits<int64_t>::max());
+  std::vector<Open>    open;
+  auto                 cmp = std::greater<Open>();
+  len[start] = 0;
+  open.push_back({0,start});
+  while(open.size()>0) {
+    std::pop_heap(open.begin(),open.end(),cmp);
+    const Open top = open.back();
+    open.pop_back();
+    if(top.first!=len[top.second])
+      continue;
+    if(top.second==end)
+      return top.first;
+    for(auto& i:sc.wp[top.second].connections()) {
+      const uint32_t n  = idOf(sc,*i.point);
+      const int64_t  l1 = top.first+i.len;
+      if(l1<len[n]) {
+        len[n] = l1;
+        open.push_back({l1,n});
+        std::push_heap(open.begin(),open.end(),cmp);
+        }
+      }
+    }
+  return NoPath;
+  }
+
+// former WayMatrix::wayTo: wave expansion stops, as soon as end is reached, backtracking is greedy
+struct OldWave {
+  std::vector<uint32_t> gen;
+  std::vector<int32_t>  len;
+  std::vector<uint32_t> stk[2];
+  uint32_t              curGen = 0;
+  };
+
+static bool oldWayTo(const Scene& sc, OldWave& s, uint32_t start, uint32_t end, std::vector<uint32_t>& out) {
+  out.clear();
+  if(s.gen.size()!=sc.wp.size()) {
+    s.gen.assign(sc.wp.size(),0);
+    s.len.assign(sc.wp.size(),0);
+    s.curGen = 0;
+    }
+  s.curGen++;
+  if(s.curGen==1)
+    std::fill(s.gen.begin(),s.gen.end(),0);
+  s.len[start] = 0;
+  s.gen[start] = s.curGen;
+
+  auto* front = &s.stk[0];
+  auto* back  = &s.stk[1];
+  front->clear();
+  back ->clear();
+  front->push_back(start);
+
+  while(s.gen[end]!=s.curGen && front->size()>0) {
+    for(auto id:*front) {
+      const int32_t l0 = s.len[id];
+      for(auto& i:sc.wp[id].connections()) {
+        const uint32_t n  = idOf(sc,*i.point);
+        const int32_t  l1 = l0+i.len;
+        if(s.gen[n]!=s.curGen || s.len[n]>l1) {
+          s.len[n] = l1;
+          s.gen[n] = s.curGen;
+          back->push_back(n);
+          }
+        }
+      }
+    std::swap(front,back);
+    back->clear();
+    }
+
+  out.push_back(end);
+  uint32_t cur = end;
+  while(cur!=start) {
+    const int32_t l0   = s.len[cur];
+    int32_t       l1   = l0;
+    uint32_t      next = uint32_t(-1);
+    for(auto& i:sc.wp[cur].connections()) {
+      const uint32_t n = idOf(sc,*i.point);
+      if(s.gen[n]==s.curGen && s.len[n]+i.len<=l0 && s.len[n]<l1) {
+        next = n;
+        l1   = s.len[n];
+        }
+      }
+    if(next==uint32_t(-1)) {
+      out.clear();
+      return false;
+      }
+    out.push_back(next);
+    cur = next;
+    }
+  return true;
+  }
+
+static int32_t connLen(const WayPoint& a, const WayPoint& b) {
+  int32_t ret = -1;
+  for(auto& i:a.connections())
+    if(i.point==&b && (ret<0 || i.len<ret))
+      ret = i.len;
+  return ret;
+  }
+
+// length of path, that must lead from start to end over existing connections
+static int64_t pathLen(WayPath p, const WayPoint& start, const WayPoint& end) {
+  if(p.last()==nullptr)
+    return NoPath;
+  const WayPoint* prev = p.pop();
+  if(prev!=&start)
+    return BadPath;
+  int64_t len = 0;
+  while(auto w = p.pop()) {
+    const int32_t l = connLen(*prev,*w);
+    if(l<0)
+      return BadPath;
+    len += l;
+    prev = w;
+    }
+  return prev==&end ? len : BadPath;
+  }
+
+static int64_t pathLen(const Scene& sc, const std::vector<uint32_t>& p, uint32_t start, uint32_t end) {
+  if(p.size()==0)
+    return NoPath;
+  if(p.back()!=start || p.front()!=end)
+    return BadPath;
+  int64_t len = 0;
+  for(size_t i=1; i<p.size(); ++i) {
+    const int32_t l = connLen(sc.wp[p[i]],sc.wp[p[i-1]]);
+    if(l<0)
+      return BadPath;
+    len += l;
+    }
+  return len;
+  }
+
+// same policy, as WayMatrix path cache
+static size_t cacheHits(const std::vector<Query>& stream) {
+  std::list<Query>                                                lru;
+  std::unordered_map<Query,std::list<Query>::iterator,QueryHash> map;
+  size_t                                                          hits = 0;
+  for(auto& q:stream) {
+    auto it = map.find(q);
+    if(it!=map.end()) {
+      lru.splice(lru.begin(),lru,it->second);
+      ++hits;
+      continue;
+      }
+    lru.push_front(q);
+    map[q] = lru.begin();
+    if(lru.size()>CacheSz) {
+      map.erase(lru.back());
+      lru.pop_back();
+      }
+    }
+  return hits;
+  }
+
+struct Matrix {
+  std::unique_ptr<WayMatrix>   wm;
+  std::vector<const WayPoint*> pt; // reference id to point of matrix
+
+  explicit Matrix(Scene& sc) {
+    wm.reset(new WayMatrix(headlessWorld(),sc.dat));
+    wm->buildIndex();
+    pt.resize(sc.wp.size(),nullptr);
+    for(auto id:sc.named)
+      pt[id] = wm->findPoint(sc.wp[id].name.c_str(),false);
+    }
+
+  WayPath wayTo(const Query& q) const { return wm->wayTo(*pt[q.a],*pt[q.b]); }
+  };
+
+static double perQuery(double ms, size_t n) {
+  return n>0 ? ms/double(n) : 0.0;
+  }
+
+static int run(Scene& sc, size_t days) {
+  mkStream(days,sc);
+
+  std::vector<Query> unique;
+  {
+  std::unordered_map<Query,size_t,QueryHash> seen;
+  for(auto& q:sc.stream)
+    if(seen[q]++==0)
+      unique.push_back(q);
+  }
+
+  std::printf("waynet: %zu points, %zu edges; %zu routines, %zu queries, %zu distinct pairs(path cache %zu)\n",
+              sc.wp.size(),sc.dat.edges.size(),sc.routine.size(),sc.stream.size(),unique.size(),CacheSz);
+  if(sc.stream.size()==0) {
+    std::fprintf(stderr,"no queries\n");
+    return 1;
+    }
+
+  // found paths are reported, so no query can be optimized out
+  size_t nCold = 0, nStream = 0, nWarm = 0, nOld = 0;
+  double tCold = 0, tStream = 0, tWarm = 0, tOld = 0;
+  {
+  Matrix m(sc);
+  auto   t0 = Clock::now();
+  for(auto& q:unique)
+    nCold += m.wayTo(q).last()!=nullptr ? 1 : 0;
+  tCold = msSince(t0);
+  }
+  {
+  Matrix m(sc);
+  auto   t0 = Clock::now();
+  for(auto& q:sc.stream)
+    nStream += m.wayTo(q).last()!=nullptr ? 1 : 0;
+  tStream = msSince(t0);
+
+  t0 = Clock::now();
+  for(auto& q:sc.stream)
+    nWarm += m.wayTo(q).last()!=nullptr ? 1 : 0;
+  tWarm = msSince(t0);
+  }
+  {
+  OldWave               s;
+  std::vector<uint32_t> path;
+  auto                  t0 = Clock::now();
+  for(auto& q:sc.stream)
+    nOld += oldWayTo(sc,s,q.a,q.b,path) ? 1 : 0;
+  tOld = msSince(t0);
+  }
+
+  const size_t hits = cacheHits(sc.stream);
+  std::printf("  A* cold   %8.4f ms per query, %zu paths, every pair once, uncached\n",perQuery(tCold,unique.size()),nCold);
+  std::printf("  A* replay %8.4f ms per query, %zu paths, %.1f%% cache hits\n",perQuery(tStream,sc.stream.size()),nStream,
+              100.0*double(hits)/double(sc.stream.size()));
+  std::printf("  A* warm   %8.4f ms per query, %zu paths, second replay\n",perQuery(tWarm,sc.stream.size()),nWarm);
+  std::printf("  wave      %8.4f ms per query, %zu paths, x%.2f of A* replay\n",perQuery(tOld,sc.stream.size()),nOld,
+              tStream>0 ? tOld/tStream : 0.0);
+
+  // conformance is checked on distinct pairs, outside of timings
+  Matrix                m(sc);
+  OldWave               s;
+  std::vector<uint32_t> path;
+  size_t                mismatch = 0, longer = 0, unreachable = 0;
+  double                excess   = 0;
+  for(auto& q:unique) {
+    const int64_t ref = shortest(sc,q.a,q.b);
+    const int64_t la  = pathLen(m.wayTo(q),*m.pt[q.a],*m.pt[q.b]);
+    oldWayTo(sc,s,q.a,q.b,path);
+    const int64_t lo  = pathLen(sc,path,q.a,q.b);
+    if(ref==NoPath)
+      ++unreachable;
+    if(la!=ref) {
+      if(mismatch<8)
+        std::printf("  A* mismatch %s -> %s: %lld, expected %lld\n",sc.wp[q.a].name.c_str(),sc.wp[q.b].name.c_str(),
+                    (long long)la,(long long)ref);
+      ++mismatch;
+      }
+    if(lo==BadPath || (lo==NoPath)!=(ref==NoPath) || (ref!=NoPath && lo<ref)) {
+      if(mismatch<8)
+        std::printf("  wave mismatch %s -> %s: %lld, expected %lld\n",sc.wp[q.a].name.c_str(),sc.wp[q.b].name.c_str(),
+                    (long long)lo,(long long)ref);
+      ++mismatch;
+      }
+    else if(ref>0 && lo>ref) {
+      ++longer;
+      excess += double(lo-ref)/double(ref);
+      }
+    }
+  std::printf("  %zu unreachable pairs; %zu paths of wave expansion are longer than shortest, by %.1f%% on average\n",
+              unreachable,longer,longer>0 ? 100.0*excess/double(longer) : 0.0);
+
+  if(mismatch>0) {
+    std::printf("%zu mismatched paths\n",mismatch);
+    return 2;
+    }
+  std::printf("path lengths match\n");
+  return 0;
+  }
+
+}
+
+int main(int argc, const char** argv) {
+  if(argc<2) {
+    std::fprintf(stderr,"usage: pathbench zen <world.zen> [--g2] [--routines <file.d>] | synth [--npcs N] [--days N] [--seed N]\n");
+    return 1;
+    }
+
+  try {
+    const size_t   npcs = size_t  (std::stoul(arg(argc,argv,"--npcs","800")));
+    const size_t   days = size_t  (std::stoul(arg(argc,argv,"--days","4")));
+    const uint32_t seed = uint32_t(std::stoul(arg(argc,argv,"--seed","1")));
+    std::mt19937   rnd(seed);
+
+    Scene sc;
+    if(std::strcmp(argv[1],"zen")==0 && argc>2) {
+      if(!loadZen(argv[2],flag(argc,argv,"--g2"),sc))
+        return 1;
+      if(auto rtn = arg(argc,argv,"--routines",nullptr)) {
+        if(!loadRoutines(rtn,sc))
+          return 1;
+        } else {
+        mkRoutines(npcs,rnd,sc);
+        }
+      return run(sc,days);
+      }
+    if(std::strcmp(argv[1],"synth")==0) {
+      mkSynth(seed,sc);
+      mkRoutines(npcs,rnd,sc);
+      return run(sc,days);
+      }
+    }
+  catch(const std::exception& e) {
+    std::fprintf(stderr,"error: %s\n",e.what());
+    return 1;
+    }
+  std::fprintf(stderr,"unknown command \"%s\"\n",argv[1]);
+  return 1;
+  }
@@ -0,0 +1,39 @@
+#include "world/world.h"
+#include "game/movealgo.h"
+#include "game/serialize.h"
+#include "utils/gthfont.h"
+#include "resources.h"
+
+#include <stdexcept>
+
+// World members, that path benchmark links against: WayMatrix is built without world, physics and fonts
+
+World& headlessWorld() {
+  // world is never constructed: zero storage has no physics, so waypoints stay as they are in waynet
+  alignas(World) static char storage[sizeof(World)] = {};
+  return *reinterpret_cast<World*>(storage);
+  }
+
+DynamicWorld::RayResult DynamicWorld::dropRay(float x, float y, float z) const {
+  RayResult r;
+  r.v = Tempest::Vec3(x,y,z);
+  return r;
+  }
+
+const GthFont& Resources::font() {
+  throw std::logic_error("no fonts in headless tool");
+  }
+
+void GthFont::drawText(Tempest::Painter&, int, int, const char*) const {
+  }
+
+bool MoveAlgo::isClose(float x, float y, float z, const WayPoint& p) {
+  return p.qDistTo(x,y,z)<10.f*10.f;
+  }
+
+void Serialize::write(const WayPoint*) {
+  }
+
+void Serialize::read(const WayPoint*& wptr) {
+  wptr = nullptr;
+  }
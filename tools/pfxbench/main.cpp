@@ -0,0 +1,344 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "graphics/pfxmath.h"
+#include "utils/workers.h"
+
+// Particle simulation benchmark and conformance check.
+//
+//   pfxbench [--emitters N] [--kinds N] [--frames N] [--seed N]
+//
+// Replays simulation part of PfxObjects::tick: emitters of few particle kinds(buckets), each with it's own block
+// of particles, aged, integrated and emitted every frame. Soa state with pfxIntegrate, serial and on workers,
+// is compared bit-exact against per-particle aos tick, that PfxObjects used before.
+
+using namespace Tempest;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point t0) {
+  return std::chrono::duration<double,std::milli>(Clock::now()-t0).count();
+  }
+
+static const char* arg(int argc, const char** argv, const char* name, const char* def) {
+  for(int i=0; i+1<argc; ++i)
+    if(std::strcmp(argv[i],name)==0)
+      return argv[i+1];
+  return def;
+  }
+
+// former PfxObjects::ParState
+struct OldPar {
+  uint16_t life=0, maxLife=1;
+  Vec3     pos, dir;
+  float    velocity=0;
+  float    rotation=0;
+  };
+
+// particles in same layout as PfxObjects::ParState
+struct SoaPar {
+  std::vector<uint16_t> life, maxLife;
+  std::vector<float>    posX, posY, posZ;
+  std::vector<float>    dirX, dirY, dirZ;
+  std::vector<float>    velocity, rotation;
+
+  void resize(size_t sz) {
+    life    .resize(sz);
+    maxLife .resize(sz,1);
+    posX    .resize(sz);
+    posY    .resize(sz);
+    posZ    .resize(sz);
+    dirX    .resize(sz);
+    dirY    .resize(sz);
+    dirZ    .resize(sz);
+    velocity.resize(sz);
+    rotation.resize(sz);
+    }
+
+  void reset(size_t i) {
+    life[i]     = 0;
+    maxLife[i]  = 1;
+    posX[i]     = posY[i] = posZ[i] = 0;
+    dirX[i]     = dirY[i] = dirZ[i] = 0;
+    velocity[i] = 0;
+    rotation[i] = 0;
+    }
+  };
+
+struct Block {
+  uint64_t timeTotal = 0;
+  size_t   offset    = 0;
+  size_t   count     = 0;
+  Vec3     pos;
+  };
+
+// one particle kind: ParticleFx and emitters of it
+struct Bucket {
+  float              lspPartAvg = 0, lspPartVar = 0;
+  float              velAvg     = 0, velVar     = 0;
+  float              ppsValue   = 0;
+  Vec3               flyGravity;
+  size_t             blockSize  = 0;
+
+  std::vector<Block> block;
+  std::mt19937       rnd;
+
+  std::vector<OldPar> aos;
+  SoaPar             soa;
+  };
+
+static float randf(std::mt19937& rnd) {
+  return float(rnd()>>8)*(1.f/16777216.f);
+  }
+
+static float randf(std::mt19937& rnd, float base, float var) {
+  return (2.f*randf(rnd)-1.f)*var + base;
+  }
+
+static uint64_t ppsDiff(const Bucket& b, uint64_t time0, uint64_t time1) {
+  if(time1<=time0)
+    return 0;
+  uint64_t emitted0 = uint64_t(b.ppsValue*float(time0)/1000.f);
+  uint64_t emitted1 = uint64_t(b.ppsValue*float(time1)/1000.f);
+  return emitted1-emitted0;
+  }
+
+static void mkScene(std::vector<Bucket>& bucket, size_t emitters, size_t kinds, uint32_t seed) {
+  std::mt19937 rnd(seed);
+  std::uniform_real_distribution<float> wpos(-20000.f,20000.f);
+
+  bucket.resize(kinds);
+  for(size_t i=0; i<kinds; ++i) {
+    auto& b = bucket[i];
+    b.rnd.seed(seed+uint32_t(i)+1);
+    b.lspPartAvg = float(200+rnd()%2800);
+    b.lspPartVar = b.lspPartAvg*0.25f;
+    b.velAvg     = 0.01f+randf(rnd)*0.2f;
+    b.velVar     = b.velAvg*0.5f;
+    b.ppsValue   = float(5+rnd()%200);
+    // smoke rises, sparks fall, magic floats
+    switch(i%3) {
+      case 0: b.flyGravity = Vec3(0, 0.00002f,0); break;
+      case 1: b.flyGravity = Vec3(0,-0.0003f, 0); break;
+      case 2: b.flyGravity = Vec3(0, 0,       0); break;
+      }
+    // same as in PfxObjects::Bucket constructor
+    uint64_t lt  = uint64_t(b.lspPartAvg+b.lspPartVar);
+    uint64_t pps = uint64_t(std::ceil(b.ppsValue));
+    b.blockSize  = size_t((lt*pps+1000-1)/1000);
+    }
+
+  for(size_t i=0; i<emitters; ++i) {
+    auto& b = bucket[i%kinds];
+    Block p;
+    p.offset = b.block.size()*b.blockSize;
+    p.pos    = Vec3(wpos(rnd),wpos(rnd)*0.05f,wpos(rnd));
+    b.block.push_back(p);
+    }
+  for(auto& b:bucket) {
+    b.aos.resize(b.block.size()*b.blockSize);
+    b.soa.resize(b.block.size()*b.blockSize);
+    }
+  }
+
+// same slot search as in PfxObjects::tickSysEmit; particle is written to both layouts
+static void emit(Bucket& b, Block& p, uint64_t emited) {
+  size_t lastI = 0;
+  for(size_t id=1; emited>0; ++id) {
+    const size_t i = id%b.blockSize;
+    const size_t k = i+p.offset;
+    if(b.soa.life[k]==0) {
+      lastI = i;
+      p.count++;
+      --emited;
+
+      const float dy    = 1.f - 2.f*randf(b.rnd);
+      const float sn    = std::sqrt(1-dy*dy);
+      const float theta = float(2.0*M_PI)*randf(b.rnd);
+
+      OldPar ps;
+      ps.life     = uint16_t(randf(b.rnd,b.lspPartAvg,b.lspPartVar));
+      ps.maxLife  = ps.life;
+      ps.pos      = p.pos + Vec3(randf(b.rnd)-0.5f,randf(b.rnd)-0.5f,randf(b.rnd)-0.5f)*50.f;
+      ps.dir      = Vec3(sn*std::cos(theta),dy,sn*std::sin(theta));
+      ps.velocity = randf(b.rnd,b.velAvg,b.velVar);
+      ps.rotation = randf(b.rnd)*float(2.0*M_PI);
+      b.aos[k] = ps;
+
+      auto& s = b.soa;
+      s.life    [k] = ps.life;
+      s.maxLife [k] = ps.maxLife;
+      s.posX    [k] = ps.pos.x;
+      s.posY    [k] = ps.pos.y;
+      s.posZ    [k] = ps.pos.z;
+      s.dirX    [k] = ps.dir.x;
+      s.dirY    [k] = ps.dir.y;
+      s.dirZ    [k] = ps.dir.z;
+      s.velocity[k] = ps.velocity;
+      s.rotation[k] = ps.rotation;
+      } else {
+      if(lastI==i)
+        return;
+      }
+    }
+  }
+
+// former PfxObjects::Bucket::tick, per particle
+static void tickOld(Bucket& b, uint64_t dt) {
+  const float dtF = float(dt);
+  for(auto& sys:b.block) {
+    for(size_t i=0; i<b.blockSize; ++i) {
+      OldPar& ps = b.aos[sys.offset+i];
+      if(ps.life==0)
+        continue;
+      if(ps.life<=dt) {
+        ps.life = 0;
+        continue;
+        }
+      Vec3 dpos = ps.dir*ps.velocity;
+      ps.life  = uint16_t(ps.life-dt);
+      ps.pos  += dpos*dtF;
+      ps.dir  += b.flyGravity*dtF;
+      }
+    }
+  }
+
+// PfxObjects::Bucket::tick: age block, then integrate it as a whole
+static void tickSoa(Bucket& b, uint64_t dt) {
+  auto&       p   = b.soa;
+  const float dtF = float(dt);
+  const Vec3  g   = b.flyGravity*dtF;
+  for(auto& sys:b.block) {
+    const size_t s = sys.offset;
+    const size_t e = sys.offset+b.blockSize;
+    for(size_t i=s; i<e; ++i) {
+      if(p.life[i]==0)
+        continue;
+      if(p.life[i]<=dt) {
+        p.life[i] = 0;
+        sys.count--;
+        p.reset(i);
+        continue;
+        }
+      p.life[i] = uint16_t(p.life[i]-dt);
+      }
+    pfxIntegrate(&p.posX[s],&p.posY[s],&p.posZ[s],&p.dirX[s],&p.dirY[s],&p.dirZ[s],&p.velocity[s],b.blockSize,dtF,g);
+    }
+  }
+
+static bool same(float a, float b) {
+  return std::memcmp(&a,&b,sizeof(float))==0;
+  }
+
+// live particles must match; dead slots of soa state are garbage, until reused
+static size_t compare(const Bucket& b) {
+  size_t bad = 0;
+  for(size_t i=0; i<b.aos.size(); ++i) {
+    const OldPar& o = b.aos[i];
+    const SoaPar& s = b.soa;
+    if(o.life!=s.life[i]) {
+      ++bad;
+      continue;
+      }
+    if(o.life==0)
+      continue;
+    if(!same(o.pos.x,s.posX[i]) || !same(o.pos.y,s.posY[i]) || !same(o.pos.z,s.posZ[i]) ||
+       !same(o.dir.x,s.dirX[i]) || !same(o.dir.y,s.dirY[i]) || !same(o.dir.z,s.dirZ[i]))
+      ++bad;
+    }
+  return bad;
+  }
+
+struct Stat {
+  double tOld = 0, tSoa = 0;
+  size_t alive = 0, mismatch = 0;
+  };
+
+static Stat run(size_t emitters, size_t kinds, size_t frames, uint32_t seed, bool parallel) {
+  std::vector<Bucket> bucket;
+  mkScene(bucket,emitters,kinds,seed);
+
+  std::mt19937 rnd(seed);
+  Stat         st;
+  for(size_t f=0; f<frames; ++f) {
+    // 30..100 fps
+    const uint64_t dt = 10+rnd()%24;
+
+    auto t0 = Clock::now();
+    for(auto& b:bucket)
+      tickOld(b,dt);
+    st.tOld += msSince(t0);
+
+    t0 = Clock::now();
+    if(parallel) {
+      Workers::parallelFor(bucket,1,[dt](Bucket& b){
+        tickSoa(b,dt);
+        });
+      } else {
+      for(auto& b:bucket)
+        tickSoa(b,dt);
+      }
+    st.tSoa += msSince(t0);
+
+    // emitters are always active and nearby
+    for(auto& b:bucket)
+      for(auto& p:b.block) {
+        emit(b,p,ppsDiff(b,p.timeTotal,p.timeTotal+dt));
+        p.timeTotal += dt;
+        }
+
+    if(f%16==0 || f+1==frames) {
+      for(auto& b:bucket)
+        st.mismatch += compare(b);
+      }
+    for(auto& b:bucket)
+      for(auto& p:b.block)
+        st.alive += p.count;
+    }
+  return st;
+  }
+
+static void report(const char* name, const Stat& st, size_t frames) {
+  const double n = double(std::max<size_t>(frames,1));
+  std::printf("  %-10s aos %8.4f ms, soa %8.4f ms per frame, x%.2f, %.0f particles alive\n",
+              name,st.tOld/n,st.tSoa/n,st.tSoa>0 ? st.tOld/st.tSoa : 0.0,double(st.alive)/n);
+  }
+
+}
+
+int main(int argc, const char** argv) {
+  try {
+    const size_t   emitters = size_t  (std::stoul(arg(argc,argv,"--emitters","500")));
+    const size_t   kinds    = std::max<size_t>(1,std::stoul(arg(argc,argv,"--kinds","24")));
+    const size_t   frames   = size_t  (std::stoul(arg(argc,argv,"--frames", "2000")));
+    const uint32_t seed     = uint32_t(std::stoul(arg(argc,argv,"--seed",   "1")));
+
+    std::printf("%zu emitters of %zu kinds, %zu frames, %zu threads\n",emitters,kinds,frames,Workers::threadCount());
+    const Stat serial = run(emitters,kinds,frames,seed,false);
+    report("serial",serial,frames);
+    const Stat par    = run(emitters,kinds,frames,seed,true);
+    report("workers",par,frames);
+
+    const size_t mismatch = serial.mismatch+par.mismatch;
+    if(mismatch>0) {
+      std::printf("%zu mismatched particles\n",mismatch);
+      return 2;
+      }
+    std::printf("aos match\n");
+    return 0;
+    }
+  catch(const std::exception& e) {
+    std::fprintf(stderr,"error: %s\n",e.what());
+    return 1;
+    }
+  }
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils/samplering.h"
+
+// Stress test of SampleRing: producer thread and consumer (main) thread run at random pace.
+//
+//   ringstress [--samples N] [--seed N]
+//
+// Every sample carries it's own position, so consumer can verify, that stream is continuous.
+// Run it under ThreadSanitizer to check memory ordering as well.
+
+namespace {
+
+static const char* arg(int argc, const char** argv, const char* name, const char* def) {
+  for(int i=0; i+1<argc; ++i)
+    if(std::strcmp(argv[i],name)==0)
+      return argv[i+1];
+  return def;
+  }
+
+// position is wrapped, so it's represented exactly in float
+static float mark(size_t pos) {
+  return float(pos & 0xFFFFF);
+  }
+
+static bool run(size_t capacity, size_t total, uint32_t seed) {
+  SampleRing ring(capacity);
+  uint64_t   dropped = 0;
+
+  std::thread prod([&]() {
+    std::mt19937       rnd(seed);
+    std::vector<float> buf(3000);
+    size_t             next = 0;
+    while(next<total) {
+      const size_t n = std::min<size_t>(1+rnd()%buf.size(),total-next);
+      for(size_t i=0; i<n; ++i)
+        buf[i] = mark(next+i);
+      // retry the rest, so stream has no gaps; every partial push is accounted as overrun
+      size_t done = 0;
+      while(done<n) {
+        const size_t cnt = ring.push(buf.data()+done,n-done);
+        dropped += (n-done)-cnt;
+        done    += cnt;
+        if(done<n)
+          std::this_thread::yield();
+        }
+      next += n;
+      }
+    });
+
+  std::mt19937       rnd(seed+1);
+  std::vector<float> buf(4096);
+  size_t             got = 0, bad = 0;
+  uint64_t           missing = 0;
+  while(got<total) {
+    const size_t n = 1+rnd()%buf.size();
+    if(rnd()%2 && ring.size()<n) {
+      std::this_thread::yield();
+      continue;
+      }
+    const size_t cnt = ring.pop(buf.data(),n);
+    for(size_t i=0; i<cnt; ++i)
+      if(buf[i]!=mark(got+i))
+        ++bad;
+    missing += n-cnt;
+    got     += cnt;
+    }
+  prod.join();
+
+  const bool ok = bad==0 && ring.size()==0 && ring.overruns()==dropped && ring.underruns()==missing;
+  std::printf("cap %7zu: %zu samples, %zu discontinuities, overrun %llu/%llu, underrun %llu/%llu %s\n",
+              ring.capacity(),got,bad,
+              (unsigned long long)ring.overruns(), (unsigned long long)dropped,
+              (unsigned long long)ring.underruns(),(unsigned long long)missing,
+              ok ? "ok" : "FAILED");
+  return ok;
+  }
+
+}
+
+int main(int argc, const char** argv) {
+  const size_t   total = size_t  (std::stoull(arg(argc,argv,"--samples","20000000")));
+  const uint32_t seed  = uint32_t(std::stoul (arg(argc,argv,"--seed",   "1")));
+
+  // capacity below, around and above chunk size of both sides
+  bool ok = true;
+  for(size_t cap:{size_t(7),size_t(64),size_t(1000),size_t(4096),size_t(88200)})
+    ok &= run(cap,total,seed);
+  return ok ? 0 : 2;
+  }
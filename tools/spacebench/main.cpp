@@ -0,0 +1,458 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "graphics/dynamic/frustrum.h"
+#include "world/spaceindex.h"
+#include "world/vob.h"
+
+// Benchmark of object index (SpaceIndex) against kd-tree, that it replaced.
+//
+//   spacebench [--objects N] [--queries N] [--frames N] [--radius R] [--nearest K] [--seed N]
+//
+// Scenarios follow the game: static mobs with focus queries around player, few objects moving
+// (index is invalidated or objects are updated), items being dropped and picked up. Queries are sampled and checked
+// against brute force. Box, frustum and k-nearest queries, that kd-tree didn't have, are compared to brute force only.
+
+using namespace Tempest;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point t0) {
+  return std::chrono::duration<double,std::milli>(Clock::now()-t0).count();
+  }
+
+static const char* arg(int argc, const char** argv, const char* name, const char* def) {
+  for(int i=0; i+1<argc; ++i)
+    if(std::strcmp(argv[i],name)==0)
+      return argv[i+1];
+  return def;
+  }
+
+// kd-tree of former BaseSpaceIndex: rebuilt on first query after any change
+class OldIndex final {
+  public:
+    void add(Vob* v) {
+      arr.push_back(v);
+      index.clear();
+      }
+
+    void del(Vob* v) {
+      for(size_t i=0;i<arr.size();++i) {
+        if(arr[i]==v) {
+          arr[i] = arr.back();
+          arr.pop_back();
+          index.clear();
+          return;
+          }
+        }
+      }
+
+    void invalidate() {
+      index.clear();
+      }
+
+    template<class Func>
+    void find(const Vec3& p, float R, Func f) {
+      if(index.size()==0)
+        buildIndex();
+      implFind(index.data(),index.size(),0,p,R,f);
+      }
+
+  private:
+    std::vector<Vob*> arr;
+    std::vector<Vob*> index;
+
+    void buildIndex() {
+      index = arr;
+      buildIndex(index.data(),index.size(),0);
+      }
+
+    void buildIndex(Vob** v, size_t cnt, uint8_t depth) {
+      depth%=3;
+      std::sort(v,v+cnt,[depth](const Vob* a, const Vob* b){
+        auto pa = a->position();
+        auto pb = b->position();
+        return depth==0 ? pa.x<pb.x : (depth==1 ? pa.y<pb.y : pa.z<pb.z);
+        });
+      size_t mid = cnt/2;
+      if(mid>0)
+        buildIndex(v,mid,uint8_t(depth+1u));
+      if(mid+1<cnt)
+        buildIndex(v+mid+1,cnt-mid-1,uint8_t(depth+1u));
+      }
+
+    template<class Func>
+    void implFind(Vob** v, size_t cnt, uint8_t depth, const Vec3& p, float R, Func& f) {
+      if(cnt==0)
+        return;
+      auto mid = cnt/2;
+      auto pos = v[mid]->position();
+      if((pos-p).quadLength()<=R*R)
+        f(*v[mid]);
+
+      depth%=3;
+      const float c  = depth==0 ? pos.x : (depth==1 ? pos.y : pos.z);
+      const float pc = depth==0 ? p.x   : (depth==1 ? p.y   : p.z);
+      if(pc-R<=c)
+        implFind(v,mid,uint8_t(depth+1u),p,R,f);
+      if(pc+R>=c)
+        implFind(v+mid+1,cnt-mid-1,uint8_t(depth+1u),p,R,f);
+      }
+  };
+
+struct Scene {
+  std::unique_ptr<char[]>           world;
+  std::vector<std::unique_ptr<Vob>> obj;
+  std::vector<Vec3>                 query;
+  std::mt19937                      rnd;
+  std::normal_distribution<float>   local{0.f,4000.f};
+  std::vector<Vec3>                 town;
+
+  Vec3 point() {
+    const Vec3& t = town[rnd()%town.size()];
+    return Vec3(t.x+local(rnd),t.y+local(rnd)*0.05f,t.z+local(rnd));
+    }
+
+  void move(Vob& v, const Vec3& p) {
+    Matrix4x4 m;
+    m.identity();
+    m.translate(p.x,p.y,p.z);
+    v.setGlobalTransform(m);
+    }
+  };
+
+static void mkScene(Scene& sc, size_t objects, size_t queries, uint32_t seed) {
+  // objects are never asked for their world
+  sc.world.reset(new char[64]);
+  sc.rnd.seed(seed);
+
+  std::uniform_real_distribution<float> wpos(-50000.f,50000.f);
+  sc.town.resize(32);
+  for(auto& i:sc.town)
+    i = Vec3(wpos(sc.rnd),wpos(sc.rnd)*0.05f,wpos(sc.rnd));
+
+  for(size_t i=0; i<objects; ++i) {
+    sc.obj.emplace_back(new Vob(*reinterpret_cast<World*>(sc.world.get())));
+    sc.move(*sc.obj.back(),sc.point());
+    }
+  for(size_t i=0; i<queries; ++i)
+    sc.query.push_back(sc.point());
+  }
+
+static void bruteForce(const std::vector<Vob*>& all, const Vec3& p, float R, std::vector<Vob*>& out) {
+  out.clear();
+  for(auto v:all)
+    if((v->position()-p).quadLength()<=R*R)
+      out.push_back(v);
+  std::sort(out.begin(),out.end());
+  }
+
+// column-major view-projection, same layout as Tempest::Matrix4x4
+static Matrix4x4 mkViewProj(const Vec3& eye, float yaw, float fov, float zFar) {
+  const Vec3  fw    = {std::sin(yaw),-0.1f,std::cos(yaw)};
+  const float l     = std::sqrt(fw.z*fw.z+fw.x*fw.x);
+  const Vec3  rt    = {fw.z/l,0,-fw.x/l};
+  const Vec3  up    = {rt.y*fw.z-rt.z*fw.y, rt.z*fw.x-rt.x*fw.z, rt.x*fw.y-rt.y*fw.x};
+  const float zNear = 10.f;
+
+  const float view[4][4] = {
+    { rt.x, rt.y, rt.z,-(rt.x*eye.x+rt.y*eye.y+rt.z*eye.z)},
+    { up.x, up.y, up.z,-(up.x*eye.x+up.y*eye.y+up.z*eye.z)},
+    {-fw.x,-fw.y,-fw.z, (fw.x*eye.x+fw.y*eye.y+fw.z*eye.z)},
+    {    0,    0,    0, 1},
+    };
+  const float ft = 1.f/std::tan(fov*0.5f);
+  const float proj[4][4] = {
+    {ft*9.f/16.f, 0, 0,                         0},
+    {0,          ft, 0,                         0},
+    {0,           0, (zNear+zFar)/(zNear-zFar), 2*zNear*zFar/(zNear-zFar)},
+    {0,           0,-1,                         0},
+    };
+
+  float m[16] = {};
+  for(int r=0; r<4; ++r)
+    for(int c=0; c<4; ++c) {
+      float v = 0;
+      for(int k=0; k<4; ++k)
+        v += proj[r][k]*view[k][c];
+      m[c*4+r] = v;
+      }
+  return Matrix4x4(m);
+  }
+
+struct QStat {
+  double grid = 0, brute = 0;
+  size_t found = 0, mismatch = 0;
+  };
+
+template<class Fn>
+static void timed(double& t, Fn fn) {
+  auto t0 = Clock::now();
+  fn();
+  t += msSince(t0);
+  }
+
+// box, frustum and k-nearest queries; 'R' is half-size of box and radius of nearest search
+static void extraQueries(SpaceIndex<Vob>& grid, const std::vector<Vob*>& all, const std::vector<Vec3>& query,
+                         float R, size_t k, QStat& box, QStat& fr, QStat& knn) {
+  std::vector<Vob*> rg, ref;
+  std::vector<Vob*> near(k);
+  for(size_t i=0; i<query.size(); ++i) {
+    const Vec3& q = query[i];
+
+    // box
+    const Vec3 b0 = {q.x-R,q.y-R*0.25f,q.z-R}, b1 = {q.x+R,q.y+R*0.25f,q.z+R};
+    rg.clear();
+    ref.clear();
+    timed(box.grid,[&](){ grid.find(b0,b1,[&rg](Vob& v){ rg.push_back(&v); }); });
+    timed(box.brute,[&](){
+      for(auto v:all) {
+        auto p = v->position();
+        if(b0.x<=p.x && p.x<=b1.x && b0.y<=p.y && p.y<=b1.y && b0.z<=p.z && p.z<=b1.z)
+          ref.push_back(v);
+        }
+      });
+    std::sort(rg.begin(),rg.end());
+    std::sort(ref.begin(),ref.end());
+    box.found += rg.size();
+    if(rg!=ref)
+      ++box.mismatch;
+
+    // frustum of camera in the world
+    Frustrum f;
+    f.make(mkViewProj(q,float(i)*0.7f,float(M_PI)/4.f,R*8.f));
+    rg.clear();
+    ref.clear();
+    timed(fr.grid,[&](){ grid.find(f,[&rg](Vob& v){ rg.push_back(&v); }); });
+    timed(fr.brute,[&](){
+      for(auto v:all) {
+        auto p = v->position();
+        if(f.testPoint(p.x,p.y,p.z))
+          ref.push_back(v);
+        }
+      });
+    std::sort(rg.begin(),rg.end());
+    std::sort(ref.begin(),ref.end());
+    fr.found += rg.size();
+    if(rg!=ref)
+      ++fr.mismatch;
+
+    // k-nearest: distances must be same, as of k closest objects; equal distances may come in any order
+    size_t cnt = 0;
+    timed(knn.grid,[&](){ cnt = grid.findNearest(q,R,near.data(),k); });
+    std::vector<float> dg, dr;
+    for(size_t r=0; r<cnt; ++r)
+      dg.push_back((near[r]->position()-q).quadLength());
+    timed(knn.brute,[&](){
+      for(auto v:all) {
+        float d = (v->position()-q).quadLength();
+        if(d<=R*R)
+          dr.push_back(d);
+        }
+      std::sort(dr.begin(),dr.end());
+      if(dr.size()>k)
+        dr.resize(k);
+      });
+    knn.found += cnt;
+    if(dg!=dr)
+      ++knn.mismatch;
+    }
+  }
+
+static void report(const char* name, const QStat& st, size_t cnt) {
+  const double n = double(std::max<size_t>(cnt,1));
+  std::printf("  %-24s grid %9.4f ms, brute force %9.4f ms per query, %.1f found\n",
+              name,st.grid/n,st.brute/n,double(st.found)/n);
+  }
+
+struct Stat {
+  double grid = 0, tree = 0;
+  size_t found = 0, mismatch = 0;
+  };
+
+// runs queries on both indices; if 'verify' is set, results are compared to brute force
+static void queries(SpaceIndex<Vob>& grid, OldIndex& tree, const std::vector<Vob*>& all,
+                    const Vec3* q, size_t cnt, float R, bool verify, Stat& st) {
+  std::vector<Vob*> rg, rt, ref;
+  for(size_t i=0; i<cnt; ++i) {
+    rg.clear();
+    auto t0 = Clock::now();
+    grid.find(q[i],R,[&rg](Vob& v){ rg.push_back(&v); });
+    st.grid += msSince(t0);
+
+    rt.clear();
+    t0 = Clock::now();
+    tree.find(q[i],R,[&rt](Vob& v){ rt.push_back(&v); });
+    st.tree += msSince(t0);
+
+    st.found += rg.size();
+    if(!verify)
+      continue;
+    bruteForce(all,q[i],R,ref);
+    std::sort(rg.begin(),rg.end());
+    std::sort(rt.begin(),rt.end());
+    if(rg!=ref || rt!=ref)
+      ++st.mismatch;
+    }
+  }
+
+static void report(const char* name, const Stat& st, size_t frames) {
+  const double n = double(std::max<size_t>(frames,1));
+  std::printf("  %-24s grid %9.4f ms, old tree %9.4f ms per frame, %.1f found\n",
+              name,st.grid/n,st.tree/n,double(st.found)/n);
+  }
+
+}
+
+int main(int argc, const char** argv) {
+  try {
+    const size_t   objects = size_t  (std::stoul(arg(argc,argv,"--objects","3000")));
+    const size_t   nQuery  = size_t  (std::stoul(arg(argc,argv,"--queries","2000")));
+    const size_t   frames  = size_t  (std::stoul(arg(argc,argv,"--frames", "1000")));
+    const float    R       = std::stof(arg(argc,argv,"--radius","1000"));
+    const size_t   k       = size_t  (std::stoul(arg(argc,argv,"--nearest","8")));
+    const uint32_t seed    = uint32_t(std::stoul(arg(argc,argv,"--seed",   "1")));
+
+    Scene sc;
+    mkScene(sc,objects,nQuery,seed);
+    std::vector<Vob*> all;
+    for(auto& i:sc.obj)
+      all.push_back(i.get());
+
+    SpaceIndex<Vob> grid;
+    OldIndex        tree;
+    size_t          mismatch = 0;
+    std::printf("%zu objects, radius %g, %zu frames\n",objects,double(R),frames);
+
+    // build: index is created by first query
+    {
+    Stat st;
+    auto t0 = Clock::now();
+    for(auto v:all)
+      grid.add(v);
+    st.grid += msSince(t0);
+    t0 = Clock::now();
+    for(auto v:all)
+      tree.add(v);
+    st.tree += msSince(t0);
+    queries(grid,tree,all,sc.query.data(),1,R,true,st);
+    report("build + first query",st,1);
+    mismatch += st.mismatch;
+    }
+
+    // static world: focus queries around player
+    {
+    Stat st;
+    for(size_t f=0; f<frames; ++f)
+      queries(grid,tree,all,&sc.query[f%sc.query.size()],1,R,f%16==0,st);
+    report("static, 1 query",st,frames);
+    mismatch += st.mismatch;
+    }
+
+    // few objects move: mob is animated and index is invalidated
+    for(size_t moving:{size_t(1),size_t(10)}) {
+      Stat st;
+      for(size_t f=0; f<frames; ++f) {
+        for(size_t i=0; i<moving; ++i) {
+          auto& v = *all[sc.rnd()%all.size()];
+          sc.move(v,v.position()+Vec3(float(sc.rnd()%200)-100.f,0,float(sc.rnd()%200)-100.f));
+          }
+        auto t0 = Clock::now();
+        grid.invalidate();
+        st.grid += msSince(t0);
+        t0 = Clock::now();
+        tree.invalidate();
+        st.tree += msSince(t0);
+        queries(grid,tree,all,&sc.query[f%sc.query.size()],1,R,f%16==0,st);
+        }
+      char name[64] = {};
+      std::snprintf(name,sizeof(name),"%zu moving, 1 query",moving);
+      report(name,st,frames);
+      mismatch += st.mismatch;
+      }
+
+    // few objects move and are updated one by one: only they are rebucketed
+    for(size_t moving:{size_t(1),size_t(10)}) {
+      Stat st;
+      for(size_t f=0; f<frames; ++f) {
+        std::vector<Vob*> moved;
+        for(size_t i=0; i<moving; ++i) {
+          auto& v = *all[sc.rnd()%all.size()];
+          sc.move(v,v.position()+Vec3(float(sc.rnd()%200)-100.f,0,float(sc.rnd()%200)-100.f));
+          moved.push_back(&v);
+          }
+        auto t0 = Clock::now();
+        for(auto v:moved)
+          grid.update(v);
+        st.grid += msSince(t0);
+        t0 = Clock::now();
+        tree.invalidate();
+        st.tree += msSince(t0);
+        queries(grid,tree,all,&sc.query[f%sc.query.size()],1,R,f%16==0,st);
+        }
+      char name[64] = {};
+      std::snprintf(name,sizeof(name),"%zu moving, update",moving);
+      report(name,st,frames);
+      mismatch += st.mismatch;
+      }
+
+    // items are dropped and picked up
+    {
+    Stat st;
+    for(size_t f=0; f<frames; ++f) {
+      const size_t i = sc.rnd()%all.size();
+      Vob*         v = all[i];
+      auto t0 = Clock::now();
+      grid.del(v);
+      st.grid += msSince(t0);
+      t0 = Clock::now();
+      tree.del(v);
+      st.tree += msSince(t0);
+
+      sc.move(*v,sc.point());
+      t0 = Clock::now();
+      grid.add(v);
+      st.grid += msSince(t0);
+      t0 = Clock::now();
+      tree.add(v);
+      st.tree += msSince(t0);
+      queries(grid,tree,all,&sc.query[f%sc.query.size()],1,R,f%16==0,st);
+      }
+    report("del + add, 1 query",st,frames);
+    mismatch += st.mismatch;
+    }
+
+    // queries, that only grid has
+    {
+    QStat box, fr, knn;
+    extraQueries(grid,all,sc.query,R,k,box,fr,knn);
+    report("box",box,sc.query.size());
+    report("frustum",fr,sc.query.size());
+    char name[64] = {};
+    std::snprintf(name,sizeof(name),"%zu nearest",k);
+    report(name,knn,sc.query.size());
+    mismatch += box.mismatch + fr.mismatch + knn.mismatch;
+    }
+
+    if(mismatch>0) {
+      std::printf("%zu mismatched queries\n",mismatch);
+      return 2;
+      }
+    std::printf("brute-force match\n");
+    return 0;
+    }
+  catch(const std::exception& e) {
+    std::fprintf(stderr,"error: %s\n",e.what());
+    return 1;
+    }
+  }
@@ -0,0 +1,34 @@
+#include "world/vob.h"
+
+// Vob members, that index benchmark needs: only transform is kept, world is never touched
+
+using namespace Tempest;
+
+Vob::Vob(World& owner)
+  : world(owner) {
+  }
+
+Vob::~Vob() {
+  }
+
+Vec3 Vob::position() const {
+  return Vec3(pos.at(3,0),pos.at(3,1),pos.at(3,2));
+  }
+
+void Vob::setGlobalTransform(const Matrix4x4& p) {
+  pos   = p;
+  local = pos;
+  }
+
+void Vob::save(Serialize&) const {
+  }
+
+void Vob::load(Serialize&) {
+  }
+
+bool Vob::setMobState(const char*, int32_t) {
+  return false;
+  }
+
+void Vob::moveEvent() {
+  }
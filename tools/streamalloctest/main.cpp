@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "graphics/dynamic/streamalloc.h"
+
+// Tests of StreamAlloc bookkeeping, that StreamBuffer uses to upload dynamic vertex buffers.
+//
+//   streamalloctest [--steps N] [--seed N]
+//
+// Fixed cases cover growth, realloc flags, merge of dirty ranges and collapse of too many ranges;
+// random walk replays StreamBuffer on a model of gpu copies and checks them against cpu data.
+
+namespace {
+
+size_t failed = 0;
+
+#define CHECK(cond) check(cond,#cond,__LINE__)
+
+static void check(bool ok, const char* what, int line) {
+  if(ok)
+    return;
+  std::printf("  line %d: %s\n",line,what);
+  ++failed;
+  }
+
+static const char* arg(int argc, const char** argv, const char* name, const char* def) {
+  for(int i=0; i+1<argc; ++i)
+    if(std::strcmp(argv[i],name)==0)
+      return argv[i+1];
+  return def;
+  }
+
+static bool ranges(const StreamAlloc& a, uint8_t fId, std::vector<StreamAlloc::Range> expect) {
+  auto& d = a.dirty(fId);
+  if(d.size()!=expect.size())
+    return false;
+  for(size_t i=0; i<d.size(); ++i)
+    if(d[i].begin!=expect[i].begin || d[i].end!=expect[i].end)
+      return false;
+  return true;
+  }
+
+static void testGrowth() {
+  StreamAlloc a(2);
+  CHECK(a.size()==0 && a.capacity()==0);
+  CHECK(!a.resize(0));
+
+  CHECK(a.resize(1));
+  CHECK(a.size()==1 && a.capacity()==1);
+  // doubling, unless requested size is larger
+  CHECK(a.resize(2));
+  CHECK(a.capacity()==2);
+  CHECK(a.resize(3));
+  CHECK(a.capacity()==4);
+  CHECK(!a.resize(4));
+  CHECK(a.resize(100));
+  CHECK(a.capacity()==100);
+
+  // shrink keeps capacity
+  CHECK(!a.resize(10));
+  CHECK(a.size()==10 && a.capacity()==100);
+  CHECK(!a.resize(60));
+  CHECK(a.capacity()==100);
+  CHECK(a.resize(101));
+  CHECK(a.capacity()==200);
+
+  // empty buffer releases memory
+  CHECK(a.resize(0));
+  CHECK(a.size()==0 && a.capacity()==0);
+  }
+
+static void testRealloc() {
+  StreamAlloc a(3);
+  for(uint8_t f=0; f<3; ++f)
+    CHECK(!a.needRealloc(f));
+
+  a.resize(8);
+  for(uint8_t f=0; f<3; ++f)
+    CHECK(a.needRealloc(f));
+
+  // frame, that is recreated anyway, doesn't track ranges
+  a.invalidate(0,4);
+  for(uint8_t f=0; f<3; ++f)
+    CHECK(a.dirty(f).empty());
+
+  a.commit(1);
+  CHECK( a.needRealloc(0));
+  CHECK(!a.needRealloc(1));
+  CHECK( a.needRealloc(2));
+
+  a.invalidate(2,5);
+  CHECK(a.dirty(0).empty());
+  CHECK(ranges(a,1,{{2,5}}));
+  CHECK(a.dirty(2).empty());
+
+  // growth drops ranges of committed frame and requests realloc again
+  a.resize(9);
+  CHECK(a.needRealloc(1));
+  CHECK(a.dirty(1).empty());
+
+  // shrink within capacity marks tail, so stale elements are cleared on gpu
+  for(uint8_t f=0; f<3; ++f)
+    a.commit(f);
+  a.resize(5);
+  for(uint8_t f=0; f<3; ++f) {
+    CHECK(!a.needRealloc(f));
+    CHECK(ranges(a,f,{{5,9}}));
+    }
+
+  // shrink to zero is realloc
+  for(uint8_t f=0; f<3; ++f)
+    a.commit(f);
+  a.resize(0);
+  for(uint8_t f=0; f<3; ++f)
+    CHECK(a.needRealloc(f));
+  }
+
+static void testMerge() {
+  StreamAlloc a(1);
+  a.resize(100);
+  a.commit(0);
+
+  a.invalidate(10,20);
+  a.invalidate(30,40);
+  CHECK(ranges(a,0,{{10,20},{30,40}}));
+  // inserted in order
+  a.invalidate(0,5);
+  a.invalidate(50,60);
+  CHECK(ranges(a,0,{{0,5},{10,20},{30,40},{50,60}}));
+  // touching ranges merge
+  a.invalidate(5,7);
+  a.invalidate(20,22);
+  CHECK(ranges(a,0,{{0,7},{10,22},{30,40},{50,60}}));
+  // contained range changes nothing
+  a.invalidate(32,38);
+  CHECK(ranges(a,0,{{0,7},{10,22},{30,40},{50,60}}));
+  // bridge over few ranges
+  a.invalidate(15,55);
+  CHECK(ranges(a,0,{{0,7},{10,60}}));
+  // empty and reversed ranges are ignored, end is clamped to capacity
+  a.invalidate(70,70);
+  a.invalidate(80,75);
+  a.invalidate(90,1000);
+  a.invalidate(200,300);
+  CHECK(ranges(a,0,{{0,7},{10,60},{90,100}}));
+
+  a.commit(0);
+  CHECK(a.dirty(0).empty());
+  a.invalidate();
+  CHECK(ranges(a,0,{{0,100}}));
+  }
+
+static void testCollapse() {
+  // StreamAlloc::MaxRanges is 16
+  StreamAlloc a(1);
+  a.resize(1000);
+  a.commit(0);
+  for(size_t i=0; i<16; ++i)
+    a.invalidate(i*10+100,i*10+102);
+  CHECK(a.dirty(0).size()==16);
+  a.invalidate(500,501);
+  CHECK(ranges(a,0,{{100,501}}));
+  // collapsed range still merges
+  a.invalidate(50,60);
+  a.invalidate(600,700);
+  CHECK(ranges(a,0,{{50,60},{100,501},{600,700}}));
+  }
+
+// StreamBuffer over a model of per-frame gpu copies
+static void testRandom(size_t steps, uint32_t seed) {
+  const uint8_t frames = 3;
+  std::mt19937  rnd(seed);
+
+  StreamAlloc                       a(frames);
+  std::vector<uint32_t>             cpu;
+  std::vector<std::vector<uint32_t>> gpu(frames);
+  size_t                            uploaded = 0, reallocs = 0, mismatch = 0;
+  uint32_t                          stamp    = 1;
+
+  for(size_t s=0; s<steps; ++s) {
+    const uint8_t fId = uint8_t(s%frames);
+    const size_t  ops = rnd()%8;
+    for(size_t i=0; i<ops; ++i) {
+      const uint32_t op = rnd()%16;
+      if(op==0) {
+        // resize, same way as StreamBuffer does it
+        const size_t sz   = (rnd()%8==0) ? 0 : rnd()%300;
+        const size_t prev = a.size();
+        if(sz<prev)
+          std::fill(cpu.begin()+ptrdiff_t(sz),cpu.begin()+ptrdiff_t(prev),0u);
+        a.resize(sz);
+        cpu.resize(a.capacity());
+        }
+      else if(op==1) {
+        std::fill(cpu.begin(),cpu.begin()+ptrdiff_t(a.size()),stamp++);
+        a.invalidate();
+        }
+      else if(a.size()>0) {
+        const size_t b = rnd()%a.size();
+        const size_t e = std::min(a.size(),b+1+rnd()%8);
+        for(size_t p=b; p<e; ++p)
+          cpu[p] = stamp++;
+        a.invalidate(b,e);
+        }
+      }
+
+    auto& g = gpu[fId];
+    if(a.needRealloc(fId)) {
+      g = cpu;
+      uploaded += cpu.size();
+      ++reallocs;
+      } else {
+      for(auto& r:a.dirty(fId)) {
+        CHECK(r.begin<r.end && r.end<=g.size());
+        std::copy(cpu.begin()+ptrdiff_t(r.begin),cpu.begin()+ptrdiff_t(r.end),g.begin()+ptrdiff_t(r.begin));
+        uploaded += r.end-r.begin;
+        }
+      }
+    a.commit(fId);
+
+    if(g!=cpu) {
+      if(mismatch==0)
+        std::printf("  step %zu: frame %d is out of sync\n",s,int(fId));
+      ++mismatch;
+      }
+    // elements past the end are zero: degenerate, when buffer is drawn as a whole
+    for(size_t p=a.size(); p<cpu.size(); ++p)
+      if(cpu[p]!=0)
+        ++mismatch;
+    }
+  failed += mismatch;
+  std::printf("  random: %zu steps, %zu reallocs, %.1f elements uploaded per frame\n",
+              steps,reallocs,steps>0 ? double(uploaded)/double(steps) : 0.0);
+  }
+
+}
+
+int main(int argc, const char** argv) {
+  const size_t   steps = size_t  (std::stoul(arg(argc,argv,"--steps","200000")));
+  const uint32_t seed  = uint32_t(std::stoul(arg(argc,argv,"--seed", "1")));
+
+  std::printf("growth\n");
+  testGrowth();
+  std::printf("realloc\n");
+  testRealloc();
+  std::printf("merge\n");
+  testMerge();
+  std::printf("collapse\n");
+  testCollapse();
+  std::printf("random\n");
+  testRandom(steps,seed);
+
+  if(failed>0) {
+    std::printf("%zu checks failed\n",failed);
+    return 2;
+    }
+  std::printf("all checks passed\n");
+  return 0;
+  }